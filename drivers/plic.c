@@ -1,8 +1,14 @@
 #include "kernel.h"
+#include "kernel/hart.h"
+
+/* the hart whose S-mode context has the device interrupts enabled */
+static int plic_hart = -1;
 
 void plic_init(void)
 {
-	int hart = r_tp();
+	int hart = this_hart();
+
+	plic_hart = hart;
   
 	/* 
 	 * Set priority for UART0.
@@ -30,7 +36,19 @@ void plic_init(void)
 	 * Use S-mode threshold register instead of M-mode
 	 */
 	*(uint32_t*)PLIC_STHRESHOLD(hart) = 0;
-	
+
+	/*
+	 * Keep every source off the isolated harts' S-mode contexts:
+	 * no enable bits, and a threshold of 7 masks anything enabled later.
+	 * Their interrupts are all taken by this (boot) hart.
+	 */
+	for (int h = 0; h < MAXNUM_CPU; h++) {
+		if (hart_isolated_mask() & (1UL << h)) {
+			*(uint32_t*)PLIC_SENABLE(h) = 0;
+			*(uint32_t*)PLIC_STHRESHOLD(h) = 7;
+		}
+	}
+
 	/* enable supervisor-mode external interrupts. */
 	w_sie(r_sie() | SIE_SEIE);
 
@@ -38,6 +56,26 @@ void plic_init(void)
 	w_sstatus(r_sstatus() | SSTATUS_SIE);
 }
 
+/*
+ * DESCRIPTION:
+ *	Called on the hart taking over when another hart goes offline.
+ *	If that hart was the one taking device interrupts, enable them for
+ *	this hart's S-mode context instead and disable them for the old one.
+ */
+void plic_migrate_from(int hart)
+{
+	int self = this_hart();
+
+	if (plic_hart != hart || hart == self) {
+		return;
+	}
+	*(uint32_t*)PLIC_SENABLE(self) = (1 << UART0_IRQ);
+	*(uint32_t*)PLIC_STHRESHOLD(self) = 0;
+	*(uint32_t*)PLIC_SENABLE(hart) = 0;
+	plic_hart = self;
+	w_sie(r_sie() | SIE_SEIE);
+}
+
 /* 
  * DESCRIPTION:
  *	Query the PLIC what interrupt we should serve.
@@ -52,7 +90,7 @@ void plic_init(void)
  */
 int plic_claim(void)
 {
-	int hart = r_tp();
+	int hart = this_hart();
 	/* Use S-mode claim register */
 	int irq = *(uint32_t*)PLIC_SCLAIM(hart);
 	return irq;
@@ -70,7 +108,7 @@ int plic_claim(void)
  */
 void plic_complete(int irq)
 {
-	int hart = r_tp();
+	int hart = this_hart();
 	/* Use S-mode complete register */
 	*(uint32_t*)PLIC_SCOMPLETE(hart) = irq;
 }
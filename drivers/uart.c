@@ -0,0 +1,339 @@
+#include "kernel.h"
+#include "arch/sbi.h"
+#include "kernel/uart.h"
+#include "kernel/ringbuf.h"
+
+/*
+ * The UART control registers are memory-mapped at address UART0.
+ * This macro returns the address of one of the registers.
+ */
+#define UART_REG(reg) ((volatile uint8_t *)(UART0 + reg))
+
+/*
+ * Reference
+ * [1]: TECHNICAL DATA ON 16550, http://byterunner.com/16550.html
+ *
+ * UART control registers map. see [1] "PROGRAMMING TABLE"
+ * note some are reused by multiple functions
+ * 0 (write mode): THR/DLL
+ * 1 (write mode): IER/DLM
+ */
+#define RHR 0	// Receive Holding Register (read mode)
+#define THR 0	// Transmit Holding Register (write mode)
+#define IER 1	// Interrupt Enable Register (write mode)
+#define FCR 2	// FIFO Control Register (write mode)
+#define ISR 2	// Interrupt Status Register (read mode)
+#define LCR 3	// Line Control Register
+#define MCR 4	// Modem Control Register
+#define LSR 5	// Line Status Register
+
+#define IER_RX_ENABLE	(1 << 0)	// Received Data Available
+#define IER_TX_ENABLE	(1 << 1)	// Transmit Holding Register Empty
+
+#define FCR_FIFO_ENABLE	(1 << 0)
+#define FCR_FIFO_CLEAR	(3 << 1)	// clear the content of the two FIFOs
+#define FCR_RX_TRIG_8	(2 << 6)	// RX interrupt once 8 bytes are queued
+
+#define MCR_DTR		(1 << 0)
+#define MCR_RTS		(1 << 1)
+#define MCR_OUT2	(1 << 3)	// gates the interrupt line on PC-style 16550s
+
+#define ISR_NO_INT	(1 << 0)
+#define ISR_ID_MASK	0x0f
+#define ISR_LINE	0x06		// receiver line status
+#define ISR_RX_DATA	0x04		// received data available
+#define ISR_RX_TIMEOUT	0x0c		// character timeout (data below trigger level)
+#define ISR_TX_EMPTY	0x02		// transmit holding register empty
+
+#define LSR_RX_READY	(1 << 0)	// input is waiting to be read from RHR
+#define LSR_TX_IDLE	(1 << 5)	// THR and the TX FIFO are empty
+
+#define UART_FIFO_SIZE	16
+
+#define uart_read_reg(reg) (*(UART_REG(reg)))
+#define uart_write_reg(reg, v) (*(UART_REG(reg)) = (v))
+
+/*
+ * TX/RX software rings. Sizes must be powers of two.
+ * TX ring: many producers (printk / sys_write on any hart), one consumer (the pump).
+ * RX ring: one producer (the ISR), one consumer (sys_read).
+ */
+#define UART_TX_BUF_SIZE 4096
+#define UART_RX_BUF_SIZE 512
+
+static uint8_t tx_storage[UART_TX_BUF_SIZE];
+static uint8_t rx_storage[UART_RX_BUF_SIZE];
+static struct ringbuf tx_ring;
+static struct ringbuf rx_ring;
+
+static int uart_ready = 0;
+static volatile int tx_pumping = 0;	// try-lock: only one context feeds THR at a time
+static int tx_irq_on = 0;		// protected by tx_pumping
+static volatile uint32_t tx_room_wanted = 0;	// bytes the printk flusher is waiting for
+static uint32_t rx_overruns = 0;
+
+/* readers blocked in sys_read() until the ISR queues more input */
+static struct wait_queue_head rx_wait = WAIT_QUEUE_HEAD_INIT(rx_wait);
+static uint64_t rx_wake_stamp = 0;	// rdtime when the ISR last woke readers
+static struct uart_rx_stats rx_stats;
+
+void uart_init(void)
+{
+	ringbuf_init(&tx_ring, tx_storage, UART_TX_BUF_SIZE);
+	ringbuf_init(&rx_ring, rx_storage, UART_RX_BUF_SIZE);
+
+	/* disable interrupts while we reprogram the chip */
+	uart_write_reg(IER, 0x00);
+
+	/*
+	 * Baud rate and 8N1 framing have already been set up by the firmware
+	 * (OpenSBI / U-Boot), so we only turn on the FIFOs here.
+	 */
+	uart_write_reg(FCR, FCR_FIFO_ENABLE | FCR_FIFO_CLEAR | FCR_RX_TRIG_8);
+	uart_write_reg(MCR, MCR_DTR | MCR_RTS | MCR_OUT2);
+
+	/* drain whatever arrived before we took over */
+	while (uart_read_reg(LSR) & LSR_RX_READY) {
+		(void)uart_read_reg(RHR);
+	}
+
+	/* TX-empty interrupts are only switched on while the TX ring has data */
+	tx_irq_on = 0;
+	uart_write_reg(IER, IER_RX_ENABLE);
+
+	uart_ready = 1;
+}
+
+static uint32_t uart_tx_free(void)
+{
+	return tx_ring.size - ringbuf_used(&tx_ring);
+}
+
+/*
+ * DESCRIPTION:
+ *	Check that len more bytes fit in the TX ring, so uart_write() of
+ *	them will not wait on the line. If they do not, remember the request:
+ *	the TX pump raises SOFTIRQ_PRINTK once that much room has drained.
+ *	Used by the printk flusher, which runs under the kernel lock.
+ * RETURN VALUE: 1 if the bytes fit now, 0 if the caller should retry later
+ */
+int uart_tx_room(size_t len)
+{
+	if (!uart_ready || uart_tx_free() >= len) {
+		return 1;
+	}
+	__atomic_store_n(&tx_room_wanted, (uint32_t)len, __ATOMIC_RELEASE);
+	/* the ring may have drained before the pump could see the request */
+	if (uart_tx_free() >= len) {
+		__atomic_store_n(&tx_room_wanted, 0, __ATOMIC_RELAXED);
+		return 1;
+	}
+	return 0;
+}
+
+/* Called by the pump: wake the printk flusher once its request fits */
+static void uart_tx_room_check(void)
+{
+	uint32_t want = __atomic_load_n(&tx_room_wanted, __ATOMIC_ACQUIRE);
+
+	if (want && uart_tx_free() >= want &&
+	    __atomic_exchange_n(&tx_room_wanted, 0, __ATOMIC_ACQ_REL)) {
+		raise_softirq(SOFTIRQ_PRINTK);
+	}
+}
+
+/*
+ * DESCRIPTION:
+ *	Move bytes from the TX ring into the hardware FIFO without ever waiting
+ *	on the line: if THR is empty we push up to one FIFO's worth, and leave
+ *	the TX-empty interrupt enabled while the ring still holds data so the
+ *	ISR will come back for the rest.
+ *	Called by producers right after they enqueue and by the ISR.
+ */
+static void uart_tx_pump(void)
+{
+	for (;;) {
+		if (__atomic_exchange_n(&tx_pumping, 1, __ATOMIC_ACQUIRE)) {
+			/* someone else is pumping; it re-checks the ring after unlocking */
+			return;
+		}
+
+		if (uart_read_reg(LSR) & LSR_TX_IDLE) {
+			uint8_t chunk[UART_FIFO_SIZE];
+			uint32_t n = ringbuf_get(&tx_ring, chunk, UART_FIFO_SIZE);
+			for (uint32_t i = 0; i < n; i++) {
+				uart_write_reg(THR, chunk[i]);
+			}
+		}
+
+		int pending = !ringbuf_empty(&tx_ring);
+		if (pending != tx_irq_on) {
+			tx_irq_on = pending;
+			uart_write_reg(IER, IER_RX_ENABLE | (pending ? IER_TX_ENABLE : 0));
+		}
+
+		__atomic_store_n(&tx_pumping, 0, __ATOMIC_RELEASE);
+
+		/*
+		 * A producer may have enqueued after we sampled the ring and found
+		 * the lock taken, or the ISR may have consumed the TX-empty event
+		 * while we held the lock. Only stop when the ring is empty or the
+		 * FIFO is still busy, in which case THRE will interrupt us again.
+		 */
+		if (ringbuf_empty(&tx_ring) ||
+		    (tx_irq_on && !(uart_read_reg(LSR) & LSR_TX_IDLE))) {
+			uart_tx_room_check();
+			return;
+		}
+	}
+}
+
+static void uart_rx_drain(void)
+{
+	int got = 0;
+
+	while (uart_read_reg(LSR) & LSR_RX_READY) {
+		uint8_t c = uart_read_reg(RHR);
+		if (ringbuf_put(&rx_ring, &c, 1) == 0) {
+			rx_overruns++;
+		}
+		got = 1;
+	}
+
+	if (got && !list_empty(&rx_wait.task_list)) {
+		if (rx_wake_stamp == 0) {
+			rx_wake_stamp = get_time();
+		}
+		wake_up_all(&rx_wait);
+	}
+}
+
+/*
+ * DESCRIPTION:
+ *	Queue len bytes for transmission. Returns as soon as the bytes are in
+ *	the TX ring; the hardware is fed asynchronously by the TX-empty
+ *	interrupt. Only when the ring is completely full do we fall back to
+ *	waiting for the FIFO to drain.
+ *	Before uart_init() runs, output still goes through the SBI console.
+ * RETURN VALUE: number of bytes written (always len)
+ */
+size_t uart_write(const char *buf, size_t len)
+{
+	if (!uart_ready) {
+		for (size_t i = 0; i < len; i++) {
+			sbi_console_putchar(buf[i]);
+		}
+		return len;
+	}
+
+	size_t done = 0;
+	while (done < len) {
+		done += ringbuf_put(&tx_ring, buf + done, len - done);
+		uart_tx_pump();
+		if (done < len) {
+			/* ring is full: nothing to do but wait for the FIFO */
+			while (!(uart_read_reg(LSR) & LSR_TX_IDLE))
+				;
+		}
+	}
+	return len;
+}
+
+/*
+ * DESCRIPTION:
+ *	Copy up to len already-received bytes into buf. Never blocks.
+ * RETURN VALUE: number of bytes copied, 0 if nothing is pending
+ */
+size_t uart_read(char *buf, size_t len)
+{
+	if (!uart_ready) {
+		return 0;
+	}
+
+	size_t n = ringbuf_get(&rx_ring, buf, len);
+
+	/* first read after a wake-up: account how long the reader took to run */
+	if (n > 0 && rx_wake_stamp != 0) {
+		uint64_t delta = get_time() - rx_wake_stamp;
+		rx_wake_stamp = 0;
+		rx_stats.wakeups++;
+		rx_stats.total_ticks += delta;
+		if (delta > rx_stats.max_ticks) {
+			rx_stats.max_ticks = delta;
+		}
+	}
+	return n;
+}
+
+/*
+ * DESCRIPTION:
+ *	Put the current task to sleep until the ISR receives more input.
+ *	Like sleep_on(), this does not return once the task sleeps: the caller
+ *	must have arranged to retry (sys_read restarts its ecall). It only
+ *	returns when input is already waiting in the ring.
+ */
+void uart_wait_rx(void)
+{
+	prepare_to_wait(&rx_wait);
+	if (!ringbuf_empty(&rx_ring)) {
+		finish_wait(&rx_wait);
+		return;
+	}
+	wait_for_wakeup();
+}
+
+void uart_get_rx_stats(struct uart_rx_stats *stats)
+{
+	*stats = rx_stats;
+	stats->overruns = rx_overruns;
+}
+
+size_t uart_rx_available(void)
+{
+	return uart_ready ? ringbuf_used(&rx_ring) : 0;
+}
+
+/*
+ * DESCRIPTION:
+ *	Synchronously push everything left in the TX ring out of the chip.
+ *	Used on paths that cannot rely on interrupts any more (panic).
+ */
+void uart_flush(void)
+{
+	if (!uart_ready) {
+		return;
+	}
+	while (!ringbuf_empty(&tx_ring)) {
+		while (!(uart_read_reg(LSR) & LSR_TX_IDLE))
+			;
+		uart_tx_pump();
+	}
+}
+
+/*
+ * DESCRIPTION:
+ *	UART interrupt handler, called from external_interrupt_handler()
+ *	after the PLIC claim. Keeps going until the chip reports no more
+ *	pending causes.
+ */
+void uart_isr(void)
+{
+	uint8_t isr;
+
+	while (!((isr = uart_read_reg(ISR)) & ISR_NO_INT)) {
+		switch (isr & ISR_ID_MASK) {
+		case ISR_RX_DATA:
+		case ISR_RX_TIMEOUT:
+			uart_rx_drain();
+			break;
+		case ISR_TX_EMPTY:
+			uart_tx_pump();
+			break;
+		case ISR_LINE:
+			(void)uart_read_reg(LSR);
+			break;
+		default:
+			return;
+		}
+	}
+}
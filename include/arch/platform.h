@@ -12,6 +12,15 @@
  */
 #define MAXNUM_CPU 8
 
+/* 缓存行大小 */
+#define CACHE_LINE_SIZE 64
+
+/*
+ * 每个 hart 的 per-CPU 数据（struct per_cpu_data）占 1 << PER_CPU_SHIFT
+ * 字节，start.S 用它找到本 hart 的那一项
+ */
+#define PER_CPU_SHIFT 10
+
 /*
  * MemoryMap
  * see https://github.com/qemu/qemu/blob/master/hw/riscv/virt.c, virt_memmap[] 
@@ -51,17 +60,21 @@
 #define PLIC_PRIORITY(id) (PLIC_BASE + (id) * 4)
 #define PLIC_PENDING(id) (PLIC_BASE + 0x1000 + ((id) / 32) * 4)
 
+/*
+ * Each hart owns two contexts (M and S), so per-hart strides are twice the
+ * per-context strides: 0x100 for enable bits, 0x2000 for threshold/claim.
+ */
 /* M-mode PLIC registers (keep for reference) */
-#define PLIC_MENABLE(hart) (PLIC_BASE + 0x2000 + (hart) * 0x80)
-#define PLIC_MTHRESHOLD(hart) (PLIC_BASE + 0x200000 + (hart) * 0x1000)
-#define PLIC_MCLAIM(hart) (PLIC_BASE + 0x200004 + (hart) * 0x1000)
-#define PLIC_MCOMPLETE(hart) (PLIC_BASE + 0x200004 + (hart) * 0x1000)
+#define PLIC_MENABLE(hart) (PLIC_BASE + 0x2000 + (hart) * 0x100)
+#define PLIC_MTHRESHOLD(hart) (PLIC_BASE + 0x200000 + (hart) * 0x2000)
+#define PLIC_MCLAIM(hart) (PLIC_BASE + 0x200004 + (hart) * 0x2000)
+#define PLIC_MCOMPLETE(hart) (PLIC_BASE + 0x200004 + (hart) * 0x2000)
 
 /* S-mode PLIC registers (what we should use in S-mode) */
-#define PLIC_SENABLE(hart) (PLIC_BASE + 0x2080 + (hart) * 0x80)
-#define PLIC_STHRESHOLD(hart) (PLIC_BASE + 0x201000 + (hart) * 0x1000)  
-#define PLIC_SCLAIM(hart) (PLIC_BASE + 0x201004 + (hart) * 0x1000)
-#define PLIC_SCOMPLETE(hart) (PLIC_BASE + 0x201004 + (hart) * 0x1000)
+#define PLIC_SENABLE(hart) (PLIC_BASE + 0x2080 + (hart) * 0x100)
+#define PLIC_STHRESHOLD(hart) (PLIC_BASE + 0x201000 + (hart) * 0x2000)
+#define PLIC_SCLAIM(hart) (PLIC_BASE + 0x201004 + (hart) * 0x2000)
+#define PLIC_SCOMPLETE(hart) (PLIC_BASE + 0x201004 + (hart) * 0x2000)
 
  /*
   * The Core Local INTerruptor (CLINT) block holds memory-mapped control and
@@ -106,6 +106,17 @@ static inline reg_t r_mcause()
 #define SSTATUS_SPP (1 << 8)   // Supervisor Previous Privilege
 #define SSTATUS_SPIE (1 << 5)  // Supervisor Previous Interrupt Enable
 #define SSTATUS_SIE (1 << 1)   // Supervisor Interrupt Enable
+#define SSTATUS_VS (3 << 9)    // Vector extension state (Off/Initial/Clean/Dirty)
+#define SSTATUS_VS_OFF (0 << 9)
+#define SSTATUS_VS_INITIAL (1 << 9)
+#define SSTATUS_VS_CLEAN (2 << 9)
+#define SSTATUS_VS_DIRTY (3 << 9)
+#define SSTATUS_FS (3 << 13)   // Floating-point unit state (Off/Initial/Clean/Dirty)
+#define SSTATUS_FS_OFF (0 << 13)
+#define SSTATUS_FS_INITIAL (1 << 13)
+#define SSTATUS_FS_CLEAN (2 << 13)
+#define SSTATUS_FS_DIRTY (3 << 13)
+#define SSTATUS_SUM (1 << 18)  // permit Supervisor User Memory access
 
 static inline reg_t r_sstatus()
 {
@@ -119,6 +130,20 @@ static inline void w_sstatus(reg_t x)
 	asm volatile("csrw sstatus, %0" : : "r" (x));
 }
 
+/* 关闭本 hart 的 S 态中断，返回关闭前的 SIE 位，供 local_irq_restore 使用 */
+static inline reg_t local_irq_save(void)
+{
+	reg_t x;
+	asm volatile("csrrci %0, sstatus, %1" : "=r" (x) : "i" (SSTATUS_SIE) : "memory");
+	return x & SSTATUS_SIE;
+}
+
+static inline void local_irq_restore(reg_t flags)
+{
+	if (flags)
+		asm volatile("csrsi sstatus, %0" : : "i" (SSTATUS_SIE) : "memory");
+}
+
 /* Supervisor Exception Program Counter */
 static inline void w_sepc(reg_t x)
 {
@@ -162,6 +187,29 @@ static inline void w_sie(reg_t x)
 #define SIE_STIE (1 << 5)  /* Supervisor timer interrupt enable */
 #define SIE_SSIE (1 << 1)  /* Supervisor software interrupt enable */
 
+/* Supervisor Counter-Enable: which counters U-mode may read */
+#define SCOUNTEREN_CY (1 << 0)  /* cycle */
+#define SCOUNTEREN_TM (1 << 1)  /* time */
+#define SCOUNTEREN_IR (1 << 2)  /* instret */
+
+static inline void w_scounteren(reg_t x)
+{
+	asm volatile("csrw scounteren, %0" : : "r" (x));
+}
+
+/* Supervisor Interrupt Pending */
+#define SIP_SSIP (1 << 1)  /* Supervisor software interrupt pending */
+
+static inline void set_sip(reg_t x)
+{
+	asm volatile("csrs sip, %0" : : "r" (x) : "memory");
+}
+
+static inline void clear_sip(reg_t x)
+{
+	asm volatile("csrc sip, %0" : : "r" (x) : "memory");
+}
+
 /* Supervisor Cause Register */
 static inline reg_t r_scause()
 {
@@ -178,11 +226,17 @@ static inline reg_t r_stval()
 	return x;
 }
 
-/* Hart ID through tp register (set by OpenSBI in start.S) */
+/* Supervisor Address Translation and Protection */
+#define SATP_SV39 (8L << 60)
+#define MAKE_SATP(pagetable) (SATP_SV39 | (((reg_t)(pagetable)) >> 12))
+#define SATP_ASID_SHIFT 44
+#define SATP_ASID_MASK (0xffffL << SATP_ASID_SHIFT)
+
+/* Hart ID: tp points to this hart's per-CPU data, which starts with it (start.S) */
 static inline reg_t r_hartid()
 {
 	reg_t x;
-	asm volatile("mv %0, tp" : "=r" (x) );
+	asm volatile("ld %0, 0(tp)" : "=r" (x) );
 	return x;
 }
 
@@ -16,6 +16,13 @@
 
 /* SBI Extension IDs */
 #define SBI_EXT_HSM             0x48534D
+#define SBI_EXT_IPI             0x735049
+#define SBI_EXT_RFENCE          0x52464E43
+
+/* SBI RFENCE Extension Function IDs */
+#define SBI_RFENCE_REMOTE_FENCE_I          0x0
+#define SBI_RFENCE_REMOTE_SFENCE_VMA       0x1
+#define SBI_RFENCE_REMOTE_SFENCE_VMA_ASID  0x2
 
 /* SBI HSM (Hart State Management) Extension Function IDs */
 #define SBI_HSM_HART_START      0x0
@@ -87,6 +94,26 @@ static inline struct sbiret sbi_ext_call(long eid, long fid, long arg0, long arg
     return (struct sbiret){.error = a0, .value = a1};
 }
 
+/* 最多 5 个参数的扩展调用（RFENCE 需要） */
+static inline struct sbiret sbi_ext_call5(long eid, long fid, long arg0, long arg1,
+                                          long arg2, long arg3, long arg4)
+{
+    register long a0 asm("a0") = arg0;
+    register long a1 asm("a1") = arg1;
+    register long a2 asm("a2") = arg2;
+    register long a3 asm("a3") = arg3;
+    register long a4 asm("a4") = arg4;
+    register long a6 asm("a6") = fid;
+    register long a7 asm("a7") = eid;
+
+    asm volatile("ecall"
+                 : "+r"(a0), "+r"(a1)
+                 : "r"(a2), "r"(a3), "r"(a4), "r"(a6), "r"(a7)
+                 : "memory");
+
+    return (struct sbiret){.error = a0, .value = a1};
+}
+
 /* SBI便利函数 - Legacy接口 */
 static inline void sbi_console_putchar(int ch)
 {
@@ -113,9 +140,10 @@ static inline void sbi_clear_ipi(void)
     sbi_legacy_call(SBI_CLEAR_IPI, 0, 0, 0);
 }
 
+/* IPI 扩展按值传递掩码；legacy 的 SBI_SEND_IPI 要的是掩码的地址 */
 static inline void sbi_send_ipi(unsigned long hart_mask, unsigned long hart_mask_base)
 {
-    sbi_legacy_call(SBI_SEND_IPI, hart_mask, hart_mask_base, 0);
+    sbi_ext_call(SBI_EXT_IPI, 0, hart_mask, hart_mask_base, 0);
 }
 
 /* Get current time via SBI - note: this is not a standard SBI call
@@ -127,14 +155,36 @@ static inline uint64_t sbi_get_time(void)
     return time;
 }
 
-/* Get current hart ID from tp register (set by OpenSBI) */
+/*
+ * Get current hart ID (passed by OpenSBI in a0). In the kernel tp points
+ * to this hart's struct per_cpu_data, whose first field is the hart ID.
+ */
 static inline long sbi_get_hartid(void)
 {
     long hart_id;
-    asm volatile("mv %0, tp" : "=r"(hart_id));
+    asm volatile("ld %0, 0(tp)" : "=r"(hart_id));
     return hart_id;
 }
 
+/*
+ * SBI RFENCE：让 hart_mask 中的 hart 刷新 [start, start + size) 的 TLB 项，
+ * start 和 size 都为 0（或 size 为 -1）时刷新全部。返回时远端已经完成刷新。
+ */
+static inline struct sbiret sbi_remote_sfence_vma(unsigned long hart_mask, unsigned long hart_mask_base,
+                                                  unsigned long start, unsigned long size)
+{
+    return sbi_ext_call5(SBI_EXT_RFENCE, SBI_RFENCE_REMOTE_SFENCE_VMA,
+                         hart_mask, hart_mask_base, start, size, 0);
+}
+
+static inline struct sbiret sbi_remote_sfence_vma_asid(unsigned long hart_mask, unsigned long hart_mask_base,
+                                                       unsigned long start, unsigned long size,
+                                                       unsigned long asid)
+{
+    return sbi_ext_call5(SBI_EXT_RFENCE, SBI_RFENCE_REMOTE_SFENCE_VMA_ASID,
+                         hart_mask, hart_mask_base, start, size, asid);
+}
+
 /* SBI HSM (Hart State Management) functions */
 
 static inline struct sbiret sbi_hart_start(unsigned long hartid, unsigned long start_addr, unsigned long opaque)
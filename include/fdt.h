@@ -73,6 +73,7 @@ void *fdt_get_property(void *fdt, int nodeoffset, const char *name, int *lenp);
 int fdt_path_offset(void *fdt, const char *path);
 const char *fdt_get_name(void *fdt, int nodeoffset, int *lenp);
 uint64_t fdt_read_number(const void *cell, int size);
+void *fdt_get_cpu_property(void *fdt, uint64_t hartid, const char *name, int *lenp);
 
 /* Boot and device initialization */
 void boot_info_init(void);
@@ -19,5 +19,6 @@
 
 // kernel/main.c
 void start_kernel(void);
+void secondary_start_kernel(long hartid);
 
 #endif /* __KERNEL_H__ */
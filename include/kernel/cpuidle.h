@@ -0,0 +1,24 @@
+#ifndef __KERNEL_CPUIDLE_H__
+#define __KERNEL_CPUIDLE_H__
+
+#include "kernel/types.h"
+
+/*
+ * 空闲状态管理（kernel/cpuidle.c）
+ *
+ * 空闲循环每次等待时由 governor 选一个空闲状态：wfi、SBI HSM 保持型
+ * 挂起、非保持型挂起，越深越省电，退出也越慢。预测的空闲时间取到下一个
+ * 定时器到期的时间和本 hart 最近几次实际空闲时间的平均值中较小的一个，
+ * 选 target_residency 不超过它的最深状态；被隔离的 hart 还要求退出足够快。
+ * 其它 hart 用 IPI 唤醒它。各状态的统计在 struct kstats 的 idle[] 里。
+ */
+
+#define CPUIDLE_WFI        0
+#define CPUIDLE_RETENTIVE  1
+#define CPUIDLE_NONRET     2
+#define CPUIDLE_NR_STATES  3
+
+void cpuidle_enter(uint64_t next_event);
+void cpuidle_kick(int hart);
+
+#endif /* __KERNEL_CPUIDLE_H__ */
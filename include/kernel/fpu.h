@@ -0,0 +1,38 @@
+#ifndef __KERNEL_FPU_H__
+#define __KERNEL_FPU_H__
+
+#include "kernel/types.h"
+#include "kernel/sched.h"
+
+/*
+ * Lazy FP/vector state (kernel/fpu.c)
+ *
+ * Tasks start with sstatus.FS/VS = Off. The first FP or vector
+ * instruction traps as illegal; the handler loads the task's registers
+ * and makes it the owner of the unit on this hart. Registers are only
+ * written back when another task claims the unit, so tasks that never
+ * use FP, or that share a hart with just one FP user, never pay for it.
+ */
+
+struct fpu_stats {
+	uint64_t fp_traps;	// first-use traps that gave a task the FPU
+	uint64_t fp_saves;	// register files written back to a task
+	uint64_t v_traps;
+	uint64_t v_saves;
+};
+
+extern void fpu_switch(struct task_struct *prev, struct task_struct *next);
+extern int fpu_trap(reg_t epc);
+extern void fpu_task_release(int task_id);
+extern void fpu_migrate(int task_id, int from_hart);
+extern void fpu_hart_flush(void);
+extern void vector_evict_user(int live_dirty);
+extern void fpu_get_stats(struct fpu_stats *stats);
+
+/* arch/riscv/fpu.S and arch/riscv/vector.S, need FS/VS switched on */
+extern void fpu_save(struct fp_context *fp);
+extern void fpu_restore(const struct fp_context *fp);
+extern void vstate_save(struct v_context *v);
+extern void vstate_restore(const struct v_context *v);
+
+#endif /* __KERNEL_FPU_H__ */
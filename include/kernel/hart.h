@@ -13,15 +13,44 @@
 #define __HART_H__
 
 #include "kernel/types.h"
+#include "arch/platform.h"
+#include "uapi/stats.h"
 
-// 每个核心的私有数据结构
-// 使用 __attribute__((aligned(16))) 确保对齐
+/*
+ * 每个 hart 私有的数据
+ *
+ * 内核态的 tp 始终指向本 hart 的 cpu_data_area[] 项：start.S 在进入 C
+ * 代码之前装入，之后陷阱入口从 ctx.ktp 装回（用户态的 tp 是任务的 TLS）。
+ * 每一项占 1 << PER_CPU_SHIFT 字节并按缓存行对齐，本 hart 频繁读写的
+ * 数据不会和别的 hart 的落在同一个缓存行里。
+ *
+ * 本 hart 用 this_cpu_read()/this_cpu_write()/this_cpu_inc() 访问，编译
+ * 出来就是一条以 tp 为基址的 ld/sd；别的 hart 的用 per_cpu(hart, field)，
+ * 只用于偶尔的读（比如挑一个空闲的 hart）。
+ *
+ * 这里只放每个 hart 自己在调度、定时器和中断路径上要改的状态。运行队列
+ * 和定时器链表不在其中：整个系统只有一个运行队列（kernel/sched.c 的
+ * run_queue）和一条定时器链表（kernel/timer.c，只有 timer_hart 处理），
+ * 都由内核锁保护。每个 hart 一个运行队列、各自的定时器队列以及相应的
+ * 负载均衡不在 per-CPU 数据区的范围内。
+ */
 struct per_cpu_data {
-    long hart_id;
-    // 未来可以添加:
-    // struct task *current_task;
-    // int scheduler_ticks;
-};
+    long hart_id;               // 偏移 0，start.S 写入
+    /* 调度 */
+    int current_task;           // 正在运行的任务，-1 表示没有（current_task_id）
+    volatile int idle_running;  // 在空闲循环里
+    volatile int leaving;       // 正在下线，回到空闲循环时停下（sched_hart_offline()）
+    /* 中断 */
+    int irq_depth;              // trap_handler() 的嵌套深度
+    int lock_depth;             // spin_lock() 的嵌套深度
+    reg_t lock_flags;           // 最外层 spin_lock() 之前的中断状态
+    volatile unsigned long softirq_pending;
+    /* 定时器 */
+    uint64_t timer_deadline;    // 本 hart 上次设置的定时器，没有时为 TIMER_NEVER
+    uint64_t sample_deadline;   // 下一次采样（kernel/profile.c），不采样时为 TIMER_NEVER
+    /* 统计计数器（kernel/stats.h） */
+    struct kstats stats;
+} __attribute__((aligned(1 << PER_CPU_SHIFT)));
 
 // 全局的 per-CPU 数据区，汇编代码会通过名字来引用它
 extern struct per_cpu_data cpu_data_area[MAXNUM_CPU];
@@ -29,14 +58,44 @@ extern struct per_cpu_data cpu_data_area[MAXNUM_CPU];
 /**
  * @brief 获取当前核心的per_cpu_data结构体指针
  * @return 指向当前核心per_cpu_data的指针
+ * @note 不是 volatile：内核态的 tp 在一个函数执行期间不会变，编译器可以
+ *       把多次读取合并成一次。
  */
 static inline struct per_cpu_data* get_cpu_data(void) {
     struct per_cpu_data *ptr;
     // 从 tp 寄存器读取指针
-    asm volatile("mv %0, tp" : "=r"(ptr));
+    asm("mv %0, tp" : "=r"(ptr));
     return ptr;
 }
 
+#define this_cpu_read(field)        (get_cpu_data()->field)
+#define this_cpu_write(field, val)  (get_cpu_data()->field = (val))
+/* 只有本 hart 写，不需要原子操作 */
+#define this_cpu_inc(field)         (get_cpu_data()->field++)
+#define per_cpu(hart, field)        (cpu_data_area[(hart)].field)
+
+/* 让变量或结构从缓存行边界开始；结构的大小也会补齐到整数个缓存行 */
+#define __cacheline_aligned __attribute__((aligned(CACHE_LINE_SIZE)))
+
+/*
+ * 模块私有的、每个 hart 一份的变量：每份单独占缓存行，避免相邻 hart
+ * 的写互相干扰。用 this_cpu_var(name) 和 per_cpu_var(name, hart) 访问。
+ */
+#define DEFINE_PER_CPU(type, name) \
+    struct { type v; } __cacheline_aligned name[MAXNUM_CPU]
+#define this_cpu_var(name)          (name[this_hart()].v)
+#define per_cpu_var(name, hart)     (name[(hart)].v)
+
+/**
+ * @brief 当前 hart 在各个 per-hart 数组中的下标
+ * @details
+ *   从本 hart 的 per-CPU 数据中读取。越界时退回到 0 号槽位，而不是写坏
+ *   相邻数据。
+ */
+static inline int this_hart(void) {
+    unsigned long id = this_cpu_read(hart_id);
+    return id < MAXNUM_CPU ? (int)id : 0;
+}
 
 /**
  * @brief 启动指定的Hart并等待其进入运行状态
@@ -69,4 +128,16 @@ void hart_print_status_all(void);
  */
 int hart_suspend_self(unsigned long suspend_type, unsigned long resume_addr, unsigned long opaque);
 
+/**
+ * @brief 从启动参数 isolcpus= 中读取要隔离的 hart
+ */
+void hart_isolation_init(void);
+
+/**
+ * @brief 被隔离的 hart 的掩码
+ * @details 隔离的 hart 没有调度节拍、不刷新 printk、不接收外部中断，
+ *          只运行显式绑定在上面的任务。
+ */
+unsigned long hart_isolated_mask(void);
+
 #endif /* __HART_H__ */
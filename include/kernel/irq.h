@@ -3,5 +3,16 @@
 
 extern int plic_claim(void);
 extern void plic_complete(int irq);
+extern void plic_migrate_from(int hart);
+
+/*
+ * Softirqs: low-priority work that runs from the S-mode software interrupt
+ * the next time this hart has interrupts enabled (kernel/trap.c).
+ */
+#define SOFTIRQ_RESCHED	0	/* call schedule() */
+#define SOFTIRQ_PRINTK	1	/* drain the printk log buffer */
+
+extern void raise_softirq(int nr);
+extern void do_softirq(void);
 
 #endif /* __KERNEL_IRQ_H__ */
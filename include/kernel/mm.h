@@ -12,6 +12,7 @@
 // Page descriptor structure (exposed for testing)
 struct Page {
     uint8_t flags;
+    uint8_t shares;     // 除第一个使用者外共享这一页的次数（写时复制）
 };
 
 // Page flags
@@ -22,8 +23,25 @@ struct Page {
 void page_init(void);
 // 分配指定数量的连续物理页
 void *page_alloc(int npages);
+// page_alloc_flags() 的标志
+#define PAGE_ZERO 0x1   // 返回清零的页面；单页时先取预清零页池
+void *page_alloc_flags(int npages, int flags);
 // 释放一个通过 page_alloc 分配的内存块
 void page_free(void *p);
+// 单页的引用计数：page_get 增加一个共享者，page_put 减少一个，最后一个放手时才释放
+void page_get(void *p);
+void page_put(void *p);
+int page_refs(void *p);
+
+// 预清零页池：空闲循环调用 page_pool_refill() 补充一页，池满时返回 0
+struct page_pool_stats {
+    uint64_t pool_hits;     // PAGE_ZERO 单页分配直接从池中取得
+    uint64_t sync_zeroed;   // PAGE_ZERO 分配只能当场清零
+    uint64_t refills;
+    int count;              // 池中现有的页数
+};
+int page_pool_refill(void);
+void page_pool_get_stats(struct page_pool_stats *out);
 
 // Utility functions (exposed for testing)
 uint32_t _align_page(uint32_t address);
@@ -45,4 +63,33 @@ void print_free_list(void);
 void print_block(void *ptr);
 
 
+/* --- 用户态内存 (sbrk / mmap, mm/mmap.c 和 mm/vm.c) --- */
+
+// 每个任务同时存在的匿名映射数上限
+#define TASK_MAX_MMAPS 16
+
+struct mm_region {
+    uintptr_t start;    // 0 表示空槽
+    size_t npages;
+};
+
+// 任务的用户态内存，嵌在 task_struct 里
+struct task_mm {
+    uint64_t *pagetable;    // Sv39 根页表，NULL 表示还没用过 sbrk/mmap
+    unsigned long asid;     // 页表的 ASID，0 表示硬件 ASID 不够用
+    unsigned long cpu_mask; // 运行过这个任务、TLB 里可能有它的表项的 hart
+    uintptr_t brk;          // 当前的 program break
+    struct mm_region mmaps[TASK_MAX_MMAPS];
+    uint32_t pages;         // 已经分配了物理页的用户页数
+    uint32_t pt_pages;      // 页表自身占用的页数
+    uint64_t minor_faults;  // 第一次访问时分配页面的次数
+    uint64_t cow_faults;    // 写时复制页上的写缺页次数
+    uint64_t cow_copies;    // 其中真正复制了页面的次数
+};
+
+struct task_struct;
+// 任务退出时归还它的堆和全部映射
+void mm_task_release(struct task_struct *task);
+
+
 #endif /* __KERNEL_MM_H__ */
\ No newline at end of file
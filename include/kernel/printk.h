@@ -7,5 +7,9 @@
 int vprintk(const char *fmt, va_list args);
 int printk(const char *fmt, ...);
 void panic(const char *s);
+void printk_flush(void);
+void printk_softirq(void);
+void printk_tick(void);
+void printk_enable_deferred(void);
 
 #endif /* __KERNEL_PRINTK_H__ */
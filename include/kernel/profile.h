@@ -0,0 +1,24 @@
+#ifndef __KERNEL_PROFILE_H__
+#define __KERNEL_PROFILE_H__
+
+#include "kernel/types.h"
+#include "uapi/profile.h"
+
+/*
+ * 时钟中断驱动的采样分析器（kernel/profile.c）
+ *
+ * 每个 hart 的采样时间记在 per-CPU 的 sample_deadline 里，timer.c 把
+ * 硬件定时器设成它和定时器链表到期时间中较早的一个；不处理定时器链表
+ * 的 hart 只在采样期间打开时钟中断。样本放在每个 hart 自己的环形缓冲区
+ * 里，满了就丢弃并计数。
+ *
+ * 内核除了空闲循环都关着中断运行，采样的时钟中断要等回到用户态或进入
+ * 空闲循环才会被处理。所以 'K' 样本只来自空闲循环；系统调用里花的时间
+ * 在返回用户态时采到，算在 ecall 之后那条指令的 pc 上，陷阱处理同理。
+ * 内核函数本身的耗时从样本里看不出来。
+ */
+
+void profile_tick(reg_t epc, int user);
+long profile_count(int task);
+
+#endif /* __KERNEL_PROFILE_H__ */
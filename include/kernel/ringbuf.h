@@ -0,0 +1,36 @@
+#ifndef __KERNEL_RINGBUF_H__
+#define __KERNEL_RINGBUF_H__
+
+#include "kernel/types.h"
+
+/*
+ * 无锁字节环形缓冲区
+ *
+ * head/commit/tail 都是自由递增的 32 位计数器，通过 (size - 1) 取模定位，
+ * 因此 size 必须是 2 的幂。
+ *   - head:   生产者已预留到的位置（多个生产者通过 CAS 争用）
+ *   - commit: 已经写完、对消费者可见的位置
+ *   - tail:   消费者已读取到的位置（只允许一个消费者）
+ *
+ * 生产者之间不加锁：先用 CAS 预留一段空间再拷贝数据，最后按预留顺序推进 commit。
+ * 消费者只读取 [tail, commit) 之间的数据，因此不会看到写了一半的内容。
+ */
+struct ringbuf {
+    volatile uint32_t head;
+    volatile uint32_t commit;
+    volatile uint32_t tail;
+    uint32_t size;
+    uint8_t *data;
+};
+
+void ringbuf_init(struct ringbuf *rb, uint8_t *storage, uint32_t size);
+uint32_t ringbuf_put(struct ringbuf *rb, const void *src, uint32_t len);
+uint32_t ringbuf_get(struct ringbuf *rb, void *dst, uint32_t len);
+uint32_t ringbuf_used(struct ringbuf *rb);
+
+static inline int ringbuf_empty(struct ringbuf *rb)
+{
+    return ringbuf_used(rb) == 0;
+}
+
+#endif /* __KERNEL_RINGBUF_H__ */
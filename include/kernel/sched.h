@@ -3,6 +3,8 @@
 
 #include "kernel/types.h"
 #include "kernel/list.h"
+#include "kernel/mm.h"
+#include "kernel/hart.h"
 
 /* task management */
 struct context
@@ -42,6 +44,31 @@ struct context
 	// save the pc to run in next schedule cycle
 	reg_t pc;	   // offset: 31 * 8 = 248 (64-bit)
 	reg_t sstatus; // S-mode status register (was mstatus) - offset: 32 * 8 = 256 (64-bit)
+	// 内核态使用的 tp（本 hart 的 per-CPU 数据），trap_vector 进入时装入 - offset: 33 * 8 = 264
+	reg_t ktp;
+	// 返回用户态时装入的 satp，0 表示不使用页表 - offset: 34 * 8 = 272
+	reg_t satp;
+};
+
+/*
+ * FP and vector registers are not part of the trap frame: they are saved
+ * and restored lazily, only for tasks that use them (kernel/fpu.c).
+ */
+struct fp_context
+{
+	uint64_t f[32];
+	uint64_t fcsr;		// offset: 32 * 8 = 256
+};
+
+#define VLENB_MAX 64	/* largest VLEN/8 whose registers fit in v_context */
+
+struct v_context
+{
+	uint64_t vstart;
+	uint64_t vl;
+	uint64_t vtype;
+	uint64_t vcsr;
+	uint8_t v[32 * VLENB_MAX];	// offset: 32, v0..v31 back to back
 };
 
 typedef enum
@@ -49,26 +76,58 @@ typedef enum
 	TASK_INVALID,
 	TASK_READY,
 	TASK_RUNNING,
-	TASK_SLEEPING,
+	TASK_SLEEPING,	/* timed sleep, woken by a timer (task_delay) */
+	TASK_BLOCKED,	/* waiting on a wait_queue_head */
 	TASK_EXITED
 } task_state;
 
+/*
+ * 字段按谁来访问分组，整个结构按缓存行对齐，tasks[] 中相邻的任务不共享
+ * 缓存行：
+ *   - 调度字段放在第一个缓存行里：每个 hart 的 pick_next_task() 和
+ *     resched_for() 都要读，状态变化时写；
+ *   - 陷阱上下文从下一个缓存行开始，只有正在运行它的 hart 在陷阱入口
+ *     和返回时读写，不会让别的 hart 挑任务时读的行失效；
+ *   - 其余的字段只在运行它的 hart 上更新，或者很少访问。
+ */
 struct task_struct
 {
-	struct context ctx;
-	void *param;
-	void (*start_routine)(void *param);
-	uint8_t priority;
+	/* 调度 */
 	task_state state;
+	uint8_t priority;
+	volatile int on_cpu;	// 某个 hart 还在用它的栈，switch_to() 离开时清零
+	int cpu;		// 上次运行的 hart，-1 表示还没运行过
 	uint32_t timeslice;
 	uint32_t remaining_timeslice;
-
-	// Node for the run queue
+	unsigned long affinity;	// 允许运行的 hart 掩码
+	// Node for the run queue (or a wait queue while TASK_BLOCKED)
 	struct list_head run_queue_node;
+	uintptr_t wait_key;	// object the task is blocked on, see prepare_to_wait_key()
+
+	/* 陷阱上下文 */
+	struct context ctx __cacheline_aligned;
+
+	uint64_t syscalls;	// 进入 do_syscall() 的次数
+	uint32_t migrations;	// 换到另一个 hart 上运行的次数
+	void *param;
+	void (*start_routine)(void *param);
+	struct task_mm mm;	// sbrk 堆和匿名映射
+
+	struct fp_context fp;	// saved copies, stale while the task owns the live registers
+	struct v_context v;
+} __cacheline_aligned;
+
+/* wait queue: tasks blocked until an event, linked through run_queue_node */
+struct wait_queue_head
+{
+	struct list_head task_list;
 };
 
+#define WAIT_QUEUE_HEAD_INIT(name) { LIST_HEAD_INIT((name).task_list) }
+
 #define DEFAULT_TIMESLICE 2
 #define MAX_PRIORITY 32
+#define AFFINITY_ALL ((1UL << MAXNUM_CPU) - 1)
 
 /* scheduler functions */
 void sched_init(void);
@@ -78,10 +137,32 @@ void task_delay(uint32_t ticks);
 void task_yield(void);
 void task_exit(int status);
 int get_current_task_id(void);
+void init_waitqueue_head(struct wait_queue_head *wq);
+void prepare_to_wait(struct wait_queue_head *wq);
+void prepare_to_wait_key(struct wait_queue_head *wq, uintptr_t key);
+void finish_wait(struct wait_queue_head *wq);
+void wait_for_wakeup(void);
+void sleep_on(struct wait_queue_head *wq);
+int wake_up_one(struct wait_queue_head *wq);
+int wake_up_all(struct wait_queue_head *wq);
+int wake_up_key(struct wait_queue_head *wq, uintptr_t key, int nr);
 void print_tasks(void);
+int task_set_affinity(int task_id, unsigned long mask);
+int task_get_affinity(int task_id, unsigned long *mask);
+int task_get_cpu(int task_id);
+void *task_get_entry(int task_id);
+void kernel_scheduler(void);
+void scheduler_tick(void);
+int sched_hart_offline(int hart);
+int sched_hart_online(int hart);
 
 /* global variables */
-extern int current_task_id;
+/*
+ * 本 hart 上正在运行的任务，-1 表示没有；别的 hart 的用 per_cpu(hart, current_task)。
+ * 只能在内核态使用：它通过 tp 读 per-CPU 数据，用户态的 tp 指向任务的 TLS，
+ * 读到的是 TLS 里的内容。用户态用 getpid()。
+ */
+#define current_task_id (get_cpu_data()->current_task)
 extern struct task_struct tasks[];
 
 /* user tasks */
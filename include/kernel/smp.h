@@ -0,0 +1,35 @@
+#ifndef __KERNEL_SMP_H__
+#define __KERNEL_SMP_H__
+
+#include "kernel/types.h"
+
+/*
+ * 跨 hart 函数调用（kernel/smp.c）
+ *
+ * 每个 hart 有一条无锁的调用队列。smp_call_function() 把调用挂到目标
+ * hart 的队列上，只有队列原来为空时才需要发 IPI：目标还没处理完上一个
+ * IPI 时，新的调用跟着一起执行。目标在软件中断（do_softirq()）里按
+ * 入队顺序执行队列中的函数，此时中断关闭，函数不能睡眠。
+ *
+ * hart 在 trap_init() 之后才能接收调用，smp_hart_offline() 之后不再接收；
+ * 不在线的 hart 被忽略。
+ */
+
+typedef void (*smp_call_func_t)(void *arg);
+
+struct smp_stats {
+    uint64_t calls;         // 发往其它 hart 的调用
+    uint64_t ipis;          // 实际发出的 IPI（每个目标 hart 算一次）
+    uint64_t handled;       // 在本 hart 上执行的远程调用
+};
+
+void smp_hart_online(long hartid);
+void smp_hart_offline(long hartid);
+unsigned long smp_online_mask(void);
+int smp_call_function(unsigned long hart_mask, smp_call_func_t func, void *arg, int wait);
+void smp_call_handle(void);
+void smp_send_reschedule(int hart);
+void smp_timer_arm(int hart, uint64_t when);
+void smp_get_stats(struct smp_stats *out);
+
+#endif /* __KERNEL_SMP_H__ */
@@ -3,5 +3,11 @@
 
 extern int spin_lock(void);
 extern int spin_unlock(void);
+extern void spin_lock_reset(void);
+
+/* held across every trap handler once several harts run tasks */
+extern void kernel_lock(void);
+extern void kernel_unlock(void);
+extern void kernel_lock_drop(void);
 
 #endif /* __KERNEL_SPINLOCK_H__ */
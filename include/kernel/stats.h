@@ -0,0 +1,21 @@
+#ifndef __KERNEL_STATS_H__
+#define __KERNEL_STATS_H__
+
+#include "kernel/types.h"
+#include "kernel/hart.h"
+#include "uapi/stats.h"
+
+/*
+ * 每个 hart 的统计计数器（kernel/stats.c）
+ *
+ * 计数器是 per-CPU 数据区里的 struct kstats，stat_inc() 编译出来就是一条
+ * 以 tp 为基址的读改写，不加锁也不用原子指令：只有本 hart 写自己的那份，
+ * 而内核在陷阱处理中关着中断，不会在读改写的中间被打断。
+ */
+
+#define stat_inc(field)     this_cpu_inc(stats.field)
+#define stat_add(field, n)  (get_cpu_data()->stats.field += (n))
+
+void stats_snapshot(int hart, struct kstats *out);
+
+#endif /* __KERNEL_STATS_H__ */
@@ -14,6 +14,9 @@ typedef struct timer
 /* interval ~= 1s, use generic timer frequency */
 #define TIMER_INTERVAL 10000000UL
 
+/* timer_next_event() when no timer interrupt is coming */
+#define TIMER_NEVER ((uint64_t)-1)
+
 extern timer *timers, *next_timer;
 
 extern uint64_t get_time(void);  // Renamed from get_mtime, returns 64-bit time
@@ -26,5 +29,8 @@ extern timer *timer_create(
 	void *arg,
 	uint32_t timeout);
 extern void timer_delete(timer *timer);
+extern void timer_set_sample(uint64_t when);
+extern uint64_t timer_next_event(void);
+extern void timer_migrate_from(int hart);
 
 #endif /* __KERNEL_TIMER_H__ */
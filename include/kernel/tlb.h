@@ -0,0 +1,46 @@
+#ifndef __KERNEL_TLB_H__
+#define __KERNEL_TLB_H__
+
+#include "kernel/types.h"
+
+/*
+ * TLB 刷新（mm/tlb.c）
+ *
+ * 修改用户页表之后，要刷新所有可能缓存了旧表项的 hart：本 hart 直接
+ * sfence.vma，其它 hart 通过 SBI RFENCE 一次调用发给整个 hart 掩码。
+ * tlb_batch 先收集要刷新的页，相邻的页合并成一段，每段只发一次 RFENCE；
+ * 页数超过 TLB_FLUSH_ALL_PAGES 或段数用完时改为刷新整个 ASID。
+ */
+
+#define TLB_BATCH_RANGES    8
+#define TLB_FLUSH_ALL_PAGES 64
+
+struct tlb_range {
+    uintptr_t start;
+    uintptr_t end;
+};
+
+struct tlb_batch {
+    unsigned long hart_mask;
+    unsigned long asid;     // 0 表示不用 ASID，刷新所有地址空间的表项
+    int nranges;
+    int full;
+    size_t pages;
+    struct tlb_range ranges[TLB_BATCH_RANGES];
+};
+
+struct tlb_stats {
+    uint64_t local_pages;   // 本 hart 按页刷新的次数
+    uint64_t local_full;    // 本 hart 整体刷新的次数
+    uint64_t rfence_calls;  // 发出的 SBI RFENCE 调用
+    uint64_t full_fallbacks;// 因为页数太多改成整体刷新的批次
+};
+
+void tlb_batch_init(struct tlb_batch *b, unsigned long hart_mask, unsigned long asid);
+void tlb_batch_add(struct tlb_batch *b, uintptr_t va);
+void tlb_batch_flush(struct tlb_batch *b);
+void tlb_flush_page(unsigned long hart_mask, unsigned long asid, uintptr_t va);
+void tlb_flush_asid(unsigned long hart_mask, unsigned long asid);
+void tlb_get_stats(struct tlb_stats *out);
+
+#endif /* __KERNEL_TLB_H__ */
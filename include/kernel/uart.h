@@ -0,0 +1,18 @@
+#ifndef __KERNEL_UART_H__
+#define __KERNEL_UART_H__
+
+#include "kernel/types.h"
+#include "uapi/uart.h"
+
+/* 16550 UART driver (drivers/uart.c) */
+void uart_init(void);
+void uart_isr(void);
+size_t uart_write(const char *buf, size_t len);
+int uart_tx_room(size_t len);
+size_t uart_read(char *buf, size_t len);
+size_t uart_rx_available(void);
+void uart_flush(void);
+void uart_wait_rx(void);
+void uart_get_rx_stats(struct uart_rx_stats *stats);
+
+#endif /* __KERNEL_UART_H__ */
@@ -0,0 +1,26 @@
+#ifndef __KERNEL_VECTOR_H__
+#define __KERNEL_VECTOR_H__
+
+#include "kernel/types.h"
+
+/* set by vector_init() when the boot hart's ISA string lists V */
+extern int has_vector;
+extern unsigned long vector_vlenb;	/* VLEN / 8, 0 without V */
+
+/*
+ * Bracket kernel use of the vector unit. kernel_vector_begin() returns 0
+ * when V is not present; otherwise it disables interrupts, saves any
+ * user vector state still in the registers, turns sstatus.VS on and
+ * returns 1, and the caller must finish with kernel_vector_end(flags).
+ */
+extern int kernel_vector_begin(reg_t *flags);
+extern void kernel_vector_end(reg_t flags);
+
+/* arch/riscv/vector.S, only valid between begin and end */
+extern void *vec_memcpy(void *dest, const void *src, size_t n);
+extern void *vec_memset(void *s, int c, size_t n);
+extern int vec_memcmp(const void *s1, const void *s2, size_t n);
+extern size_t vec_strlen(const char *s);
+extern unsigned long vec_vlenb(void);
+
+#endif /* __KERNEL_VECTOR_H__ */
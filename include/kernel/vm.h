@@ -0,0 +1,56 @@
+#ifndef __KERNEL_VM_H__
+#define __KERNEL_VM_H__
+
+#include "kernel/types.h"
+
+/*
+ * Sv39 用户页表（mm/vm.c）
+ *
+ * 内核始终在 satp = Bare 下运行。任务第一次调用 sbrk/mmap 时才得到自己的
+ * 页表：物理内存和 MMIO 按原地址恒等映射给用户态，另外在 USER_VA_BASE
+ * 开始的窗口里放按需分配的堆和匿名映射。陷阱入口和 switch_to 所在的
+ * trampoline 页不带 U 位，切换 satp 的那几条指令在两种视图下都能执行。
+ * clone 出来的任务按写时复制共享父任务窗口里的页面。
+ */
+
+typedef uint64_t pte_t;
+typedef pte_t *pagetable_t;
+
+#define PTE_V (1L << 0)
+#define PTE_R (1L << 1)
+#define PTE_W (1L << 2)
+#define PTE_X (1L << 3)
+#define PTE_U (1L << 4)
+#define PTE_G (1L << 5)
+#define PTE_A (1L << 6)
+#define PTE_D (1L << 7)
+#define PTE_COW (1L << 8)   // RSW 位：只读的写时复制页，写缺页时再复制
+
+#define PA2PTE(pa) ((((uint64_t)(pa)) >> 12) << 10)
+#define PTE2PA(pte) (((pte) >> 10) << 12)
+#define PTE_FLAGS(pte) ((pte) & 0x3ff)
+#define PX(level, va) ((((uint64_t)(va)) >> (12 + 9 * (level))) & 0x1ff)
+
+/* 按需分页的用户窗口：[USER_VA_BASE, USER_VA_END) */
+#define USER_VA_BASE   0x2000000000UL
+#define USER_HEAP_BASE USER_VA_BASE
+#define USER_HEAP_MAX  (256UL << 20)                     // sbrk 堆的上限
+#define USER_MMAP_BASE (USER_VA_BASE + (1UL << 30))
+#define USER_VA_END    (USER_VA_BASE + (4UL << 30))
+
+struct task_struct;
+
+void vm_init(void);
+int vm_task_init(struct task_struct *task);
+void vm_task_release(struct task_struct *task);
+int vm_task_clone(struct task_struct *child, struct task_struct *parent);
+int vm_map_range(struct task_struct *task, uintptr_t start, uintptr_t end);
+void vm_unmap_range(struct task_struct *task, uintptr_t start, uintptr_t end);
+void vm_zero_tail(struct task_struct *task, uintptr_t va);
+void *vm_user_page(struct task_struct *task, uintptr_t va, int write);
+int vm_fault(uintptr_t va, int write);
+
+long copy_from_user(void *dst, const void *usrc, size_t n);
+long copy_to_user(void *udst, const void *src, size_t n);
+
+#endif /* __KERNEL_VM_H__ */
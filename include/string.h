@@ -32,9 +32,16 @@ char *strrchr(const char *s, int c);
 char *strstr(const char *haystack, const char *needle);
 char *strdup(const char *s);
 
-/* Memory functions (implemented in Rust) */
+/* Memory functions */
 void *memcpy(void *dest, const void *src, size_t n);
+void *memmove(void *dest, const void *src, size_t n);
 void *memset(void *s, int c, size_t n);
 int memcmp(const void *s1, const void *s2, size_t n);
 
+/* Kernel-only: may use the vector unit (kernel/string.c, kernel/vector.c) */
+void *kmemcpy(void *dest, const void *src, size_t n);
+void *kmemset(void *s, int c, size_t n);
+int kmemcmp(const void *s1, const void *s2, size_t n);
+size_t kstrlen(const char *s);
+
 #endif /* __STRING_H__ */
@@ -12,6 +12,9 @@
  * 3. 重新编译
  */
 
+struct kstats;	// uapi/stats.h
+struct uart_rx_stats;	// uapi/uart.h
+
 // 系统调用定义列表 - 这是你唯一需要修改的地方
 #define SYSCALL_LIST \
     SYSCALL(exit,   void, int status) \
@@ -23,6 +26,20 @@
     SYSCALL(hart_get_status, long, unsigned long hartid) \
     SYSCALL(hart_count, int) \
     SYSCALL(hart_current_id, long) \
+    SYSCALL(futex_wait, long, volatile int *uaddr, int val) \
+    SYSCALL(futex_wake, long, volatile int *uaddr, int nr) \
+    SYSCALL(sbrk,   void *, long increment) \
+    SYSCALL(mmap,   void *, void *addr, size_t length, int prot, int flags, int fd, long offset) \
+    SYSCALL(munmap, int, void *addr, size_t length) \
+    SYSCALL(clone,  int, void (*fn)(void *), void *arg) \
+    SYSCALL(sched_setaffinity, int, int pid, size_t size, const unsigned long *mask) \
+    SYSCALL(sched_getaffinity, int, int pid, size_t size, unsigned long *mask) \
+    SYSCALL(hart_online, int, int hartid) \
+    SYSCALL(hart_offline, int, int hartid) \
+    SYSCALL(getstats, long, int hart, struct kstats *buf, size_t size) \
+    SYSCALL(profile, long, int cmd, unsigned long arg) \
+    SYSCALL(console_stats, int, struct uart_rx_stats *stats) \
+    SYSCALL(sched_getcpu, int, int pid) \
 /* ===================== 自动生成部分 ===================== */
 
 // 生成系统调用号
@@ -0,0 +1,24 @@
+#ifndef __UAPI_MMAN_H__
+#define __UAPI_MMAN_H__
+
+/*
+ * mmap / munmap 的参数（mm/mmap.c）
+ *
+ * 目前只支持匿名私有映射：fd 必须为 -1，offset 必须为 0。
+ * 返回的内存按页对齐，页面在第一次访问时才分配并清零，
+ * 除非指定了 MAP_POPULATE。
+ */
+
+#define PROT_NONE  0x0
+#define PROT_READ  0x1
+#define PROT_WRITE 0x2
+#define PROT_EXEC  0x4
+
+#define MAP_SHARED    0x01
+#define MAP_PRIVATE   0x02
+#define MAP_ANONYMOUS 0x20
+#define MAP_POPULATE  0x8000
+
+#define MAP_FAILED ((void *)-1)
+
+#endif // __UAPI_MMAN_H__
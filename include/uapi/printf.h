@@ -2,6 +2,7 @@
 #define __UAPI_PRINTF_H__
 
 #include "stdarg.h"
+#include "vsprintf.h"
 
 int printf(const char *format, ...);
 int vsprintf(char *out, const char *format, va_list args);
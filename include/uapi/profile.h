@@ -0,0 +1,32 @@
+#ifndef __UAPI_PROFILE_H__
+#define __UAPI_PROFILE_H__
+
+/*
+ * 采样分析器（profile 系统调用，kernel/profile.c）
+ *
+ * 打开后每个参与调度的 hart 按给定频率在时钟中断里记下被打断的 pc、
+ * 当前任务和 hart 号。PROFILE_DUMP 把样本以文本行输出到串口：
+ *
+ *   PROF-BEGIN hz=<频率>
+ *   PROF <hart> <任务号，空闲为 -1> <U|K> <pc，十六进制>
+ *   PROF-TASK <任务号> <任务入口地址>      （任务的第一个样本之后）
+ *   PROF-END samples=<输出的样本数> dropped=<缓冲区满丢掉的样本数>
+ *
+ * 主机上用 scripts/prof_report.py 对照 build/os.elf 的符号生成报告。
+ *
+ * 'K' 样本只来自空闲循环，系统调用的时间算在用户态的 pc 上，原因见
+ * kernel/profile.h。
+ */
+
+#define PROFILE_START 0		/* arg: 采样频率（Hz），0 为 PROFILE_DEFAULT_HZ；清空缓冲区 */
+#define PROFILE_STOP  1		/* 返回缓冲区里的样本数 */
+#define PROFILE_DUMP  2		/* 输出并清空缓冲区，返回输出的样本数 */
+#define PROFILE_COUNT 3		/* arg: 任务号，-1 为空闲循环；STOP 之后返回缓冲区里它的样本数，不取走 */
+
+/* PROFILE_COUNT 的 arg：统计所有任务（包括空闲循环）的样本 */
+#define PROFILE_ALL_TASKS (-2)
+
+#define PROFILE_DEFAULT_HZ 1000
+#define PROFILE_MAX_HZ     10000
+
+#endif // __UAPI_PROFILE_H__
@@ -0,0 +1,38 @@
+#ifndef __UAPI_STATS_H__
+#define __UAPI_STATS_H__
+
+#include <stdint.h>
+
+/*
+ * 内核统计计数器（getstats 系统调用，kernel/stats.c）
+ *
+ * 每个 hart 一份，由本 hart 不加锁、不用原子指令地累加；getstats 复制
+ * 一个 hart 的，或者把所有 hart 的加起来复制给调用者。各个计数器单独看
+ * 是准确的，彼此之间不是同一时刻的快照。
+ */
+
+#define STATS_NR_SYSCALLS 64	/* 按系统调用号计数，不小于 __NR_MAX */
+#define STATS_NR_CAUSES   16	/* 按 scause 的原因号计数 */
+#define STATS_NR_IDLE_STATES 4	/* 按空闲状态计数，不小于 CPUIDLE_NR_STATES */
+
+/* 一个空闲状态的计数（kernel/cpuidle.c）：0 wfi，1 保持型挂起，2 非保持型挂起 */
+struct kstats_idle {
+	uint64_t entries;	// 进入的次数
+	uint64_t residency;	// 在这个状态里的总时间（rdtime 计数）
+	uint64_t wakeups;	// 测到唤醒延迟的次数
+	uint64_t latency;	// 唤醒延迟之和：IPI 发出（或定时器到期）到恢复执行
+	uint64_t refused;	// SBI 拒绝挂起、改用 wfi 的次数
+};
+
+struct kstats {
+	uint64_t context_switches;	// 切换到另一个任务的次数
+	uint64_t page_allocs;		// 分配出去的物理页数
+	uint64_t page_frees;		// 释放的物理页数
+	uint64_t timer_expiries;	// 到期执行的定时器
+	uint64_t syscalls[STATS_NR_SYSCALLS];
+	uint64_t interrupts[STATS_NR_CAUSES];	// 1 软件中断，5 时钟，9 外部中断
+	uint64_t exceptions[STATS_NR_CAUSES];	// 8 用户态 ecall，13/15 缺页……
+	struct kstats_idle idle[STATS_NR_IDLE_STATES];
+};
+
+#endif // __UAPI_STATS_H__
@@ -0,0 +1,43 @@
+#ifndef __UAPI_STDIO_H__
+#define __UAPI_STDIO_H__
+
+#include <stddef.h>
+#include "stdarg.h"
+
+/*
+ * 带缓冲的用户态标准输出（user/stdio.c）
+ *
+ * 每个任务的 stdout 放在自己的 TLS 块里（见 uapi/tls.h），printf 先格式化进
+ * 缓冲区，按缓冲模式决定什么时候调用 write 系统调用：
+ *   _IOFBF 全缓冲：缓冲区放不下时才写出
+ *   _IOLBF 行缓冲：输出中出现 '\n' 时写出（默认）
+ *   _IONBF 不缓冲：每次调用都写出
+ * exit() 会先 fflush(stdout)，任务退出时不会丢掉缓冲的输出。
+ */
+
+#define BUFSIZ 512
+#define EOF (-1)
+
+#define _IOFBF 0
+#define _IOLBF 1
+#define _IONBF 2
+
+typedef struct {
+	int ready;	// TLS 是清零的，第一次使用时再设置默认值
+	int fd;
+	int mode;
+	char *buf;
+	size_t size;
+	size_t len;	// 已缓冲、尚未写出的字节数
+	char inline_buf[BUFSIZ];
+} FILE;
+
+FILE *stdio_stdout(void);
+#define stdout (stdio_stdout())
+
+int setvbuf(FILE *f, char *buf, int mode, size_t size);
+int fflush(FILE *f);
+int vfprintf(FILE *f, const char *format, va_list args);
+int fprintf(FILE *f, const char *format, ...);
+
+#endif // __UAPI_STDIO_H__
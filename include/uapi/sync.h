@@ -0,0 +1,46 @@
+#ifndef __UAPI_SYNC_H__
+#define __UAPI_SYNC_H__
+
+/*
+ * 用户态同步原语（user/sync.c）
+ *
+ * 无竞争时只使用 AMO 原子指令，不进入内核；只有需要睡眠或唤醒其它任务时
+ * 才调用 futex_wait / futex_wake 系统调用。
+ */
+
+/* 互斥锁 state: 0 = 未加锁, 1 = 已加锁且无等待者, 2 = 已加锁且可能有等待者 */
+typedef struct {
+	volatile int state;
+} mutex_t;
+
+/* 条件变量：每次 signal/broadcast 都会递增 seq */
+typedef struct {
+	volatile int seq;
+} cond_t;
+
+/* 计数信号量 */
+typedef struct {
+	volatile int count;
+	volatile int waiters;
+} sem_t;
+
+#define MUTEX_INITIALIZER { 0 }
+#define COND_INITIALIZER { 0 }
+#define SEM_INITIALIZER(n) { (n), 0 }
+
+void mutex_init(mutex_t *m);
+void mutex_lock(mutex_t *m);
+int mutex_trylock(mutex_t *m);
+void mutex_unlock(mutex_t *m);
+
+void cond_init(cond_t *c);
+void cond_wait(cond_t *c, mutex_t *m);
+void cond_signal(cond_t *c);
+void cond_broadcast(cond_t *c);
+
+void sem_init(sem_t *s, int value);
+void sem_wait(sem_t *s);
+int sem_trywait(sem_t *s);
+void sem_post(sem_t *s);
+
+#endif // __UAPI_SYNC_H__
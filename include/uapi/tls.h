@@ -0,0 +1,32 @@
+#ifndef __UAPI_TLS_H__
+#define __UAPI_TLS_H__
+
+/*
+ * 线程局部存储（TLS）
+ *
+ * 每个用户任务（以及直接进入用户态的从核）有一块清零的 TLS_SIZE 字节内存，
+ * 用户态运行期间 tp 指向它的起始处。内核在陷阱入口从 ctx.ktp 装回自己的 tp，
+ * 返回时再恢复用户的 tp，所以用户代码可以随意使用 tp。
+ *
+ * 布局：
+ *   TLS_STDIO_OFFSET   stdout 的 FILE（user/stdio.c）
+ *   TLS_UMALLOC_OFFSET umalloc 的 size-class 缓存（user/umalloc.c）
+ */
+
+#define TLS_SIZE 1024
+
+#define TLS_STDIO_OFFSET   0
+#define TLS_UMALLOC_OFFSET 768
+
+#ifndef __ASSEMBLER__
+
+static inline void *tls_base(void)
+{
+	void *p;
+	asm volatile("mv %0, tp" : "=r"(p));
+	return p;
+}
+
+#endif
+
+#endif // __UAPI_TLS_H__
@@ -0,0 +1,14 @@
+#ifndef __UAPI_UART_H__
+#define __UAPI_UART_H__
+
+#include <stdint.h>
+
+/* 控制台接收统计（console_stats 系统调用，drivers/uart.c） */
+struct uart_rx_stats {
+	uint64_t wakeups;	/* reads that followed an ISR wake-up */
+	uint64_t total_ticks;	/* sum of wake-up -> read latencies, in rdtime ticks */
+	uint64_t max_ticks;
+	uint32_t overruns;	/* bytes dropped because the RX ring was full */
+};
+
+#endif // __UAPI_UART_H__
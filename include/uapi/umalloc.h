@@ -0,0 +1,31 @@
+#ifndef __UAPI_UMALLOC_H__
+#define __UAPI_UMALLOC_H__
+
+#include <stddef.h>
+
+/*
+ * 用户态内存分配器（user/umalloc.c）
+ *
+ * 内核的 malloc/free 和用户代码链接在同一个镜像里，所以用户态版本叫
+ * umalloc/ufree。小块（含 16 字节头部不超过 2 KB）按 2 的幂（32 字节到 2 KB）分成 7 个
+ * size class，每个任务在自己的 TLS 块里有一组空闲链表，分配和释放都不加锁、
+ * 不进入内核；链表空了再从 sbrk 批量切块。更大的块直接用 mmap。
+ *
+ * 在一个任务里释放另一个任务分配的小块是允许的，它会进入释放者的缓存。
+ */
+
+struct umalloc_stats {
+	unsigned long allocs;
+	unsigned long frees;
+	unsigned long cache_hits;	// 直接从本任务空闲链表拿到的分配
+	unsigned long sbrk_calls;
+	unsigned long mmap_calls;
+	unsigned long munmap_calls;
+};
+
+void *umalloc(size_t size);
+void *ucalloc(size_t nmemb, size_t size);
+void ufree(void *ptr);
+void umalloc_get_stats(struct umalloc_stats *out);
+
+#endif // __UAPI_UMALLOC_H__
@@ -0,0 +1,22 @@
+#ifndef __VSPRINTF_H__
+#define __VSPRINTF_H__
+
+#include <stddef.h>
+#include "stdarg.h"
+
+/*
+ * Formatting engine shared by printk() and the user printf()
+ * (kernel/vsprintf.c).
+ *
+ * Conversions: %d %i %u %x %X %p %s %c %%
+ * Flags: '-' (left justify), '0' (zero pad), '#' (0x prefix), '+', ' '
+ * Width and precision: digits or '*'
+ * Length modifiers: hh h l ll z (all integers are formatted as 64-bit)
+ *
+ * Returns the length the full output would have had, like C99; at most
+ * n - 1 bytes are stored and the result is always NUL terminated if n > 0.
+ */
+int vsnprintf(char *out, size_t n, const char *fmt, va_list ap);
+int snprintf(char *out, size_t n, const char *fmt, ...);
+
+#endif /* __VSPRINTF_H__ */
@@ -0,0 +1,199 @@
+#include "kernel.h"
+#include "arch/sbi.h"
+#include "kernel/hart.h"
+#include "kernel/fpu.h"
+#include "kernel/cpuidle.h"
+#include "kernel/stats.h"
+
+/*
+ * 空闲状态 governor
+ *
+ * 调用者（空闲循环）关着中断、放开了内核锁。三个状态：
+ *   - wfi：直接等中断；
+ *   - 保持型挂起：SBI HSM 默认保持型挂起，寄存器和 CSR 都保留，唤醒后
+ *     像普通函数一样从 ecall 返回；
+ *   - 非保持型挂起：hart 可能断电，唤醒后从 cpuidle_resume（context.S）
+ *     重新进入 S 模式，除 a0/a1 外的寄存器都丢了。进入前把本 hart 持有
+ *     的浮点/向量寄存器写回任务，再把 callee-saved 寄存器和陷阱相关的
+ *     CSR 存到 cpuidle_save 里，恢复后装回来，看起来就像调用返回了 0。
+ *
+ * 挂起和 wfi 一样会因为挂起的中断醒来，其它 hart 的 IPI（SSIP）就是
+ * 唤醒它的方式。SBI 不支持某种挂起时，这个状态被关掉，以后只用更浅的。
+ *
+ * 唤醒延迟：smp_call_function() 给空闲的 hart 发 IPI 时调用 cpuidle_kick()
+ * 记下发出的时间，醒来后用恢复执行的时间减去它；定时器 hart 被定时器
+ * 唤醒时用到期时间。每个状态的进入次数、停留时间和唤醒延迟计在本 hart
+ * 的统计计数器里（struct kstats 的 idle[]，用 getstats 读取）。
+ */
+
+#define SBI_HSM_SUSPEND_RET_DEFAULT    0x00000000UL
+#define SBI_HSM_SUSPEND_NONRET_DEFAULT 0x80000000UL
+
+#define US_TO_TIME(us) ((uint64_t)(us) * (TIMER_INTERVAL / 1000000))
+
+/* 被隔离的 hart 能接受的最大退出延迟 */
+#define CPUIDLE_ISOLATED_LATENCY US_TO_TIME(10)
+
+/* 最近几次实际空闲时间，预测用 */
+#define CPUIDLE_HISTORY 8
+
+_Static_assert(CPUIDLE_NR_STATES <= STATS_NR_IDLE_STATES, "struct kstats counts every idle state");
+
+struct cpuidle_state {
+    const char *name;
+    uint64_t exit_latency;      // 退出需要的时间
+    uint64_t target_residency;  // 至少空闲这么久才划算
+    volatile int disabled;
+};
+
+static struct cpuidle_state states[CPUIDLE_NR_STATES] = {
+    [CPUIDLE_WFI]       = { "wfi",           0,               0 },
+    [CPUIDLE_RETENTIVE] = { "retentive",     US_TO_TIME(20),  US_TO_TIME(200) },
+    [CPUIDLE_NONRET]    = { "non-retentive", US_TO_TIME(200), US_TO_TIME(2000) },
+};
+
+/* 非保持型挂起时保存的上下文，布局和 context.S 中的偏移一致 */
+struct cpuidle_save {
+    reg_t ra, sp, gp, tp;
+    reg_t s[12];
+    reg_t stvec, sscratch, sie, sstatus, scounteren;
+};
+
+struct cpuidle_hart {
+    volatile int state;             // 当前所处的状态，不在空闲时为 -1
+    volatile uint64_t kicked_at;    // 第一个唤醒 IPI 发出的时间，0 表示没有
+    uint64_t history[CPUIDLE_HISTORY];
+    int nr_history;
+    int next_history;
+    struct cpuidle_save save;
+};
+
+/* 别的 hart 发唤醒 IPI 时会写 kicked_at：每个 hart 的从缓存行边界开始，不和相邻的共享 */
+static DEFINE_PER_CPU(struct cpuidle_hart, cpuidle_harts) = {
+    [0 ... MAXNUM_CPU - 1] = { .v = { .state = -1 } },
+};
+
+/* arch/riscv/context.S */
+extern long cpuidle_suspend_nonret(struct cpuidle_save *save, unsigned long suspend_type);
+
+/* 预测的空闲时间：到下一个定时器的时间，和最近空闲时间的平均值取小 */
+static uint64_t predict_idle(struct cpuidle_hart *c, uint64_t now, uint64_t next_event)
+{
+    uint64_t predicted = next_event > now ? next_event - now : 0;
+
+    if (c->nr_history == CPUIDLE_HISTORY) {
+        uint64_t sum = 0;
+        for (int i = 0; i < CPUIDLE_HISTORY; i++) {
+            sum += c->history[i];
+        }
+        if (sum / CPUIDLE_HISTORY < predicted) {
+            predicted = sum / CPUIDLE_HISTORY;
+        }
+    }
+    return predicted;
+}
+
+/* 最深的、预计空闲得够久、退出又不超过 latency_limit 的状态 */
+static int select_state(uint64_t predicted, uint64_t latency_limit)
+{
+    int state = CPUIDLE_WFI;
+
+    for (int i = 1; i < CPUIDLE_NR_STATES; i++) {
+        if (!states[i].disabled && states[i].target_residency <= predicted &&
+            states[i].exit_latency <= latency_limit) {
+            state = i;
+        }
+    }
+    return state;
+}
+
+/* 进入状态，返回 0；SBI 拒绝时关掉这个状态，返回错误码 */
+static long enter_state(int hart, int state)
+{
+    long err = 0;
+
+    switch (state) {
+    case CPUIDLE_RETENTIVE:
+        err = sbi_hart_suspend(SBI_HSM_SUSPEND_RET_DEFAULT, 0, 0).error;
+        break;
+    case CPUIDLE_NONRET:
+        // 寄存器会丢：先把本 hart 持有的浮点/向量状态写回任务
+        fpu_hart_flush();
+        err = cpuidle_suspend_nonret(&per_cpu_var(cpuidle_harts, hart).save, SBI_HSM_SUSPEND_NONRET_DEFAULT);
+        break;
+    default:
+        asm volatile("wfi");
+        break;
+    }
+    if (err != SBI_SUCCESS) {
+        states[state].disabled = 1;
+        printk("cpuidle: %s suspend not available (SBI error %ld), disabled\n",
+               states[state].name, err);
+    }
+    return err;
+}
+
+/**
+ * @brief 空闲等待一次，直到有中断挂起
+ * @param next_event 本 hart 下一个定时器到期的时间（rdtime），没有时为 TIMER_NEVER
+ * @details 由空闲循环在关中断、放开内核锁之后调用，返回后再打开中断处理唤醒它的中断。
+ */
+void cpuidle_enter(uint64_t next_event)
+{
+    int hart = this_hart();
+    struct cpuidle_hart *c = &per_cpu_var(cpuidle_harts, hart);
+    uint64_t now = get_time();
+    // 被隔离的 hart 上是延迟敏感的任务，只用退出够快的状态
+    uint64_t latency_limit = (hart_isolated_mask() & (1UL << hart)) ?
+                             CPUIDLE_ISOLATED_LATENCY : TIMER_NEVER;
+    int state = select_state(predict_idle(c, now, next_event), latency_limit);
+
+    __atomic_store_n(&c->kicked_at, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&c->state, state, __ATOMIC_RELEASE);
+
+    if (enter_state(hart, state) != SBI_SUCCESS) {
+        stat_inc(idle[state].refused);
+        state = CPUIDLE_WFI;
+        asm volatile("wfi");
+    }
+
+    uint64_t woke = get_time();
+    __atomic_store_n(&c->state, -1, __ATOMIC_RELEASE);
+    uint64_t kicked = __atomic_exchange_n(&c->kicked_at, 0, __ATOMIC_ACQUIRE);
+
+    stat_inc(idle[state].entries);
+    stat_add(idle[state].residency, woke - now);
+
+    // 唤醒原因：IPI 或者定时器到期；都不是（比如串口中断）就不计延迟
+    uint64_t wake_event = 0;
+    if (kicked && kicked >= now && kicked <= woke) {
+        wake_event = kicked;
+    } else if (next_event != TIMER_NEVER && next_event >= now && next_event <= woke) {
+        wake_event = next_event;
+    }
+    if (wake_event) {
+        stat_inc(idle[state].wakeups);
+        stat_add(idle[state].latency, woke - wake_event);
+    }
+
+    c->history[c->next_history] = woke - now;
+    c->next_history = (c->next_history + 1) % CPUIDLE_HISTORY;
+    if (c->nr_history < CPUIDLE_HISTORY) {
+        c->nr_history++;
+    }
+}
+
+/**
+ * @brief 记录发往 hart 的唤醒 IPI（smp_call_function() 发 IPI 之前调用）
+ * @details 只记第一个：对方在空闲状态里时，后来的 IPI 不会让它醒得更早。
+ */
+void cpuidle_kick(int hart)
+{
+    struct cpuidle_hart *c = &per_cpu_var(cpuidle_harts, hart);
+    uint64_t expected = 0;
+
+    if (__atomic_load_n(&c->state, __ATOMIC_ACQUIRE) >= 0) {
+        __atomic_compare_exchange_n(&c->kicked_at, &expected, get_time(), 0,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    }
+}
@@ -94,9 +94,12 @@ int fdt_path_offset(void *fdt, const char *path) {
                     }
                 }
                 
-                /* Check if this matches our target path */
-                if (strncmp(current_path, path, strlen(path)) == 0) {
-                    return (char *)struct_ptr - (char *)fdt;
+                /* Check if this matches our target path ("name/" was just appended) */
+                size_t target_len = strlen(path);
+                if (strncmp(current_path, path, target_len) == 0 &&
+                    (size_t)path_len <= target_len + 1) {
+                    /* Same convention as fdt_find_node_by_compatible(): offset of the token */
+                    return (char *)struct_ptr - 4 - (char *)fdt;
                 }
                 
                 depth++;
@@ -106,13 +109,13 @@ int fdt_path_offset(void *fdt, const char *path) {
             }
             case FDT_END_NODE:
                 depth--;
-                if (depth >= 0) {
-                    /* Remove last component from path */
-                    char *last_slash = strrchr(current_path, '/');
-                    if (last_slash && last_slash != current_path) {
-                        *last_slash = '\0';
-                        path_len = strlen(current_path);
+                if (depth > 0) {
+                    /* Remove the "name/" component of the node we are leaving */
+                    path_len--;
+                    while (path_len > 1 && current_path[path_len - 1] != '/') {
+                        path_len--;
                     }
+                    current_path[path_len] = '\0';
                 }
                 break;
             case FDT_PROP: {
@@ -173,6 +176,28 @@ void *fdt_get_property(void *fdt, int nodeoffset, const char *name, int *lenp) {
     return NULL;
 }
 
+/* Get a property of the /cpus/cpu@<hartid> node */
+void *fdt_get_cpu_property(void *fdt, uint64_t hartid, const char *name, int *lenp) {
+    static const char hex[] = "0123456789abcdef";
+    char path[32] = "/cpus/cpu@";
+    char digits[16];
+    int n = 0;
+
+    /* unit addresses are written in hex without leading zeros */
+    do {
+        digits[n++] = hex[hartid & 0xf];
+        hartid >>= 4;
+    } while (hartid && n < (int)sizeof(digits));
+
+    size_t pos = strlen(path);
+    while (n > 0) {
+        path[pos++] = digits[--n];
+    }
+    path[pos] = '\0';
+
+    return fdt_get_property(fdt, fdt_path_offset(fdt, path), name, lenp);
+}
+
 /* Parse memory information from device tree */
 static void parse_memory_info(void *fdt) {
     g_boot_info.memory_start = 0x80200000;  /* Our kernel start */
@@ -0,0 +1,320 @@
+#include "kernel.h"
+#include "string.h"
+#include "kernel/hart.h"
+#include "kernel/smp.h"
+#include "kernel/fpu.h"
+#include "kernel/vector.h"
+
+/*
+ * Lazy FP and vector context switching
+ *
+ * Each hart remembers which task's values are live in its FP and vector
+ * registers (the owner) and whether the owner has changed them since they
+ * were last saved. The scheduler only looks at sstatus.FS/VS when it
+ * switches: the outgoing task's Dirty bit is folded into the per-hart
+ * flag, and the incoming task gets FS/VS = Clean if it is the owner and
+ * Off otherwise. A task that is not the owner traps on its first FP or
+ * vector instruction; fpu_trap() then writes the owner's registers back
+ * (only if dirty), loads the new task's and retries the instruction.
+ *
+ * The kernel itself never uses FP. It does use V in the kmem*() helpers,
+ * which evict the vector owner first (vector_evict_user()).
+ *
+ * A task that moves to another hart may still own the registers of the
+ * hart it last ran on. Before it runs on the new hart, fpu_migrate() asks
+ * the old hart to write them back and give up the ownership. A hart that
+ * went idle after its task blocked never ran fpu_switch(), so the task's
+ * Dirty bit may still be live in that hart's sstatus; the flush folds it
+ * in before deciding whether to save.
+ */
+
+struct fpu_hart_state {
+    int fp_owner;   // task whose FP registers are live, -1 if none
+    int fp_dirty;   // the owner changed them since they were last saved
+    int v_owner;
+    int v_dirty;
+};
+
+static DEFINE_PER_CPU(struct fpu_hart_state, fpu_harts);
+static struct fpu_stats stats;
+static int user_vector;     // V present and its registers fit in v_context
+
+#define INSN_OTHER  0
+#define INSN_FP     1
+#define INSN_VECTOR 2
+
+static void set_fs(reg_t fs)
+{
+    w_sstatus((r_sstatus() & ~SSTATUS_FS) | fs);
+}
+
+static void set_vs(reg_t vs)
+{
+    w_sstatus((r_sstatus() & ~SSTATUS_VS) | vs);
+}
+
+void fpu_init(void)
+{
+    for (int i = 0; i < MAXNUM_CPU; i++) {
+        per_cpu_var(fpu_harts, i).fp_owner = -1;
+        per_cpu_var(fpu_harts, i).v_owner = -1;
+    }
+    user_vector = has_vector && vector_vlenb <= VLENB_MAX;
+
+    /* no owner yet, so nobody may touch the registers */
+    set_fs(SSTATUS_FS_OFF);
+    set_vs(SSTATUS_VS_OFF);
+}
+
+/*
+ * The live FS/VS can only be on for the owner of the unit (the task
+ * running here, or the last one if the hart has gone idle since): record
+ * whether it has changed the registers.
+ */
+static void fold_dirty(struct fpu_hart_state *h, reg_t sstatus)
+{
+    if ((sstatus & SSTATUS_FS) == SSTATUS_FS_DIRTY) {
+        h->fp_dirty = 1;
+    }
+    if ((sstatus & SSTATUS_VS) == SSTATUS_VS_DIRTY) {
+        h->v_dirty = 1;
+    }
+}
+
+/*
+ * DESCRIPTION:
+ *	Called by schedule() right before switch_to(next). sstatus still
+ *	holds prev's FS/VS, which can only be on if prev owns the unit.
+ */
+void fpu_switch(struct task_struct *prev, struct task_struct *next)
+{
+    struct fpu_hart_state *h = &this_cpu_var(fpu_harts);
+    int next_id = next - tasks;
+
+    (void)prev;
+    fold_dirty(h, r_sstatus());
+
+    next->ctx.sstatus &= ~(SSTATUS_FS | SSTATUS_VS);
+    if (h->fp_owner == next_id) {
+        next->ctx.sstatus |= SSTATUS_FS_CLEAN;
+    }
+    if (h->v_owner == next_id) {
+        next->ctx.sstatus |= SSTATUS_VS_CLEAN;
+    }
+}
+
+/* Decode just enough of the trapping instruction to tell FP from vector */
+static int classify_insn(reg_t epc)
+{
+    const uint16_t *p = (const uint16_t *)epc;
+    uint32_t insn = p[0];
+
+    if ((insn & 3) != 3) {
+        /* c.fld/c.fsd (quadrant 0) and c.fldsp/c.fsdsp (quadrant 2) */
+        uint32_t funct3 = insn >> 13;
+        if ((insn & 3) != 1 && (funct3 == 1 || funct3 == 5)) {
+            return INSN_FP;
+        }
+        return INSN_OTHER;
+    }
+
+    insn |= (uint32_t)p[1] << 16;
+    switch (insn & 0x7f) {
+    case 0x07:  /* LOAD-FP */
+    case 0x27:  /* STORE-FP: widths 1-4 are scalar FP, the others vector */
+    {
+        uint32_t width = (insn >> 12) & 7;
+        return (width >= 1 && width <= 4) ? INSN_FP : INSN_VECTOR;
+    }
+    case 0x43:  /* FMADD */
+    case 0x47:  /* FMSUB */
+    case 0x4b:  /* FNMSUB */
+    case 0x4f:  /* FNMADD */
+    case 0x53:  /* OP-FP */
+        return INSN_FP;
+    case 0x57:  /* OP-V, including vsetvl* */
+        return INSN_VECTOR;
+    case 0x73:  /* SYSTEM: CSR accesses to fflags/frm/fcsr or vector CSRs */
+    {
+        uint32_t csr = insn >> 20;
+        uint32_t funct3 = (insn >> 12) & 7;
+        if (funct3 == 0 || funct3 == 4) {
+            return INSN_OTHER;
+        }
+        if (csr >= 0x001 && csr <= 0x003) {
+            return INSN_FP;
+        }
+        if ((csr >= 0x008 && csr <= 0x00a) || csr == 0x00f ||
+            (csr >= 0xc20 && csr <= 0xc22)) {
+            return INSN_VECTOR;
+        }
+        return INSN_OTHER;
+    }
+    default:
+        return INSN_OTHER;
+    }
+}
+
+/*
+ * DESCRIPTION:
+ *	Illegal-instruction hook. If a user task tripped over FS/VS = Off,
+ *	hand it the unit and let it retry the same instruction.
+ * RETURN VALUE: 1 if handled (return to epc), 0 for a real illegal instruction
+ */
+int fpu_trap(reg_t epc)
+{
+    if (current_task_id < 0 || (r_sstatus() & SSTATUS_SPP)) {
+        return 0;
+    }
+
+    struct fpu_hart_state *h = &this_cpu_var(fpu_harts);
+    struct task_struct *task = &tasks[current_task_id];
+    int kind = classify_insn(epc);
+
+    if (kind == INSN_FP && (r_sstatus() & SSTATUS_FS) == SSTATUS_FS_OFF) {
+        set_fs(SSTATUS_FS_CLEAN);
+        if (h->fp_owner != current_task_id) {
+            if (h->fp_owner >= 0 && h->fp_dirty) {
+                fpu_save(&tasks[h->fp_owner].fp);
+                stats.fp_saves++;
+            }
+            fpu_restore(&task->fp);
+            h->fp_owner = current_task_id;
+        }
+        h->fp_dirty = 0;
+        set_fs(SSTATUS_FS_CLEAN);
+        stats.fp_traps++;
+        return 1;
+    }
+
+    if (kind == INSN_VECTOR && user_vector && (r_sstatus() & SSTATUS_VS) == SSTATUS_VS_OFF) {
+        set_vs(SSTATUS_VS_CLEAN);
+        if (h->v_owner != current_task_id) {
+            if (h->v_owner >= 0 && h->v_dirty) {
+                vstate_save(&tasks[h->v_owner].v);
+                stats.v_saves++;
+            }
+            vstate_restore(&task->v);
+            h->v_owner = current_task_id;
+        }
+        h->v_dirty = 0;
+        set_vs(SSTATUS_VS_CLEAN);
+        stats.v_traps++;
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * DESCRIPTION:
+ *	The kernel is about to clobber the vector registers (VS already on,
+ *	interrupts off). Write the owner's values back if they are newer than
+ *	its saved copy; live_dirty says whether VS was Dirty on entry.
+ */
+void vector_evict_user(int live_dirty)
+{
+    struct fpu_hart_state *h = &this_cpu_var(fpu_harts);
+
+    if (h->v_owner < 0) {
+        return;
+    }
+    if (h->v_dirty || live_dirty) {
+        vstate_save(&tasks[h->v_owner].v);
+        stats.v_saves++;
+    }
+    h->v_owner = -1;
+    h->v_dirty = 0;
+}
+
+/* Runs on the hart that may own the task's registers (smp_call_function) */
+static void fpu_flush_func(void *arg)
+{
+    struct fpu_hart_state *h = &this_cpu_var(fpu_harts);
+    int task_id = (int)(long)arg;
+    reg_t sstatus = r_sstatus();
+
+    /*
+     * task_id is not running here. FS/VS are still on if it was the last
+     * task before this hart went idle, and may be Dirty.
+     */
+    fold_dirty(h, sstatus);
+    if (h->fp_owner == task_id) {
+        if (h->fp_dirty) {
+            set_fs(SSTATUS_FS_CLEAN);
+            fpu_save(&tasks[task_id].fp);
+            stats.fp_saves++;
+        }
+        h->fp_owner = -1;
+        h->fp_dirty = 0;
+        sstatus = (sstatus & ~SSTATUS_FS) | SSTATUS_FS_OFF;
+    }
+    if (h->v_owner == task_id) {
+        if (h->v_dirty) {
+            set_vs(SSTATUS_VS_CLEAN);
+            vstate_save(&tasks[task_id].v);
+            stats.v_saves++;
+        }
+        h->v_owner = -1;
+        h->v_dirty = 0;
+        sstatus = (sstatus & ~SSTATUS_VS) | SSTATUS_VS_OFF;
+    }
+    w_sstatus(sstatus);
+}
+
+/*
+ * DESCRIPTION:
+ *	Called by schedule() before task_id runs on this hart for the first
+ *	time since it ran on from_hart. If from_hart still owns its FP or
+ *	vector registers, have it save them and wait until it has.
+ */
+void fpu_migrate(int task_id, int from_hart)
+{
+    struct fpu_hart_state *h = &per_cpu_var(fpu_harts, from_hart);
+
+    if (from_hart == this_hart() || (h->fp_owner != task_id && h->v_owner != task_id)) {
+        return;
+    }
+    smp_call_function(1UL << from_hart, fpu_flush_func, (void *)(long)task_id, 1);
+}
+
+/*
+ * DESCRIPTION:
+ *	This hart is about to lose its register state (non-retentive
+ *	suspend, kernel/cpuidle.c). Write back whatever it owns, folding in
+ *	a Dirty FS/VS left by the last task, and switch the units off.
+ */
+void fpu_hart_flush(void)
+{
+    struct fpu_hart_state *h = &this_cpu_var(fpu_harts);
+
+    fold_dirty(h, r_sstatus());
+    if (h->fp_owner >= 0) {
+        fpu_flush_func((void *)(long)h->fp_owner);
+    }
+    if (h->v_owner >= 0) {
+        fpu_flush_func((void *)(long)h->v_owner);
+    }
+    set_fs(SSTATUS_FS_OFF);
+    set_vs(SSTATUS_VS_OFF);
+}
+
+/* The task exited or its slot is reused: forget any registers it owns */
+void fpu_task_release(int task_id)
+{
+    for (int i = 0; i < MAXNUM_CPU; i++) {
+        if (per_cpu_var(fpu_harts, i).fp_owner == task_id) {
+            per_cpu_var(fpu_harts, i).fp_owner = -1;
+            per_cpu_var(fpu_harts, i).fp_dirty = 0;
+        }
+        if (per_cpu_var(fpu_harts, i).v_owner == task_id) {
+            per_cpu_var(fpu_harts, i).v_owner = -1;
+            per_cpu_var(fpu_harts, i).v_dirty = 0;
+        }
+    }
+}
+
+void fpu_get_stats(struct fpu_stats *out)
+{
+    *out = stats;
+}
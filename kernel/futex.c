@@ -0,0 +1,91 @@
+#include "kernel.h"
+#include "kernel/vm.h"
+
+/*
+ * Futex: 以用户地址为 key 的等待队列
+ *
+ * 用户态的锁在无竞争时只用原子指令，只有需要睡眠或唤醒时才进入内核。
+ * 等待者按地址哈希到固定数量的桶里，同一个桶中的不同地址通过
+ * task_struct.wait_key 区分。
+ *
+ * 检查 *uaddr 和挂到等待队列上都在关中断的陷阱上下文里完成，而唤醒者
+ * 也必须先进入内核，因此在"检查值"和"睡眠"之间不会丢失唤醒。
+ *
+ * 用户窗口（mm/vm.c）里的地址先换成内核能访问的物理地址，key 也用它。
+ */
+
+#define FUTEX_HASH_BITS 4
+#define FUTEX_HASH_SIZE (1 << FUTEX_HASH_BITS)
+
+static struct wait_queue_head futex_queues[FUTEX_HASH_SIZE];
+static int futex_inited = 0;
+
+static struct wait_queue_head *futex_bucket(uintptr_t key)
+{
+    if (!futex_inited) {
+        for (int i = 0; i < FUTEX_HASH_SIZE; i++) {
+            init_waitqueue_head(&futex_queues[i]);
+        }
+        futex_inited = 1;
+    }
+    // 地址按 4 字节对齐，去掉低位后做乘法哈希
+    uint64_t h = (key >> 2) * 0x9E3779B97F4A7C15ULL;
+    return &futex_queues[h >> (64 - FUTEX_HASH_BITS)];
+}
+
+/**
+ * @brief 如果 *uaddr 仍然等于 val，就睡眠直到被 futex_wake() 唤醒。
+ * @param uaddr 用户态的 32 位整数地址（必须 4 字节对齐）
+ * @param val 调用者看到的值
+ * @return 0 被唤醒；1 *uaddr 已经不等于 val，没有睡眠；-1 参数无效
+ */
+long do_futex_wait(volatile int *uaddr, int val)
+{
+    if (uaddr == NULL || ((uintptr_t)uaddr & 3)) {
+        return -1;
+    }
+    if (current_task_id == -1) {
+        // 不是由调度器管理的上下文，不能睡眠
+        return -1;
+    }
+    // 按写取页：写时复制的页先变成私有的，两个任务不会得到同一个 key
+    uaddr = vm_user_page(&tasks[current_task_id], (uintptr_t)uaddr, 1);
+    if (uaddr == NULL) {
+        return -1;
+    }
+
+    uintptr_t key = (uintptr_t)uaddr;
+
+    struct wait_queue_head *wq = futex_bucket(key);
+
+    prepare_to_wait_key(wq, key);
+    if (*uaddr != val) {
+        finish_wait(wq);
+        return 1;
+    }
+
+    // wait_for_wakeup() 不返回：提前写好系统调用的返回值（pc 已经指向 ecall 之后）
+    tasks[current_task_id].ctx.a0 = 0;
+    wait_for_wakeup();
+    return 0;
+}
+
+/**
+ * @brief 唤醒最多 nr 个在 uaddr 上等待的任务。
+ * @param uaddr 用户态的 32 位整数地址
+ * @param nr 最多唤醒的任务数
+ * @return 唤醒的任务数，参数无效时返回 -1
+ */
+long do_futex_wake(volatile int *uaddr, int nr)
+{
+    if (uaddr == NULL || ((uintptr_t)uaddr & 3) || nr <= 0) {
+        return -1;
+    }
+    uaddr = vm_user_page(current_task_id >= 0 ? &tasks[current_task_id] : NULL, (uintptr_t)uaddr, 1);
+    if (uaddr == NULL) {
+        return -1;
+    }
+
+    uintptr_t key = (uintptr_t)uaddr;
+    return wake_up_key(futex_bucket(key), key, nr);
+}
@@ -13,11 +13,24 @@
 #include "arch/sbi.h"
 #include "kernel/printk.h"
 #include "kernel/hart.h"
+#include "fdt.h"
+#include "string.h"
 
 // 全局的 per-CPU 数据区定义
 // 使用 __attribute__((used)) 防止编译器优化掉未在C代码中显式使用的全局变量
-// 汇编代码 (start.S) 会直接通过名字引用这个数组
-struct per_cpu_data cpu_data_area[MAXNUM_CPU] __attribute__((aligned(16), used));
+// 汇编代码 (start.S) 会直接通过名字引用这个数组，并在进入 C 代码前写入 hart_id
+struct per_cpu_data cpu_data_area[MAXNUM_CPU] __attribute__((used)) = {
+    [0 ... MAXNUM_CPU - 1] = {
+        .current_task = -1,
+        .timer_deadline = TIMER_NEVER,
+        .sample_deadline = TIMER_NEVER,
+    },
+};
+
+_Static_assert(sizeof(struct per_cpu_data) == (1 << PER_CPU_SHIFT),
+               "start.S indexes cpu_data_area[] with PER_CPU_SHIFT");
+_Static_assert(offsetof(struct per_cpu_data, hart_id) == 0,
+               "start.S stores the hartid at offset 0");
 
 /**
  * @brief 获取指定Hart的状态
@@ -194,3 +207,86 @@ int hart_suspend_self(unsigned long suspend_type, unsigned long resume_addr, uns
     printk("Hart: Hart %ld resumed from suspend\n", hartid);
     return 0;
 }
+
+/*
+ * 隔离的 hart（启动参数 isolcpus=）
+ *
+ * 给延迟敏感的轮询任务独占的 hart：没有周期性的调度节拍，不刷新 printk，
+ * 不分给它外部中断，新任务的默认亲和性也不包含它，只有显式绑定上去的
+ * 任务才会在上面运行。启动 hart 负责时钟和串口，不能隔离。
+ */
+static unsigned long isolated_mask;
+
+/* 解析 "2,3"、"2-3" 这样的 hart 列表，遇到空白或结尾停止 */
+static unsigned long parse_hart_list(const char *s)
+{
+    unsigned long mask = 0;
+
+    while (*s >= '0' && *s <= '9') {
+        long first = 0, last;
+        while (*s >= '0' && *s <= '9') {
+            first = first * 10 + (*s++ - '0');
+        }
+        last = first;
+        if (*s == '-') {
+            s++;
+            last = 0;
+            while (*s >= '0' && *s <= '9') {
+                last = last * 10 + (*s++ - '0');
+            }
+        }
+        for (long h = first; h <= last && h < MAXNUM_CPU; h++) {
+            mask |= 1UL << h;
+        }
+        if (*s != ',') {
+            break;
+        }
+        s++;
+    }
+    return mask;
+}
+
+/**
+ * @brief 从设备树 /chosen 的 bootargs 中读取 isolcpus= 参数
+ * @details 在启动 hart 上调用一次，早于 plic_init() 和 sched_init()。
+ *          QEMU 用 -append "isolcpus=3" 传入。
+ */
+void hart_isolation_init(void)
+{
+    void *fdt = (void *)get_dtb_addr();
+    int len;
+
+    if (fdt == NULL || fdt_check_header(fdt) != 0) {
+        return;
+    }
+    int chosen = fdt_path_offset(fdt, "/chosen");
+    const char *bootargs = fdt_get_property(fdt, chosen, "bootargs", &len);
+    if (bootargs == NULL || len <= 0) {
+        return;
+    }
+
+    for (const char *p = bootargs; (p = strstr(p, "isolcpus=")) != NULL; p++) {
+        if (p == bootargs || p[-1] == ' ') {
+            isolated_mask = parse_hart_list(p + strlen("isolcpus="));
+            break;
+        }
+    }
+
+    unsigned long boot = 1UL << get_boot_hartid();
+    if (isolated_mask & boot) {
+        printk("Hart: boot hart %ld handles the timer and UART, not isolating it\n",
+               (long)get_boot_hartid());
+        isolated_mask &= ~boot;
+    }
+    if (isolated_mask) {
+        printk("Hart: isolated hart mask 0x%lx\n", isolated_mask);
+    }
+}
+
+/**
+ * @brief 被隔离的 hart 的掩码，没有隔离时为 0
+ */
+unsigned long hart_isolated_mask(void)
+{
+    return isolated_mask;
+}
@@ -14,11 +14,14 @@
  * Following functions SHOULD be called ONLY ONE time here,
  * so just declared here ONCE and NOT included in file os.h.
  */
-// extern void uart_init(void);  // Not needed when using SBI console
+extern void uart_init(void);
 extern void sched_init(void);
 extern void schedule(void);
 extern void os_main(void);
-extern void trap_init(void);
+extern void trap_init(long hartid);
+extern void vector_init(void);
+extern void fpu_init(void);
+extern void vm_init(void);
 extern void plic_init(void);
 extern void timer_init(void);
 extern struct context *current_ctx;
@@ -36,11 +39,17 @@ extern struct context *current_ctx;
  *     - 跳转到 `start_kernel`
  *   - `start_kernel` (self)
  *     - `page_init()`: 初始化页表和内存管理
- *     - `trap_init()`: 设置陷阱向量表
- *     - `plic_init()`: 初始化平台级中断控制器
+ *     - `trap_init(hartid)`: 设置陷阱向量表和本 hart 的启动上下文
+ *     - `vector_init()`: 根据设备树的 ISA 字符串决定内核内存函数是否使用 RVV
+ *     - `fpu_init()`: 关闭 FPU/向量单元，任务第一次使用时再按需交给它
+ *     - `vm_init()`: 建立所有用户页表共用的恒等映射和 trampoline 页
+ *     - `uart_init()`: 接管串口，之后的控制台输出改为中断驱动
+ *     - `hart_isolation_init()`: 读取启动参数 isolcpus=，确定被隔离的 hart
+ *     - `plic_init()`: 初始化平台级中断控制器，外部中断不发给被隔离的 hart
  *     - `timer_init()`: 初始化时钟中断
  *     - `sched_init()`: 初始化调度器和任务数组
  *     - `os_main()`: 创建用户态的初始任务
+ *     - `printk_enable_deferred()`: printk 改为只追加日志，由软中断刷新
  *     - `kernel_scheduler()`: 启动内核调度循环，永不返回
  */
 void start_kernel(void)
@@ -65,10 +74,21 @@ void start_kernel(void)
     
     malloc_init();
     
-    trap_init();
+    trap_init(current_hartid);
+
+    vector_init();
+
+    fpu_init();
+
+    vm_init();
 
     //verify_syscall_table(); // 初次验证系统调用表
 
+    /* From here on console output is queued and drained by the UART interrupt */
+    uart_init();
+
+    hart_isolation_init();
+
     plic_init();
 
     timer_init();
@@ -83,6 +103,9 @@ void start_kernel(void)
 
     //disable_pmp(); // 禁用PMP，允许U-Mode访问所有内存
 
+    /* From here on printk only appends to the log buffer; softirqs drain it */
+    printk_enable_deferred();
+
     kernel_scheduler();
 
     printk("Would not go here!\n");
@@ -90,3 +113,26 @@ void start_kernel(void)
     {
     }; // stop here!
 }
+
+/**
+ * @brief 从核的内核入口
+ * @details
+ *   通过 hart_start(hartid, _secondary_start, secondary_start_kernel) 启动
+ *   （启动时的测试，或者 sched_hart_online() 让下线的 hart 重新上线），
+ *   `_secondary_start` 装好 tp、栈和陷阱入口后调用。这里只设置本 hart
+ *   自己的 CSR，然后和启动 hart 一样进入调度循环。启动 hart 在 sched_init()
+ *   之后一直拿着内核锁，所以从核要等它开始调度才会运行任务。
+ * @param hartid 当前 hart 的 ID
+ */
+void secondary_start_kernel(long hartid)
+{
+    // 和启动 hart 相同：用户态可以读计数器，S 模式可以访问带 U 位的页
+    w_scounteren(SCOUNTEREN_CY | SCOUNTEREN_TM | SCOUNTEREN_IR);
+    w_sstatus(r_sstatus() | SSTATUS_SUM);
+    // 可能是下线后重新上线：之前缓存的地址翻译不再可靠
+    asm volatile("sfence.vma" ::: "memory");
+
+    kernel_lock();
+    printk("RVOS: Hart %ld entering the scheduler\n", hartid);
+    kernel_scheduler();
+}
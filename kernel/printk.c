@@ -1,164 +1,285 @@
 #include "kernel.h"
 #include "arch/sbi.h"
 #include "kernel/printk.h"
+#include "kernel/uart.h"
+#include "kernel/hart.h"
 #include "string.h"
+#include "vsprintf.h"
 
-#define PRINTK_BUF_SIZE 1024
+/*
+ * printk 日志缓冲区
+ *
+ * 每个 hart 有一个自己的记录环，printk 只把格式化结果追加到本 hart 的环里，
+ * 不接触串口，因此不会因为串口发送而阻塞，也不会和其它 hart 的输出交错。
+ * 每条记录带有全局递增的序号、hart ID 和 rdtime 时间戳；刷新者按序号
+ * 归并所有 hart 的记录并交给 UART 驱动，它运行在 S 态软件中断（软中断）
+ * 这一低优先级上下文中。软中断里的刷新拿着内核锁，不能等串口：UART 发送环
+ * 放不下下一条记录时就停下，等发送环腾出空间后由 UART 驱动再挂起软中断。
+ *
+ * 每个环只有一个生产者（所属 hart，追加时关中断）和一个消费者（持有
+ * log_flushing 的刷新者），head/tail 是自由递增的计数器。
+ *
+ * 输出时每一行前面加上 "[hart 秒.微秒] "；环满丢掉的消息数记在本 hart
+ * 下一条记录里，输出它之前先打印一行 "N messages dropped"；被截断的
+ * 消息末尾加上 " <truncated>"。
+ */
+#define LOG_TEXT_MAX		232
+#define LOG_RECORDS_PER_CPU	32	/* 必须是 2 的幂 */
+
+#define LOG_TRUNCATED		(1 << 0)
+
+/* 一条记录最多输出的字节数：换行、两个行首前缀、丢弃提示、正文和截断标记 */
+#define LOG_PREFIX_MAX		40
+#define LOG_OUT_MAX		(1 + 3 * LOG_PREFIX_MAX + LOG_TEXT_MAX + 13)
+
+struct log_record {
+	uint64_t seq;
+	uint64_t timestamp;	/* rdtime */
+	uint32_t dropped;	/* 这条记录之前本 hart 丢掉的消息数 */
+	uint16_t len;
+	uint8_t hart;
+	uint8_t flags;
+	char text[LOG_TEXT_MAX];
+};
+
+struct log_ring {
+	volatile uint32_t head;	/* 生产者写到的位置 */
+	volatile uint32_t tail;	/* 刷新者读到的位置 */
+	uint32_t dropped;	/* 还没记到记录里的丢弃数，只有生产者访问 */
+	struct log_record rec[LOG_RECORDS_PER_CPU];
+};
+
+static struct log_ring log_rings[MAXNUM_CPU];
+static uint64_t log_seq;		/* 下一个分配出去的序号 */
+static uint64_t log_next_flush;		/* 刷新者下一个要输出的序号 */
+static volatile int log_flushing;
+static int log_line_open;		/* 刷新者输出的上一条记录没有以换行结尾 */
+static int log_line_hart;		/* 上一条记录的 hart */
+static int log_deferred;		/* 0: 启动阶段，追加后立即同步刷新 */
+static int log_panic;
+
+/* 行首的 "[hart 秒.微秒] " */
+static void log_write_prefix(int hart, uint64_t timestamp)
+{
+	char prefix[LOG_PREFIX_MAX];
+	int len = snprintf(prefix, sizeof(prefix), "[%d %5ld.%06ld] ", hart,
+			   (long)(timestamp / TIMER_INTERVAL),
+			   (long)(timestamp % TIMER_INTERVAL / (TIMER_INTERVAL / 1000000)));
+
+	uart_write(prefix, len);
+}
 
 /*
- * ref: https://github.com/cccriscv/mini-riscv-os/blob/master/05-Preemptive/lib.c
+ * DESCRIPTION:
+ *	Write one record: the drop notice it carries, the line prefix (unless
+ *	it continues the previous record's line on the same hart) and the text.
  */
+static void log_write_record(struct log_record *rec)
+{
+	if (log_line_open && (rec->dropped || rec->hart != log_line_hart)) {
+		uart_write("\n", 1);
+		log_line_open = 0;
+	}
+	if (rec->dropped) {
+		char note[LOG_PREFIX_MAX];
+		log_write_prefix(rec->hart, rec->timestamp);
+		uart_write(note, snprintf(note, sizeof(note), "%u messages dropped\n", rec->dropped));
+	}
+	if (!log_line_open) {
+		log_write_prefix(rec->hart, rec->timestamp);
+	}
+	uart_write(rec->text, rec->len);
+	if (rec->len) {
+		log_line_open = rec->text[rec->len - 1] != '\n';
+	}
+	if (rec->flags & LOG_TRUNCATED) {
+		uart_write(" <truncated>\n", 13);
+		log_line_open = 0;
+	}
+	log_line_hart = rec->hart;
+}
 
-static int vsnprintk(char * out, size_t n, const char* s, va_list vl)
+/*
+ * DESCRIPTION:
+ *	Drain the per-hart rings in sequence order into the UART driver.
+ *	Only one context flushes at a time; the others return immediately and
+ *	leave the work to the owner, which re-checks the rings after it lets go.
+ *	A record whose sequence number has been taken but which is not yet
+ *	published stops the flush, so output never goes out of order; the
+ *	producer kicks us again right after publishing it.
+ *	Unless wait is set, the flush also stops when the UART TX ring has no
+ *	room for another record instead of spinning on the line; the UART
+ *	driver raises SOFTIRQ_PRINTK again once the room is there.
+ */
+static void log_flush(int wait)
 {
-	int format = 0;
-	int longarg = 0;
-	size_t pos = 0;
-	for (; *s; s++) {
-		if (format) {
-			switch(*s) {
-			case 'l': {
-				longarg = 1;
-				break;
-			}
-			case 'p': {
-				longarg = 1;
-				if (out && pos < n) {
-					out[pos] = '0';
-				}
-				pos++;
-				if (out && pos < n) {
-					out[pos] = 'x';
+	for (;;) {
+		int stalled = 0;
+
+		if (__atomic_exchange_n(&log_flushing, 1, __ATOMIC_ACQUIRE) && !log_panic) {
+			return;
+		}
+
+		for (;;) {
+			struct log_ring *best = NULL;
+			struct log_record *rec = NULL;
+
+			for (int i = 0; i < MAXNUM_CPU; i++) {
+				struct log_ring *r = &log_rings[i];
+				uint32_t tail = r->tail;
+				if (tail == __atomic_load_n(&r->head, __ATOMIC_ACQUIRE)) {
+					continue;
 				}
-				pos++;
-				__attribute__((fallthrough));
-			}
-			case 'x': {
-				long num = longarg ? va_arg(vl, long) : va_arg(vl, int);
-				int hexdigits = 2*(longarg ? sizeof(long) : sizeof(int))-1;
-				for(int i = hexdigits; i >= 0; i--) {
-					int d = (num >> (4*i)) & 0xF;
-					if (out && pos < n) {
-						out[pos] = (d < 10 ? '0'+d : 'a'+d-10);
-					}
-					pos++;
+				struct log_record *cand = &r->rec[tail & (LOG_RECORDS_PER_CPU - 1)];
+				if (rec == NULL || cand->seq < rec->seq) {
+					best = r;
+					rec = cand;
 				}
-				longarg = 0;
-				format = 0;
-				break;
 			}
-			case 'u':
-			case 'd': {
-				unsigned long num_to_print;
-
-				if (*s == 'd') {
-					long num = longarg ? va_arg(vl, long) : va_arg(vl, int);
-					if (num < 0) {
-						num_to_print = -num;
-						if (out && pos < n) {
-							out[pos] = '-';
-						}
-						pos++;
-					} else {
-						num_to_print = num;
-					}
-				} else {
-					num_to_print = longarg ? va_arg(vl, unsigned long) : va_arg(vl, unsigned int);
-				}
 
-				long digits = 1;
-				for (unsigned long nn = num_to_print; nn /= 10; digits++);
-				
-				for (int i = digits - 1; i >= 0; i--) {
-					if (out && pos + i < n) {
-						out[pos + i] = '0' + (num_to_print % 10);
-					}
-					num_to_print /= 10;
-				}
-				pos += digits;
-				longarg = 0;
-				format = 0;
+			if (rec == NULL) {
 				break;
 			}
-			case 's': {
-				const char* s2 = va_arg(vl, const char*);
-				while (*s2) {
-					if (out && pos < n) {
-						out[pos] = *s2;
-					}
-					pos++;
-					s2++;
-				}
-				longarg = 0;
-				format = 0;
+			if (rec->seq != log_next_flush && !log_panic) {
 				break;
 			}
-			case 'c': {
-				if (out && pos < n) {
-					out[pos] = (char)va_arg(vl,int);
-				}
-				pos++;
-				longarg = 0;
-				format = 0;
+			if (!wait && !log_panic && !uart_tx_room(LOG_OUT_MAX)) {
+				stalled = 1;
 				break;
 			}
-			default:
-				break;
-			}
-		} else if (*s == '%') {
-			format = 1;
-		} else {
-			if (out && pos < n) {
-				out[pos] = *s;
-			}
-			pos++;
+
+			log_write_record(rec);
+			log_next_flush = rec->seq + 1;
+			__atomic_store_n(&best->tail, best->tail + 1, __ATOMIC_RELEASE);
+		}
+
+		__atomic_store_n(&log_flushing, 0, __ATOMIC_RELEASE);
+
+		/* a record may have been published after our last look */
+		uint64_t next = __atomic_load_n(&log_seq, __ATOMIC_ACQUIRE);
+		if (log_panic || stalled || next == log_next_flush) {
+			return;
+		}
+		int ready = 0;
+		for (int i = 0; i < MAXNUM_CPU && !ready; i++) {
+			struct log_ring *r = &log_rings[i];
+			uint32_t tail = r->tail;
+			ready = tail != __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) &&
+				r->rec[tail & (LOG_RECORDS_PER_CPU - 1)].seq == log_next_flush;
 		}
-    	}
-	if (out && pos < n) {
-		out[pos] = 0;
-	} else if (out && n) {
-		out[n-1] = 0;
+		if (!ready) {
+			return;
+		}
+	}
+}
+
+/*
+ * Isolated harts leave their records in the ring: the timer hart drains
+ * them on its next tick (printk_tick()), so they never flush or take the
+ * softirq themselves.
+ */
+static void log_kick(void)
+{
+	if (log_deferred && (hart_isolated_mask() & (1UL << this_hart()))) {
+		return;
+	}
+	if (log_deferred) {
+		raise_softirq(SOFTIRQ_PRINTK);
+	} else {
+		log_flush(1);
+	}
+}
+
+/**
+ * @brief 同步刷新 printk 日志缓冲区
+ * @details 串口发送环满时会等待，只在需要立即看到输出的地方直接调用。
+ */
+void printk_flush(void)
+{
+	log_flush(1);
+}
+
+/**
+ * @brief SOFTIRQ_PRINTK 的处理函数
+ * @details 拿着内核锁运行，发送环放不下时停下，由 UART 驱动再次挂起软中断。
+ */
+void printk_softirq(void)
+{
+	log_flush(0);
+}
+
+/**
+ * @brief 时钟节拍上的刷新
+ * @details 由处理时钟中断的 hart 调用，输出被隔离的 hart 留在环里的记录。
+ */
+void printk_tick(void)
+{
+	if (log_deferred && hart_isolated_mask()) {
+		log_flush(0);
 	}
-	return pos;
 }
 
 /**
- * @brief 内核内部的写操作核心实现。
+ * @brief 切换到延迟刷新模式
  * @details
- *   此函数负责将指定缓冲区的数据直接写入到控制台。
- *   它直接通过 SBI 调用 `sbi_console_putchar` 来输出字符。
- *   这个函数是所有内核打印和控制台输出的最终端点。
- * @param buf 待写入数据的缓冲区。
- * @param len 待写入数据的长度。
- * @return 成功写入的字节数。
+ *   启动阶段（陷阱、软中断都还没准备好）printk 追加后立即同步刷新。
+ *   调度器启动前调用此函数，之后 printk 只追加记录，由软中断负责输出。
  */
+void printk_enable_deferred(void)
+{
+	log_deferred = 1;
+}
+
 /**
  * @brief 使用可变参数列表的核心打印函数
  * @details
- *   此函数接收一个格式化字符串和一个 va_list，
- *   将格式化后的结果放入一个静态缓冲区，然后通过 do_write 输出。
+ *   把格式化结果直接写进本 hart 日志环中的一条新记录，然后通知刷新者。
+ *   超过 LOG_TEXT_MAX - 1 个字符的消息会被截断，输出时带上截断标记。
+ *   环满时先尝试自己刷新一次（延迟刷新模式下同样不等串口），仍然没有空间
+ *   才丢弃这条消息并计数，丢弃数随本 hart 的下一条记录输出。
  * @param fmt 格式化字符串
  * @param args va_list 参数列表
- * @return 打印的字符数
+ * @return 格式化后的字符数（截断前）
  */
 int vprintk(const char *fmt, va_list args)
 {
-    char buf[PRINTK_BUF_SIZE];
-    int len = vsnprintk(buf, sizeof(buf), fmt, args);
-    if (len > 0) {
-        // 直接输出到控制台
-        for (int i = 0; i < len; i++) {
-            sbi_console_putchar(buf[i]);
-        }
-    }
-    return len;
+	int hart = this_hart();
+	struct log_ring *r = &log_rings[hart];
+	reg_t flags = local_irq_save();
+
+	uint32_t head = r->head;
+	if (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) >= LOG_RECORDS_PER_CPU) {
+		log_flush(!log_deferred);
+		if (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) >= LOG_RECORDS_PER_CPU) {
+			r->dropped++;
+			local_irq_restore(flags);
+			return 0;
+		}
+	}
+
+	struct log_record *rec = &r->rec[head & (LOG_RECORDS_PER_CPU - 1)];
+	int len = vsnprintf(rec->text, LOG_TEXT_MAX, fmt, args);
+	rec->len = len < LOG_TEXT_MAX ? len : LOG_TEXT_MAX - 1;
+	rec->flags = len < LOG_TEXT_MAX ? 0 : LOG_TRUNCATED;
+	rec->hart = hart;
+	rec->timestamp = get_time();
+	rec->dropped = r->dropped;
+	r->dropped = 0;
+	// 关中断期间分配序号并发布，其它 hart 的刷新者最多等待这几条指令
+	rec->seq = __atomic_fetch_add(&log_seq, 1, __ATOMIC_ACQ_REL);
+	__atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+
+	local_irq_restore(flags);
+
+	log_kick();
+	return len;
 }
 
 /**
  * @brief 内核格式化打印函数
  * @details
  *   内核代码应该使用此函数来打印调试信息。
- *   它线程安全（使用栈缓冲区），并将所有输出引导到控制台。
+ *   它只把消息追加到本 hart 的日志缓冲区，不会等待串口，可以在任何上下文中调用。
  * @param fmt 格式化字符串
  * @param ... 可变参数
  * @return 打印的字符数
@@ -178,5 +299,10 @@ int printk(const char* fmt, ...)
 void panic(const char *s)
 {
 	printk("panic: %s\n", s);
+	// 中断可能已经关闭，不能再指望软中断和 UART 中断把缓冲区发送完：
+	// 忽略刷新锁和尚未发布的序号，把所有日志同步写出
+	log_panic = 1;
+	log_flush(1);
+	uart_flush();
 	while(1){};
 }
@@ -0,0 +1,200 @@
+#include "kernel.h"
+#include "kernel/hart.h"
+#include "kernel/smp.h"
+#include "kernel/ringbuf.h"
+#include "kernel/uart.h"
+#include "kernel/printk.h"
+#include "kernel/profile.h"
+#include "uapi/profile.h"
+#include "vsprintf.h"
+
+/*
+ * 采样分析器
+ *
+ * PROFILE_START 用同步的跨 hart 调用让每个参与调度的 hart（在线、没有
+ * 被隔离）设好第一次采样，之后每次采样的时钟中断里 profile_tick() 记下
+ * 被打断的 pc，再把采样时间往后推一个周期。被隔离的 hart 不采样，不给
+ * 上面延迟敏感的任务添加中断；START 之后才上线的 hart 也不采样。
+ *
+ * 样本由本 hart 在陷阱处理中（持有内核锁）写入自己的环形缓冲区，
+ * PROFILE_DUMP 也在内核锁下读取，两者不会同时进行。
+ */
+
+#define PROF_RING_SAMPLES 1024  // 每个 hart 能缓存的样本数，2 的幂
+
+struct prof_sample {
+    uint64_t pc;
+    int16_t task;       // 当前任务，空闲循环里为 -1
+    uint8_t hart;
+    uint8_t user;       // 被打断时在用户态
+    uint32_t reserved;
+};
+
+struct prof_cpu {
+    struct ringbuf ring;
+    uint64_t dropped;   // 缓冲区满时丢掉的样本
+    struct prof_sample storage[PROF_RING_SAMPLES];
+};
+
+static DEFINE_PER_CPU(struct prof_cpu, prof_cpus);
+static uint64_t prof_period;    // 采样周期（rdtime 计数）
+static long prof_hz;
+
+/**
+ * @brief 时钟中断里记录一个样本
+ * @param epc 被打断的 pc
+ * @param user 被打断时在用户态
+ * @details 还没到本 hart 的采样时间（中断是定时器链表的）就什么也不做。
+ *          只更新下一次采样的时间，timer_handler() 随后重新设置硬件定时器。
+ */
+void profile_tick(reg_t epc, int user)
+{
+    uint64_t next = this_cpu_read(sample_deadline);
+    uint64_t now = get_time();
+
+    if (next == TIMER_NEVER || now < next) {
+        return;
+    }
+
+    struct prof_cpu *p = &this_cpu_var(prof_cpus);
+    struct prof_sample s = {
+        .pc = epc,
+        .task = current_task_id,
+        .hart = this_hart(),
+        .user = user,
+    };
+    // 样本大小整除缓冲区大小，要么整个放进去，要么一点也放不进
+    if (ringbuf_put(&p->ring, &s, sizeof(s)) == 0) {
+        p->dropped++;
+    }
+
+    // 中断来晚了（比如一直关着中断）就从现在算起，不补采
+    next += prof_period;
+    if (next <= now) {
+        next = now + prof_period;
+    }
+    this_cpu_write(sample_deadline, next);
+}
+
+/* 在每个 hart 上执行：arg 为采样周期，0 表示停止采样 */
+static void profile_arm_func(void *arg)
+{
+    uint64_t period = (uint64_t)(uintptr_t)arg;
+
+    timer_set_sample(period ? get_time() + period : TIMER_NEVER);
+}
+
+static long profile_start(unsigned long hz)
+{
+    if (hz == 0) {
+        hz = PROFILE_DEFAULT_HZ;
+    }
+    if (hz > PROFILE_MAX_HZ) {
+        return -1;
+    }
+
+    smp_call_function(smp_online_mask(), profile_arm_func, (void *)0, 1);
+    for (int h = 0; h < MAXNUM_CPU; h++) {
+        struct prof_cpu *p = &per_cpu_var(prof_cpus, h);
+        ringbuf_init(&p->ring, (uint8_t *)p->storage, sizeof(p->storage));
+        p->dropped = 0;
+    }
+    prof_hz = hz;
+    prof_period = TIMER_INTERVAL / hz;
+    smp_call_function(smp_online_mask() & ~hart_isolated_mask(), profile_arm_func,
+                      (void *)(uintptr_t)prof_period, 1);
+    return 0;
+}
+
+/**
+ * @brief 缓冲区里属于 task 的样本数，不取走样本
+ * @param task 任务号，-1 为空闲循环，PROFILE_ALL_TASKS 为所有样本
+ * @note 在 PROFILE_STOP 之后调用，读的时候没有 hart 还在写入。
+ */
+long profile_count(int task)
+{
+    long n = 0;
+
+    for (int h = 0; h < MAXNUM_CPU; h++) {
+        struct ringbuf *rb = &per_cpu_var(prof_cpus, h).ring;
+        for (uint32_t pos = rb->tail; pos != rb->commit; pos += sizeof(struct prof_sample)) {
+            struct prof_sample *s = (struct prof_sample *)(rb->data + (pos & (rb->size - 1)));
+            if (task == PROFILE_ALL_TASKS || s->task == task) {
+                n++;
+            }
+        }
+    }
+    return n;
+}
+
+/* 直接写串口：printk 的缓冲区装不下一次输出的样本 */
+static void prof_print(const char *fmt, ...)
+{
+    char line[80];
+    va_list ap;
+
+    va_start(ap, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (len > (int)sizeof(line) - 1) {
+        len = sizeof(line) - 1;
+    }
+    uart_write(line, len);
+}
+
+/* 输出并清空所有 hart 的缓冲区，格式见 uapi/profile.h */
+static long profile_dump(void)
+{
+    uint64_t seen = 0;  // 已经输出过 PROF-TASK 的任务；任务号 >= 64 的每次都输出
+    uint64_t dropped = 0;
+    long n = 0;
+
+    // 先输出已经排队的日志，免得夹在样本中间
+    printk_flush();
+    prof_print("PROF-BEGIN hz=%ld\n", prof_hz);
+    for (int h = 0; h < MAXNUM_CPU; h++) {
+        struct prof_cpu *p = &per_cpu_var(prof_cpus, h);
+        struct prof_sample s;
+        while (ringbuf_get(&p->ring, &s, sizeof(s)) == sizeof(s)) {
+            prof_print("PROF %d %d %c %lx\n", s.hart, s.task, s.user ? 'U' : 'K', s.pc);
+            if (s.task >= 0 && !(s.task < 64 && (seen & (1ULL << s.task)))) {
+                void *entry = task_get_entry(s.task);
+                if (entry) {
+                    prof_print("PROF-TASK %d %lx\n", s.task, (unsigned long)entry);
+                }
+                if (s.task < 64) {
+                    seen |= 1ULL << s.task;
+                }
+            }
+            n++;
+        }
+        dropped += p->dropped;
+        p->dropped = 0;
+    }
+    prof_print("PROF-END samples=%ld dropped=%ld\n", n, (long)dropped);
+    return n;
+}
+
+/**
+ * @brief 控制采样分析器
+ * @param cmd PROFILE_START / PROFILE_STOP / PROFILE_DUMP / PROFILE_COUNT
+ * @param arg PROFILE_START 的采样频率（Hz），0 为默认值；PROFILE_COUNT 的任务号
+ * @return START 成功返回 0；STOP 返回缓冲区里的样本数；DUMP 返回输出的
+ *         样本数；COUNT 返回任务的样本数；失败返回 -1
+ */
+long do_profile(int cmd, unsigned long arg)
+{
+    switch (cmd) {
+    case PROFILE_START:
+        return profile_start(arg);
+    case PROFILE_STOP:
+        smp_call_function(smp_online_mask(), profile_arm_func, (void *)0, 1);
+        return profile_count(PROFILE_ALL_TASKS);
+    case PROFILE_DUMP:
+        return profile_dump();
+    case PROFILE_COUNT:
+        return profile_count((int)arg);
+    default:
+        return -1;
+    }
+}
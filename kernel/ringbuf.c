@@ -0,0 +1,76 @@
+#include "kernel.h"
+#include "kernel/ringbuf.h"
+
+void ringbuf_init(struct ringbuf *rb, uint8_t *storage, uint32_t size)
+{
+    rb->head = 0;
+    rb->commit = 0;
+    rb->tail = 0;
+    rb->size = size;
+    rb->data = storage;
+}
+
+/*
+ * 写入最多 len 字节，返回实际写入的字节数（缓冲区满时可能小于 len）。
+ * 可以被多个 hart 同时调用；本 hart 上的中断在预留和提交之间被关闭，
+ * 避免中断处理函数在同一 hart 上等待一个永远不会提交的预留。
+ */
+uint32_t ringbuf_put(struct ringbuf *rb, const void *src, uint32_t len)
+{
+    const uint8_t *s = (const uint8_t *)src;
+    uint32_t mask = rb->size - 1;
+    uint32_t head, n;
+
+    reg_t flags = local_irq_save();
+
+    head = __atomic_load_n(&rb->head, __ATOMIC_RELAXED);
+    do {
+        uint32_t tail = __atomic_load_n(&rb->tail, __ATOMIC_ACQUIRE);
+        uint32_t space = rb->size - (head - tail);
+        n = len < space ? len : space;
+        if (n == 0) {
+            local_irq_restore(flags);
+            return 0;
+        }
+    } while (!__atomic_compare_exchange_n(&rb->head, &head, head + n, 0,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    for (uint32_t i = 0; i < n; i++) {
+        rb->data[(head + i) & mask] = s[i];
+    }
+
+    // 按预留顺序提交：等待排在前面的生产者完成拷贝（只会等待一次内存拷贝的时间）
+    while (__atomic_load_n(&rb->commit, __ATOMIC_RELAXED) != head)
+        ;
+    __atomic_store_n(&rb->commit, head + n, __ATOMIC_RELEASE);
+
+    local_irq_restore(flags);
+    return n;
+}
+
+/*
+ * 读取最多 len 字节，返回实际读取的字节数。同一时刻只能有一个消费者。
+ */
+uint32_t ringbuf_get(struct ringbuf *rb, void *dst, uint32_t len)
+{
+    uint8_t *d = (uint8_t *)dst;
+    uint32_t mask = rb->size - 1;
+    uint32_t tail = __atomic_load_n(&rb->tail, __ATOMIC_RELAXED);
+    uint32_t commit = __atomic_load_n(&rb->commit, __ATOMIC_ACQUIRE);
+    uint32_t n = commit - tail;
+
+    if (n > len) {
+        n = len;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        d[i] = rb->data[(tail + i) & mask];
+    }
+    __atomic_store_n(&rb->tail, tail + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+uint32_t ringbuf_used(struct ringbuf *rb)
+{
+    return __atomic_load_n(&rb->commit, __ATOMIC_ACQUIRE) -
+           __atomic_load_n(&rb->tail, __ATOMIC_RELAXED);
+}
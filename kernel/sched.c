@@ -1,9 +1,19 @@
 #include "kernel.h"
+#include "arch/sbi.h"
+#include "string.h"
+#include "kernel/fpu.h"
+#include "kernel/stats.h"
+#include "kernel/vm.h"
+#include "kernel/hart.h"
+#include "kernel/smp.h"
+#include "kernel/cpuidle.h"
+#include "uapi/tls.h"
 
 /* defined in entry.S */
-extern void switch_to(struct context *next);
+extern void switch_to(struct context *next, volatile int *prev_on_cpu);
+extern void idle_enter(void *stack_top, void (*fn)(void), volatile int *prev_on_cpu);
 
-#define MAX_TASKS 10
+#define MAX_TASKS 32
 #define STACK_SIZE 4096  // 增加到4KB
 #define KERNEL_STACK_SIZE 4096  // 增加到4KB
 // #define TASK_USABLE(i) (((tasks[(i)].state) == TASK_READY) || ((tasks[(i)].state) == TASK_RUNNING))
@@ -15,23 +25,42 @@ extern void switch_to(struct context *next);
  * In the standard RISC-V calling convention, the stack pointer sp
  * is always 16-byte aligned.
  */
-uint8_t task_stack[MAX_TASKS][STACK_SIZE];
+uint8_t task_stack[MAX_TASKS][STACK_SIZE] __cacheline_aligned;
+// 每个任务的 TLS 块，任务运行时 tp 指向它（见 uapi/tls.h）
+uint8_t task_tls[MAX_TASKS][TLS_SIZE] __cacheline_aligned;
 uint8_t kernel_stack_kernel[KERNEL_STACK_SIZE];
-// __attribute__((aligned(16))) 
 struct task_struct tasks[MAX_TASKS];
-static LIST_HEAD(run_queues[MAX_PRIORITY]);
-static uint32_t run_queue_bitmap = 0;
+
+_Static_assert(offsetof(struct task_struct, ctx) == CACHE_LINE_SIZE,
+               "the scheduling fields of a task fit in one cache line");
+
+/*
+ * 运行队列：所有 hart 共用一个，内核锁保护，哪个 hart 都会改；
+ * pick_next_task() 跳过亲和性不包含本 hart 的任务。没有每个 hart 的
+ * 运行队列。单独占缓存行，位图和队列头在同一行里，一起修改时只让一行失效。
+ */
+static struct {
+	uint32_t bitmap;
+	struct list_head queues[MAX_PRIORITY];
+} run_queue __cacheline_aligned;
 
 static int tasks_count = 0;
-int current_task_id = -1; // 当前任务ID，-1表示没有任务在运行
+// 已经进入调度循环的 hart；几乎只读，不和经常写的数据放在一行
+static volatile unsigned long sched_hart_mask __cacheline_aligned;
 
 /*
  * _top is used to mark the max available position of tasks
  * _current is used to point to the context of current task
  */
 
+/**
+ * @brief 本 hart 的调度循环，调用时必须持有内核锁，不返回。
+ * @details 启动 hart 在 start_kernel() 的最后进入，从核由
+ *          secondary_start_kernel() 进入。
+ */
 void kernel_scheduler()
 {
+	__atomic_fetch_or(&sched_hart_mask, 1UL << this_hart(), __ATOMIC_RELEASE);
 	while (1)
 	{
 		SCHEDULE;
@@ -53,11 +82,13 @@ void back_to_os(void)
 void sched_init()
 {
 	w_sie(r_sie() | SIE_SSIE);  // Enable supervisor software interrupts
+	// 允许用户态直接读取 cycle/time/instret，用户程序计时不必陷入内核
+	w_scounteren(SCOUNTEREN_CY | SCOUNTEREN_TM | SCOUNTEREN_IR);
 
 	// Initialize the run queues and bitmap
-	run_queue_bitmap = 0;
+	run_queue.bitmap = 0;
 	for (int i = 0; i < MAX_PRIORITY; i++) {
-		INIT_LIST_HEAD(&run_queues[i]);
+		INIT_LIST_HEAD(&run_queue.queues[i]);
 	}
 
 	// Initialize tasks array
@@ -70,54 +101,198 @@ void sched_init()
 	kernel_ctx.sp = (reg_t)&kernel_stack_kernel[KERNEL_STACK_SIZE];
 	kernel_ctx.ra = (reg_t)kernel_scheduler;
 	kernel_ctx.pc = (reg_t)kernel_scheduler;
+
+	// 从这里起从核随时可能进入调度器：启动 hart 一直持有内核锁，
+	// 直到 kernel_scheduler() 第一次切换到任务
+	kernel_lock();
+}
+
+
+static void enqueue_task(struct task_struct *task)
+{
+	uint8_t prio = task->priority;
+
+	task->state = TASK_READY;
+	list_add_tail(&task->run_queue_node, &run_queue.queues[prio]);
+	run_queue.bitmap |= (1U << prio);
 }
 
+static void dequeue_task(struct task_struct *task)
+{
+	uint8_t prio = task->priority;
+
+	list_del(&task->run_queue_node);
+	if (list_empty(&run_queue.queues[prio])) {
+		run_queue.bitmap &= ~(1U << prio);
+	}
+}
 
 /**
  * @brief 从运行队列中选择下一个要运行的任务 (调度策略)。
- * @return 指向下一个任务的 task_struct 指针；如果没有就绪任务则返回 NULL。
+ * @param prev 本 hart 上刚才运行的任务，可以为 NULL
+ * @return 指向下一个任务的 task_struct 指针；如果没有可以在本 hart 上运行的
+ *         就绪任务则返回 NULL。
  *
  * @details
  *   这是核心调度策略的实现，它结合了优先级和轮转调度：
- *   1. 使用位图 (`run_queue_bitmap`) 以 O(1) 的复杂度找到最高优先级的非空运行队列。
- *   2. 从该优先级队列的头部选择第一个任务。
- *   3. 为了实现同优先级任务间
-的公平轮转 (Round-Robin)，
- *      将这个被选中的任务节点从队列头部移动到其所在队列的末尾。
+ *   1. 使用位图 (`run_queue.bitmap`) 以 O(1) 的复杂度找到最高优先级的非空运行队列。
+ *   2. 从该优先级队列的头部开始，选择第一个可以在本 hart 上运行的任务：
+ *      状态为就绪并且亲和性掩码包含本 hart（正在运行的任务也留在运行队列
+ *      里）；被隔离的 hart 只选只能在隔离 hart 上运行的任务，正在下线的
+ *      hart 什么都不选。这一级都不行就看下一级。
+ *      就绪的任务可能刚在别的 hart 上被换下，那个 hart 已经放开内核锁、
+ *      正在 switch_to() 里离开它的栈，等它清除 on_cpu 即可。
+ *   3. 为了实现同优先级任务间的公平轮转 (Round-Robin)，
+ *      将这个被选中的任务节点移到其所在队列的末尾。
+ */
+static struct task_struct *pick_next_task(struct task_struct *prev)
+{
+	unsigned long self = 1UL << this_hart();
+	int isolated = (hart_isolated_mask() & self) != 0;
+	uint32_t bitmap = run_queue.bitmap;
+
+	if (this_cpu_read(leaving)) {
+		return NULL;
+	}
+
+	while (bitmap != 0) {
+		// 1. 使用编译器内置函数 `__builtin_ctz` (计算尾部零) 来 O(1) 地找到最高优先级。
+		//    对于一个32位的整数，最低有效位的索引 = 尾部零的数量。
+		//    优先级0最高，31最低。
+		uint8_t prio = __builtin_ctz(bitmap);
+		struct list_head *pos;
+
+		// 2. 从这一级队列的头部找第一个能在本 hart 上运行的任务。
+		list_for_each(pos, &run_queue.queues[prio]) {
+			struct task_struct *task = list_entry(pos, struct task_struct, run_queue_node);
+
+			if (task->state != TASK_READY || !(task->affinity & self)) {
+				continue;
+			}
+			// 被隔离的 hart 不接走还能在别处运行的任务
+			if (isolated && (task->affinity & ~hart_isolated_mask())) {
+				continue;
+			}
+			while (task != prev && __atomic_load_n(&task->on_cpu, __ATOMIC_ACQUIRE))
+				;
+			// 3. 将被选中的任务移到其队列的末尾，以实现轮转。
+			list_del(pos);
+			list_add_tail(pos, &run_queue.queues[prio]);
+			return task;
+		}
+		bitmap &= bitmap - 1;
+	}
+	return NULL;
+}
+
+#define IDLE_STACK_SIZE 4096
+
+static DEFINE_PER_CPU(struct context, idle_ctx);
+static uint8_t idle_stack[MAXNUM_CPU][IDLE_STACK_SIZE] __cacheline_aligned;
+static void hart_die(void);
+
+/*
+ * 让某个 hart 来运行刚刚就绪的 task：优先选允许它运行的空闲 hart，
+ * 其次是正在运行的任务优先级最低、并且低于 task 的 hart。都没有就
+ * 等它们下一次调度。目标是本 hart 时只挂起调度软中断。
  */
-static struct task_struct *pick_next_task(void)
+static void resched_for(struct task_struct *task)
 {
-	if (run_queue_bitmap == 0) {
-		return NULL; // 没有就绪任务
+	unsigned long allowed = task->affinity & sched_hart_mask;
+	int target = -1;
+	int lowest = task->priority;
+
+	// 被隔离的 hart 只留给只能在它们上面运行的任务
+	if (allowed & ~hart_isolated_mask()) {
+		allowed &= ~hart_isolated_mask();
+	}
+
+	for (int h = 0; h < MAXNUM_CPU; h++) {
+		if (!(allowed & (1UL << h))) {
+			continue;
+		}
+		if (per_cpu(h, idle_running)) {
+			target = h;
+			break;
+		}
+		int cur = per_cpu(h, current_task);
+		if (cur >= 0 && tasks[cur].priority > lowest) {
+			lowest = tasks[cur].priority;
+			target = h;
+		}
+	}
+	if (target >= 0) {
+		smp_send_reschedule(target);
 	}
+}
 
-	// 1. 使用编译器内置函数 `__builtin_ctz` (计算尾部零) 来 O(1) 地找到最高优先级。
-	//    对于一个32位的整数，最低有效位的索引 = 尾部零的数量。
-	//    优先级0最高，31最低。
-	uint8_t highest_prio = __builtin_ctz(run_queue_bitmap);
+/*
+ * 空闲循环的主体，运行在本 hart 自己的空闲栈上。每一轮先给预清零页池
+ * 补充一页（被隔离的 hart 除外），池满了才由 cpuidle_enter() 选一个空闲
+ * 状态等待；等待和处理中断时放开内核锁。有任务就绪时调用 schedule()
+ * 切换过去。
+ */
+static void idle_body(void)
+{
+	int isolated = (hart_isolated_mask() & (1UL << this_hart())) != 0;
 
-	// 2. 从最高优先级队列的头部获取下一个任务节点。
-	struct list_head *next_node = run_queues[highest_prio].next;
-	struct task_struct *next_task = list_entry(next_node, struct task_struct, run_queue_node);
+	for (;;) {
+		if (this_cpu_read(leaving)) {
+			hart_die();
+		}
+		if (run_queue.bitmap) {
+			schedule();
+		}
+		// 补充页池是杂务，被隔离的 hart 不做
+		int refilled = !isolated && page_pool_refill();
+		uint64_t next_event = timer_next_event();
+		kernel_lock_drop();
+		if (!refilled) {
+			// 关中断时 wfi 和 SBI 挂起也会在有中断挂起时醒来
+			cpuidle_enter(next_event);
+		}
+		local_irq_restore(SSTATUS_SIE);
+		local_irq_save();
+		kernel_lock();
+	}
+}
 
-	// 3. 将被选中的任务移到其队列的末尾，以实现轮转。
-	list_del(next_node);
-	list_add_tail(next_node, &run_queues[highest_prio]);
+/**
+ * @brief 没有就绪任务时进入本 hart 的空闲循环，不返回。
+ * @param prev 本 hart 刚才运行的任务，可以为 NULL
+ * @details
+ *   schedule() 是在 prev 的陷阱上下文里、用 prev 的栈调用的。prev 可能
+ *   马上被别的 hart 唤醒并运行，所以空闲循环换到本 hart 自己的栈上，
+ *   换过去之后才清除 prev->on_cpu。sscratch 也换成本 hart 的 idle_ctx：
+ *   空闲期间发生的中断保存到这里，不会覆盖 prev 已经保存好的上下文。
+ */
+static void idle_loop(struct task_struct *prev)
+{
+	int hart = this_hart();
 
-	return next_task;
+	current_task_id = -1;
+	this_cpu_write(idle_running, 1);
+	this_cpu_var(idle_ctx).ktp = r_tp();
+	w_sscratch((reg_t)&this_cpu_var(idle_ctx));
+	// 调用 schedule() 的陷阱处理不会再返回
+	spin_lock_reset();
+	this_cpu_write(irq_depth, 0);
+	idle_enter(&idle_stack[hart][IDLE_STACK_SIZE], idle_body, prev ? &prev->on_cpu : NULL);
 }
 
 /**
  * @brief 调度器核心函数 (调度机制)。
  * @details
- *   此函数负责协调任务的切换。它遵循“策略与机制分离”的原则：
+ *   此函数负责协调任务的切换，调用时必须持有内核锁。它遵循“策略与机制分离”的原则：
  *   1. 将当前正在运行的任务（如果存在）的状态设置为就绪。
- *   2. 调用 `pick_next_task()` (策略) 来决策出下一个应该运行的任务。
- *   3. 更新全局的任务状态。
- *   4. 调用 `switch_to()` (机制) 来执行底层的上下文切换。
+ *   2. 调用 `pick_next_task()` (策略) 来决策出下一个应该运行的任务；
+ *      没有就绪任务时进入空闲循环 `idle_loop()`。
+ *   3. 更新本 hart 的任务状态。
+ *   4. 放开内核锁，调用 `switch_to()` (机制) 来执行底层的上下文切换。
  */
 void schedule()
 {
+	int hart = this_hart();
 	struct task_struct *current_task = NULL;
 	struct task_struct *next_task = NULL;
 
@@ -132,16 +307,23 @@ void schedule()
 	}
 
 	// 2. 策略：选择下一个要运行的任务。
-	next_task = pick_next_task();
+	next_task = pick_next_task(current_task);
+
+	// 被换下的任务还可以运行（比如亲和性不再包含本 hart）：让别的 hart 接走它
+	if (current_task != NULL && current_task != next_task && current_task->state == TASK_READY) {
+		resched_for(current_task);
+	}
 
 	if (next_task == NULL) {
-		// 在一个有空闲任务（idle task）的成熟系统中，这里不应该发生。
-		// 目前我们暂时触发 panic。
-		panic("No ready tasks to schedule!");
-		return;
+		// 已经在空闲循环里（这是空闲时的中断）：返回，继续空闲
+		if (this_cpu_read(idle_running)) {
+			return;
+		}
+		idle_loop(current_task);
 	}
+	this_cpu_write(idle_running, 0);
 
-	// 3. 更新全局状态。
+	// 3. 更新本 hart 的状态。
 	//    通过指针减法，从任务的地址计算出它在 `tasks` 数组中的索引。
 	current_task_id = next_task - tasks;
 	next_task->state = TASK_RUNNING;
@@ -150,7 +332,31 @@ void schedule()
 	//    仅当选择出的下一个任务与当前任务不同时，才执行切换。
 	//    这是一种优化，避免了不必要的上下文保存和恢复。
 	if (current_task != next_task) {
-		switch_to(&next_task->ctx);
+		if (next_task->cpu != hart) {
+			// 它的浮点/向量寄存器可能还在上一个 hart 上
+			if (next_task->cpu >= 0) {
+				fpu_migrate(current_task_id, next_task->cpu);
+				next_task->migrations++;
+			}
+			next_task->cpu = hart;
+		}
+		next_task->on_cpu = 1;
+		// 任务的 tp 归用户态使用（TLS），陷入内核时 trap_vector 从 ctx.ktp
+		// 装回本 hart 的 per-CPU 数据指针，因此在切换前记下当前 hart 的 tp。
+		next_task->ctx.ktp = r_tp();
+		// 它的页表项会留在这个 hart 的 TLB 里，改页表时要一起刷新
+		next_task->mm.cpu_mask |= 1UL << hart;
+		// 调用者可能还在 spin_lock() 的临界区里，切换后不会再回来解锁，
+		// 陷阱处理也不会再返回
+		spin_lock_reset();
+		this_cpu_write(irq_depth, 0);
+		stat_inc(context_switches);
+		// 只根据 FS/VS 调整下一个任务的 sstatus，浮点/向量寄存器按需再换
+		fpu_switch(current_task, next_task);
+		// 陷阱处理拿着的内核锁同样不会再回来放开；switch_to() 离开
+		// current_task 的栈之后才清除它的 on_cpu，之前别的 hart 不会运行它
+		kernel_lock_drop();
+		switch_to(&next_task->ctx, current_task ? &current_task->on_cpu : NULL);
 	}
 }
 
@@ -191,8 +397,9 @@ int task_create(void (*start_routine)(void *param), void *param, uint8_t priorit
 	spin_lock();
 
 	int task_id = -1;
+	// 已退出任务的槽位可以复用：它的栈在切走之后（on_cpu 清零）就不再有人使用
 	for (int i = 0; i < MAX_TASKS; i++) {
-		if (tasks[i].state == TASK_INVALID) {
+		if ((tasks[i].state == TASK_INVALID || tasks[i].state == TASK_EXITED) && !tasks[i].on_cpu) {
 			task_id = i;
 			break;
 		}
@@ -217,20 +424,34 @@ int task_create(void (*start_routine)(void *param), void *param, uint8_t priorit
 	new_task->ctx.sp = (reg_t)&task_stack[task_id][STACK_SIZE - 1];
 	new_task->ctx.pc = (reg_t)start_routine;
 	new_task->ctx.a0 = (reg_t)param;
+	// TLS 清零后 stdout 等在第一次使用时按默认值初始化
+	memset(task_tls[task_id], 0, TLS_SIZE);
+	new_task->ctx.tp = (reg_t)task_tls[task_id];
+	new_task->syscalls = 0;
+	memset(&new_task->mm, 0, sizeof(new_task->mm));
+	new_task->ctx.satp = 0;	// 第一次 sbrk/mmap 时才建立页表
 	
 	uint32_t sstatus = r_sstatus();
 	sstatus &= ~SSTATUS_SPP_MASK;
 	sstatus |= SSTATUS_SPIE;
+	// FPU 和向量单元在第一次使用时才交给任务，见 kernel/fpu.c
+	sstatus &= ~(SSTATUS_FS | SSTATUS_VS);
 	new_task->ctx.sstatus = sstatus;
+	memset(&new_task->fp, 0, sizeof(new_task->fp));
+	memset(&new_task->v, 0, sizeof(new_task->v));
+	fpu_task_release(task_id);
 
 	new_task->priority = priority;
-	new_task->state = TASK_READY;
 	new_task->timeslice = timeslice;
 	new_task->remaining_timeslice = timeslice;
+	// 被隔离的 hart 不在默认的亲和性里，要显式绑定
+	new_task->affinity = AFFINITY_ALL & ~hart_isolated_mask();
+	new_task->cpu = -1;
+	new_task->migrations = 0;
 
 	// Add the new task to the correct priority run queue
-	list_add_tail(&new_task->run_queue_node, &run_queues[priority]);
-	run_queue_bitmap |= (1U << priority);
+	enqueue_task(new_task);
+	resched_for(new_task);
 
 	printk("Task %d created: PC=0x%lx, SP=0x%lx, Prio=%d\n", task_id, new_task->ctx.pc, new_task->ctx.sp, priority);
 
@@ -238,6 +459,47 @@ int task_create(void (*start_routine)(void *param), void *param, uint8_t priorit
 	return task_id;
 }
 
+/**
+ * @brief 创建一个按写时复制共享当前任务内存的新任务。
+ * @details
+ *   子任务从 fn(arg) 开始，使用自己的栈和 TLS，优先级和时间片与父任务
+ *   相同。父任务的 sbrk 堆和匿名映射原样出现在子任务里：这里只复制页表，
+ *   物理页由两边共享，谁先写谁才得到自己的一份（见 mm/vm.c）。umalloc
+ *   的缓存指向这些页面，也一并复制，子任务可以继续分配和释放父任务的块。
+ * @param fn 子任务的入口函数
+ * @param arg 传给 fn 的参数
+ * @return 子任务的 ID，失败返回 -1
+ */
+int do_clone(void (*fn)(void *), void *arg)
+{
+	if (current_task_id < 0 || fn == NULL) {
+		return -1;
+	}
+
+	struct task_struct *parent = &tasks[current_task_id];
+	int child_id = task_create(fn, arg, parent->priority, parent->timeslice);
+	if (child_id < 0) {
+		return -1;
+	}
+
+	struct task_struct *child = &tasks[child_id];
+	child->affinity = parent->affinity;
+	if (vm_task_clone(child, parent) < 0) {
+		spin_lock();
+		list_del(&child->run_queue_node);
+		if (list_empty(&run_queue.queues[child->priority])) {
+			run_queue.bitmap &= ~(1U << child->priority);
+		}
+		mm_task_release(child);
+		child->state = TASK_INVALID;
+		spin_unlock();
+		return -1;
+	}
+	memcpy(task_tls[child_id] + TLS_UMALLOC_OFFSET, task_tls[current_task_id] + TLS_UMALLOC_OFFSET,
+	       TLS_SIZE - TLS_UMALLOC_OFFSET);
+	return child_id;
+}
+
 /*
  * DESCRIPTION
  *  task_yield() causes the calling task to relinquish the CPU and a new
@@ -271,7 +533,7 @@ long do_gethid(unsigned int *ptr_hid)
         printk("do_gethid: ptr_hid == NULL\n");
         return -1;
     }
-    *ptr_hid = r_tp(); // r_tp() 是获取Hart ID的RISC-V指令
+    *ptr_hid = this_hart();
     return 0;
 }
 
@@ -284,7 +546,8 @@ long do_gethid(unsigned int *ptr_hid)
  *   1. 从其所在的运行队列中移除当前任务。
  *   2. 检查该队列是否因此变空，如果为空，则更新运行队列位图。
  *   3. 将任务状态标记为 EXITED。
- *   4. 清理全局的 current_task_id。
+ *   4. 保留 current_task_id：schedule() 切走之后才清除它的 on_cpu，
+ *      在此之前槽位不会被 task_create() 复用。
  *   5. 立即调用 schedule() 来调度一个新任务，此函数不会返回。
  */
 void task_exit(int status)
@@ -299,14 +562,15 @@ void task_exit(int status)
 		list_del(&current_task->run_queue_node);
 
 		// 2. 如果该优先级的队列因此变空，则清除位图中对应的 bit 位。
-		if (list_empty(&run_queues[prio])) {
-			run_queue_bitmap &= ~(1U << prio);
+		if (list_empty(&run_queue.queues[prio])) {
+			run_queue.bitmap &= ~(1U << prio);
 		}
 
-		// 3. 更新任务状态并清理全局 ID。
+		// 3. 更新任务状态。
 		current_task->state = TASK_EXITED;
+		fpu_task_release(current_task_id);
+		mm_task_release(current_task);
 		printk("Task %d exited with status %d.\n", current_task_id, status);
-		current_task_id = -1;
 	}
 	spin_unlock();
 
@@ -324,12 +588,8 @@ void wake_up_task(void *arg)
 
 	if (task_id < MAX_TASKS && tasks[task_id].state == TASK_SLEEPING)
 	{
-		struct task_struct *task = &tasks[task_id];
-		uint8_t prio = task->priority;
-
-		task->state = TASK_READY;
-		list_add_tail(&task->run_queue_node, &run_queues[prio]);
-		run_queue_bitmap |= (1U << prio);
+		enqueue_task(&tasks[task_id]);
+		resched_for(&tasks[task_id]);
 	}
 }
 
@@ -361,8 +621,8 @@ void task_delay(uint32_t ticks)
 	list_del(&current_task->run_queue_node);
 
 	// 2. Update bitmap if the queue becomes empty
-	if (list_empty(&run_queues[prio])) {
-		run_queue_bitmap &= ~(1U << prio);
+	if (list_empty(&run_queue.queues[prio])) {
+		run_queue.bitmap &= ~(1U << prio);
 	}
 
 	// 3. Set state to sleeping
@@ -374,8 +634,8 @@ void task_delay(uint32_t ticks)
 	if (timer_create(wake_up_task, (void *)task_id_val, ticks) == NULL)
 	{
 		// If timer creation fails, put the task back on the run queue.
-		list_add_tail(&current_task->run_queue_node, &run_queues[prio]);
-		run_queue_bitmap |= (1U << prio);
+		list_add_tail(&current_task->run_queue_node, &run_queue.queues[prio]);
+		run_queue.bitmap |= (1U << prio);
 		current_task->state = TASK_READY;
 	}
 
@@ -385,6 +645,165 @@ void task_delay(uint32_t ticks)
 	schedule();
 }
 
+/*
+ * 等待队列
+ *
+ * 阻塞的任务不在任何运行队列里，所以直接复用 run_queue_node 把它挂到
+ * 等待队列上，状态为 TASK_BLOCKED（TASK_SLEEPING 只用于定时睡眠）。
+ *
+ * 本内核没有独立的内核栈，schedule() 切走之后不会再回到调用者，所以
+ * 阻塞分为两步：
+ *   1. prepare_to_wait(): 把当前任务从运行队列移到等待队列，但不切换；
+ *   2. 再检查一次等待条件：条件已经成立就 finish_wait() 撤销，否则
+ *      wait_for_wakeup() 切换到其它任务，不再返回。
+ * 调用者需要在第 2 步之前安排好被唤醒后的继续方式，例如把 ctx.pc 退回
+ * 到 ecall 让系统调用重新执行，或者提前写好 ctx.a0 作为返回值。
+ * 以上操作都必须在关中断的陷阱上下文中进行，中间不会错过唤醒。
+ */
+void init_waitqueue_head(struct wait_queue_head *wq)
+{
+	INIT_LIST_HEAD(&wq->task_list);
+}
+
+/**
+ * @brief 把当前任务挂到等待队列上（不切换）。
+ * @param wq 等待队列
+ * @param key 等待的对象，wake_up_key() 只唤醒 key 相同的任务；0 表示不区分
+ * @details 多个对象可以共用一个等待队列（例如 futex 的哈希桶）。
+ */
+void prepare_to_wait_key(struct wait_queue_head *wq, uintptr_t key)
+{
+	spin_lock();
+	if (current_task_id != -1) {
+		struct task_struct *current_task = &tasks[current_task_id];
+
+		if (current_task->state == TASK_RUNNING || current_task->state == TASK_READY) {
+			dequeue_task(current_task);
+		} else {
+			// 已经在某个等待队列上：换到新的队列
+			list_del(&current_task->run_queue_node);
+		}
+		current_task->state = TASK_BLOCKED;
+		current_task->wait_key = key;
+		list_add_tail(&current_task->run_queue_node, &wq->task_list);
+	}
+	spin_unlock();
+}
+
+/**
+ * @brief 把当前任务挂到等待队列上（不切换）。
+ * @param wq 等待队列
+ */
+void prepare_to_wait(struct wait_queue_head *wq)
+{
+	prepare_to_wait_key(wq, 0);
+}
+
+/**
+ * @brief 撤销 prepare_to_wait()：等待条件已经成立，当前任务继续运行。
+ * @param wq 等待队列
+ * @details 如果在此期间任务已经被唤醒，则什么也不做。
+ */
+void finish_wait(struct wait_queue_head *wq)
+{
+	(void)wq;
+
+	spin_lock();
+	if (current_task_id != -1) {
+		struct task_struct *current_task = &tasks[current_task_id];
+
+		if (current_task->state == TASK_BLOCKED) {
+			list_del(&current_task->run_queue_node);
+			enqueue_task(current_task);
+		}
+		current_task->state = TASK_RUNNING;
+	}
+	spin_unlock();
+}
+
+/**
+ * @brief 切换到其它任务，直到被 wake_up_one()/wake_up_all() 唤醒。
+ * @details 必须先调用 prepare_to_wait()；此函数不返回。
+ */
+void wait_for_wakeup(void)
+{
+	schedule();
+	panic("wait_for_wakeup: schedule() returned!");
+}
+
+/**
+ * @brief 让当前任务在等待队列上睡眠：prepare_to_wait() + wait_for_wakeup()。
+ * @param wq 等待队列
+ */
+void sleep_on(struct wait_queue_head *wq)
+{
+	prepare_to_wait(wq);
+	wait_for_wakeup();
+}
+
+/*
+ * 按 FIFO 顺序唤醒最多 nr 个（nr < 0 表示全部）key 匹配的任务，返回唤醒
+ * 的个数；key 为 0 时不区分。被唤醒的任务交给 resched_for()：有空闲的
+ * hart 就叫醒它，否则抢占正在运行低优先级任务的 hart，让它在本次陷阱
+ * 返回后立即运行，而不必等到下一个时钟节拍。
+ */
+static int __wake_up(struct wait_queue_head *wq, uintptr_t key, int nr)
+{
+	int woken = 0;
+	struct list_head *pos;
+
+	spin_lock();
+	pos = wq->task_list.next;
+	while (pos != &wq->task_list && (nr < 0 || woken < nr)) {
+		struct task_struct *task = list_entry(pos, struct task_struct, run_queue_node);
+
+		pos = pos->next;
+		if (key != 0 && task->wait_key != key) {
+			continue;
+		}
+		list_del(&task->run_queue_node);
+		enqueue_task(task);
+		resched_for(task);
+		woken++;
+	}
+	spin_unlock();
+	return woken;
+}
+
+/**
+ * @brief 按 FIFO 顺序唤醒等待队列上的一个任务。
+ * @param wq 等待队列
+ * @return 唤醒的任务数（0 或 1）
+ * @details 可以在中断处理函数中调用。
+ */
+int wake_up_one(struct wait_queue_head *wq)
+{
+	return __wake_up(wq, 0, 1);
+}
+
+/**
+ * @brief 唤醒等待队列上的所有任务。
+ * @param wq 等待队列
+ * @return 唤醒的任务数
+ * @details 可以在中断处理函数中调用。
+ */
+int wake_up_all(struct wait_queue_head *wq)
+{
+	return __wake_up(wq, 0, -1);
+}
+
+/**
+ * @brief 唤醒等待队列上最多 nr 个以 key 等待的任务。
+ * @param wq 等待队列
+ * @param key prepare_to_wait_key() 时使用的 key
+ * @param nr 最多唤醒的任务数，负数表示全部
+ * @return 唤醒的任务数
+ */
+int wake_up_key(struct wait_queue_head *wq, uintptr_t key, int nr)
+{
+	return __wake_up(wq, key, nr);
+}
+
 /**
  * @brief 获取当前任务ID
  * @return 当前任务的ID，如果没有当前任务则返回-1
@@ -394,6 +813,237 @@ int get_current_task_id(void)
     return current_task_id;
 }
 
+static int task_valid(int task_id)
+{
+	return task_id >= 0 && task_id < MAX_TASKS &&
+	       tasks[task_id].state != TASK_INVALID && tasks[task_id].state != TASK_EXITED;
+}
+
+/**
+ * @brief 设置任务可以运行的 hart。
+ * @param task_id 任务 ID
+ * @param mask hart 掩码，至少要包含一个在线的 hart
+ * @return 0 成功，-1 任务不存在或掩码无效
+ * @details
+ *   任务正在一个不再允许的 hart 上运行时，让那个 hart 重新调度，任务会被
+ *   允许它的 hart 接走；就绪的任务同样交给 resched_for()。
+ */
+int task_set_affinity(int task_id, unsigned long mask)
+{
+	mask &= AFFINITY_ALL;
+	if (!task_valid(task_id) || !(mask & smp_online_mask())) {
+		return -1;
+	}
+
+	spin_lock();
+	struct task_struct *task = &tasks[task_id];
+	task->affinity = mask;
+	if (task->state == TASK_RUNNING && !(mask & (1UL << task->cpu))) {
+		smp_send_reschedule(task->cpu);
+	} else if (task->state == TASK_READY) {
+		resched_for(task);
+	}
+	spin_unlock();
+	return 0;
+}
+
+/**
+ * @brief 读取任务可以运行的 hart。
+ * @return 0 成功，-1 任务不存在
+ */
+int task_get_affinity(int task_id, unsigned long *mask)
+{
+	if (!task_valid(task_id)) {
+		return -1;
+	}
+	*mask = tasks[task_id].affinity;
+	return 0;
+}
+
+/**
+ * @brief 任务正在运行或上次运行的 hart。
+ * @return hart 号；任务不存在或还没运行过返回 -1
+ */
+int task_get_cpu(int task_id)
+{
+	if (!task_valid(task_id)) {
+		return -1;
+	}
+	return tasks[task_id].cpu;
+}
+
+/**
+ * @brief 任务的入口函数（task_create() 的 start_routine）。
+ * @return 入口地址，任务号超出范围时返回 NULL；槽位空着时是它上一个任务的入口
+ */
+void *task_get_entry(int task_id)
+{
+	if (task_id < 0 || task_id >= MAX_TASKS) {
+		return NULL;
+	}
+	return (void *)tasks[task_id].start_routine;
+}
+
+/**
+ * @brief 时钟节拍上的调度（调度定时器的回调，见 run_timer_list()）。
+ * @details
+ *   只有 timer_init() 的 hart 有时钟中断。其它正在运行任务的 hart 各收到
+ *   一个重新调度的 IPI，同样按节拍轮转；空闲的 hart 和被隔离的 hart
+ *   不打扰，隔离的 hart 上的任务一直运行到它自己阻塞或让出。
+ */
+void scheduler_tick(void)
+{
+	int self = this_hart();
+	unsigned long ticked = sched_hart_mask & ~hart_isolated_mask();
+
+	for (int h = 0; h < MAXNUM_CPU; h++) {
+		if (h != self && (ticked & (1UL << h)) && per_cpu(h, current_task) >= 0) {
+			smp_send_reschedule(h);
+		}
+	}
+	schedule();
+}
+
+/*
+ * ==================== hart 热插拔 ====================
+ *
+ * 下线：先把 hart 从调度掩码里拿掉，只能在它上面运行的任务改为默认
+ * 亲和性，再让它重新调度。它正在运行的任务被 resched_for() 交给别的
+ * hart，它自己回到空闲循环，在 hart_die() 里把时钟和外部中断交给一个
+ * 留下的 hart，写回浮点/向量寄存器，退出跨 hart 调用，然后 SBI HSM
+ * 停止。定时器链表是全局的，跟着时钟中断一起搬走。
+ *
+ * 上线：HSM 启动它，像启动时的从核一样经 secondary_start_kernel()
+ * 进入调度循环。它下线前已经把自己的状态都清干净了。
+ */
+
+extern void _secondary_start(void);
+
+/* 接管时钟和外部中断的 hart：留在调度器里、没有被隔离，没有时返回 -1 */
+static int pick_survivor(int hart)
+{
+	unsigned long rest = sched_hart_mask & ~hart_isolated_mask() & ~(1UL << hart);
+
+	return rest ? __builtin_ctzl(rest) : -1;
+}
+
+/* 在接管的 hart 上执行 */
+static void housekeeping_func(void *arg)
+{
+	int from = (int)(long)arg;
+
+	timer_migrate_from(from);
+	plic_migrate_from(from);
+}
+
+/* 本 hart 下线，不返回。运行在空闲栈上，持有内核锁，身上没有任务。 */
+static void hart_die(void)
+{
+	int hart = this_hart();
+	int survivor = pick_survivor(hart);
+
+	if (survivor >= 0) {
+		smp_call_function(1UL << survivor, housekeeping_func, (void *)(long)hart, 1);
+	}
+	w_sie(r_sie() & ~(SIE_STIE | SIE_SEIE));
+	// 重新上线后不再采样，直到下一次 PROFILE_START
+	this_cpu_write(sample_deadline, TIMER_NEVER);
+	fpu_hart_flush();
+	// 停下之后它的 TLB 不再需要刷新
+	for (int i = 0; i < MAX_TASKS; i++) {
+		tasks[i].mm.cpu_mask &= ~(1UL << hart);
+	}
+	this_cpu_write(idle_running, 0);
+	smp_hart_offline(hart);
+	this_cpu_write(leaving, 0);
+	printk("RVOS: Hart %d offline\n", hart);
+	kernel_lock_drop();
+	hart_stop_self();
+}
+
+static int hart_stopped(int hart)
+{
+	struct sbiret st = sbi_hart_get_status(hart);
+
+	return st.error == SBI_SUCCESS && st.value == SBI_HSM_STATE_STOPPED;
+}
+
+static int hart_scheduling(int hart)
+{
+	return (sched_hart_mask & (1UL << hart)) != 0;
+}
+
+/*
+ * 放开内核锁等到 done(hart)，最多一个调度节拍。只能在系统调用里用
+ * （内核锁只拿了一层）；等待时照常执行其它 hart 发来的调用。
+ */
+static int wait_unlocked(int (*done)(int hart), int hart)
+{
+	uint64_t start = get_time();
+	int ok;
+
+	kernel_lock_drop();
+	while (!(ok = done(hart)) && get_time() - start < TIMER_INTERVAL) {
+		smp_call_handle();
+	}
+	kernel_lock();
+	return ok ? 0 : -1;
+}
+
+/**
+ * @brief 让一个 hart 下线
+ * @param hart 要下线的 hart，必须在调度器里
+ * @return 0 成功，-1 hart 无效、没有别的 hart 可以接管或者等待超时
+ * @details
+ *   只能在它上面运行的任务改为默认亲和性，并打印一行提示。下线本 hart
+ *   时立即返回，系统调用返回后任务被切走、hart 再停下；否则等它停下。
+ */
+int sched_hart_offline(int hart)
+{
+	if (hart < 0 || hart >= MAXNUM_CPU || !hart_scheduling(hart) ||
+	    per_cpu(hart, leaving) || pick_survivor(hart) < 0) {
+		return -1;
+	}
+
+	// 1. 不再给它分配任务
+	per_cpu(hart, leaving) = 1;
+	__atomic_fetch_and(&sched_hart_mask, ~(1UL << hart), __ATOMIC_RELEASE);
+
+	// 2. 只能在它上面运行的任务改到别的 hart 上
+	for (int i = 0; i < MAX_TASKS; i++) {
+		if (task_valid(i) && !(tasks[i].affinity & sched_hart_mask)) {
+			tasks[i].affinity = AFFINITY_ALL & ~hart_isolated_mask();
+			printk("Task %d: hart %d going offline, affinity reset\n", i, hart);
+			if (tasks[i].state == TASK_READY) {
+				resched_for(&tasks[i]);
+			}
+		}
+	}
+
+	// 3. 让它重新调度，正在运行的任务被别的 hart 接走
+	smp_send_reschedule(hart);
+	if (hart == this_hart()) {
+		return 0;
+	}
+	return wait_unlocked(hart_stopped, hart);
+}
+
+/**
+ * @brief 让一个停止的 hart 上线并进入调度器
+ * @return 0 成功，-1 hart 无效、不是停止状态或者启动失败
+ */
+int sched_hart_online(int hart)
+{
+	if (hart < 0 || hart >= MAXNUM_CPU || hart_scheduling(hart) ||
+	    per_cpu(hart, leaving) || !hart_stopped(hart)) {
+		return -1;
+	}
+	if (hart_start(hart, (unsigned long)_secondary_start, (unsigned long)secondary_start_kernel) != 0) {
+		return -1;
+	}
+	return wait_unlocked(hart_scheduling, hart);
+}
+
 /* 获取任务函数名称 */
 static const char *get_task_func_name(void (*func)(void *))
 {
@@ -441,6 +1091,9 @@ void print_tasks(void)
 			case TASK_SLEEPING:
 				state_str = "SLEEPING";
 				break;
+			case TASK_BLOCKED:
+				state_str = "BLOCKED";
+				break;
 			case TASK_EXITED:
 				state_str = "EXITED";
 				break;
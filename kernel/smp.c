@@ -0,0 +1,238 @@
+#include "kernel.h"
+#include "arch/sbi.h"
+#include "kernel/hart.h"
+#include "kernel/smp.h"
+#include "kernel/cpuidle.h"
+
+/*
+ * 跨 hart 函数调用
+ *
+ * per_cpu_var(call_queue, h) 是 hart h 的待执行调用，一个用 CAS 压栈的
+ * 单链表：发起者只做一次 compare-and-swap，目标用一次 exchange 取走整条
+ * 链，再倒过来按入队顺序执行，两边都不用加锁。
+ *
+ * 调用描述符属于发起者：wait 时放在发起者的栈上，目标执行完函数才清掉
+ * busy；不等待时取自发起者自己的 call_pool，目标在执行函数之前就清掉
+ * busy，槽位马上可以复用。发起者在等待槽位或结果时会顺便处理发给自己
+ * 的调用，两个 hart 互相同步调用也不会死锁。
+ */
+
+#define SMP_CALL_POOL 16
+
+struct smp_call {
+    struct smp_call *next;
+    smp_call_func_t func;
+    void *arg;
+    int wait;
+    volatile int busy;
+};
+
+/*
+ * 队列头被所有发起者 CAS、被目标 exchange；异步描述符的 busy 由目标清除。
+ * 都是跨 hart 写的，每个 hart 的队列头、每个描述符各占一个缓存行。
+ */
+struct smp_call_slot {
+    struct smp_call c;
+} __cacheline_aligned;
+
+static DEFINE_PER_CPU(struct smp_call *, call_queue);
+static struct smp_call_slot call_pool[MAXNUM_CPU][SMP_CALL_POOL];
+static volatile unsigned long online_mask;
+static DEFINE_PER_CPU(struct smp_stats, hart_stats);
+
+/* 本 hart 的陷阱入口已经就绪：打开软件中断，开始接收调用 */
+void smp_hart_online(long hartid)
+{
+    if (hartid < 0 || hartid >= MAXNUM_CPU) {
+        return;
+    }
+    w_sie(r_sie() | SIE_SSIE);
+    __atomic_fetch_or(&online_mask, 1UL << hartid, __ATOMIC_RELEASE);
+}
+
+/*
+ * 本 hart 即将停止（hart 热插拔）：不再接收调用，并执行已经排进来的。
+ * 发起者都持有内核锁，下线的 hart 也持有，所以不会有人正处在检查在线
+ * 掩码和入队之间。
+ */
+void smp_hart_offline(long hartid)
+{
+    if (hartid < 0 || hartid >= MAXNUM_CPU) {
+        return;
+    }
+    __atomic_fetch_and(&online_mask, ~(1UL << hartid), __ATOMIC_ACQ_REL);
+    smp_call_handle();
+    w_sie(r_sie() & ~SIE_SSIE);
+}
+
+unsigned long smp_online_mask(void)
+{
+    return __atomic_load_n(&online_mask, __ATOMIC_ACQUIRE);
+}
+
+/* 压入 hart 的队列；返回 1 表示队列原来是空的，需要发 IPI */
+static int call_enqueue(int hart, struct smp_call *c)
+{
+    struct smp_call *head = __atomic_load_n(&per_cpu_var(call_queue, hart), __ATOMIC_RELAXED);
+
+    do {
+        c->next = head;
+    } while (!__atomic_compare_exchange_n(&per_cpu_var(call_queue, hart), &head, c, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    return head == NULL;
+}
+
+/**
+ * @brief 执行其它 hart 发给本 hart 的全部调用
+ * @details 由 do_softirq() 在软件中断里调用，也在发起者自旋等待时调用。
+ *          必须关中断。
+ */
+void smp_call_handle(void)
+{
+    int hart = this_hart();
+    struct smp_call *list = __atomic_exchange_n(&per_cpu_var(call_queue, hart), NULL, __ATOMIC_ACQUIRE);
+    struct smp_call *fifo = NULL;
+
+    while (list != NULL) {
+        struct smp_call *next = list->next;
+        list->next = fifo;
+        fifo = list;
+        list = next;
+    }
+
+    while (fifo != NULL) {
+        struct smp_call *c = fifo;
+        smp_call_func_t func = c->func;
+        void *arg = c->arg;
+        int wait = c->wait;
+
+        fifo = c->next;
+        if (!wait) {
+            __atomic_store_n(&c->busy, 0, __ATOMIC_RELEASE);
+        }
+        func(arg);
+        if (wait) {
+            __atomic_store_n(&c->busy, 0, __ATOMIC_RELEASE);
+        }
+        per_cpu_var(hart_stats, hart).handled++;
+    }
+}
+
+/* 本 hart 一个空闲的异步调用描述符，没有就先处理自己的队列再找 */
+static struct smp_call *pool_get(int self)
+{
+    for (;;) {
+        for (int i = 0; i < SMP_CALL_POOL; i++) {
+            struct smp_call *c = &call_pool[self][i].c;
+            if (!__atomic_load_n(&c->busy, __ATOMIC_ACQUIRE)) {
+                return c;
+            }
+        }
+        smp_call_handle();
+    }
+}
+
+/**
+ * @brief 在 hart_mask 中的每个在线 hart 上执行 func(arg)
+ * @details 掩码里包含本 hart 时，在发出 IPI 之后就地执行一次。
+ *          所有目标共用一次 SBI 调用发送 IPI。
+ * @param hart_mask 目标 hart 的位掩码
+ * @param wait 为 1 时等所有目标执行完才返回
+ * @return 执行了 func 的 hart 数
+ */
+int smp_call_function(unsigned long hart_mask, smp_call_func_t func, void *arg, int wait)
+{
+    struct smp_call sync_calls[MAXNUM_CPU];
+    reg_t flags = local_irq_save();
+    int self = this_hart();
+    unsigned long targets = hart_mask & smp_online_mask() & ~(1UL << self);
+    unsigned long ipi_mask = 0;
+    int n = 0;
+
+    for (int h = 0; h < MAXNUM_CPU; h++) {
+        if (!(targets & (1UL << h))) {
+            continue;
+        }
+        struct smp_call *c = wait ? &sync_calls[h] : pool_get(self);
+        c->func = func;
+        c->arg = arg;
+        c->wait = wait;
+        c->busy = 1;
+        if (call_enqueue(h, c)) {
+            ipi_mask |= 1UL << h;
+            per_cpu_var(hart_stats, self).ipis++;
+        }
+        per_cpu_var(hart_stats, self).calls++;
+        n++;
+    }
+    if (ipi_mask) {
+        for (int h = 0; h < MAXNUM_CPU; h++) {
+            if (ipi_mask & (1UL << h)) {
+                cpuidle_kick(h);
+            }
+        }
+        sbi_send_ipi(ipi_mask, 0);
+    }
+
+    if (hart_mask & (1UL << self)) {
+        func(arg);
+        n++;
+    }
+
+    if (wait) {
+        for (int h = 0; h < MAXNUM_CPU; h++) {
+            if (!(targets & (1UL << h))) {
+                continue;
+            }
+            while (__atomic_load_n(&sync_calls[h].busy, __ATOMIC_ACQUIRE)) {
+                smp_call_handle();
+            }
+        }
+    }
+
+    local_irq_restore(flags);
+    return n;
+}
+
+static void resched_func(void *arg)
+{
+    (void)arg;
+    raise_softirq(SOFTIRQ_RESCHED);
+}
+
+/* 让 hart 在本次软件中断结束前调用 schedule() */
+void smp_send_reschedule(int hart)
+{
+    if (hart == this_hart()) {
+        raise_softirq(SOFTIRQ_RESCHED);
+        return;
+    }
+    smp_call_function(1UL << hart, resched_func, NULL, 0);
+}
+
+static void timer_arm_func(void *arg)
+{
+    timer_load((uint64_t)(uintptr_t)arg);
+}
+
+/* sbi_set_timer() 只能设置本 hart 的定时器，别的 hart 要它自己来设 */
+void smp_timer_arm(int hart, uint64_t when)
+{
+    if (hart == this_hart()) {
+        timer_load(when);
+        return;
+    }
+    smp_call_function(1UL << hart, timer_arm_func, (void *)(uintptr_t)when, 0);
+}
+
+void smp_get_stats(struct smp_stats *out)
+{
+    out->calls = 0;
+    out->ipis = 0;
+    out->handled = 0;
+    for (int i = 0; i < MAXNUM_CPU; i++) {
+        out->calls += per_cpu_var(hart_stats, i).calls;
+        out->ipis += per_cpu_var(hart_stats, i).ipis;
+        out->handled += per_cpu_var(hart_stats, i).handled;
+    }
+}
@@ -1,23 +1,97 @@
 #include "kernel.h"
+#include "kernel/hart.h"
+#include "kernel/smp.h"
 
 /* Simple interrupt-based locking for S-mode
  * This is not a true spinlock but provides basic mutual exclusion
- * by disabling interrupts during critical sections */
+ * by disabling interrupts during critical sections.
+ *
+ * Locks nest, and the outermost unlock restores the interrupt state seen
+ * by the outermost lock instead of unconditionally enabling interrupts:
+ * trap handlers run with SIE clear and must not be re-entered halfway
+ * through (a nested trap would overwrite the interrupted task's context). */
+
+/* The nesting depth and saved flags live in the per-CPU data
+ * (include/kernel/hart.h): every trap touches them. */
 
 int spin_lock()
 {
-	/* Disable supervisor interrupts */
-	w_sstatus(r_sstatus() & ~SSTATUS_SIE);
+	reg_t flags = local_irq_save();
+	struct per_cpu_data *cpu = get_cpu_data();
+
+	if (cpu->lock_depth++ == 0)
+		cpu->lock_flags = flags;
 	return 0;
 }
 
 int spin_unlock()
 {
-	/* Enable supervisor interrupts */
-	w_sstatus(r_sstatus() | SSTATUS_SIE);
+	struct per_cpu_data *cpu = get_cpu_data();
+
+	/* tolerate unbalanced unlocks (run_timer_list() + timer_handler()) */
+	if (cpu->lock_depth > 0 && --cpu->lock_depth == 0)
+		local_irq_restore(cpu->lock_flags);
 	return 0;
 }
 
+/* Called right before switch_to(): sret reloads SIE from the next
+ * context, so locks still "held" by the code that called schedule()
+ * from inside a critical section are simply forgotten. */
+void spin_lock_reset(void)
+{
+	this_cpu_write(lock_depth, 0);
+}
+
+/* Kernel lock
+ *
+ * The interrupt-based lock above only keeps out traps on the same hart.
+ * Once several harts run tasks, every trap handler holds this lock too,
+ * so only one hart at a time is inside the kernel touching shared data.
+ * It is a ticket lock (taken in arrival order) that the owning hart may
+ * take again. Callers must have interrupts off.
+ *
+ * While waiting we run calls queued by other harts (kernel/smp.c): the
+ * owner may be spinning on one of them with the lock held. */
+static struct {
+	volatile uint32_t next;
+	volatile uint32_t owner;
+} klock;
+static volatile int klock_hart = -1;
+static int klock_depth;
+
+void kernel_lock(void)
+{
+	int hart = this_hart();
+
+	if (klock_hart == hart) {
+		klock_depth++;
+		return;
+	}
+	uint32_t ticket = __atomic_fetch_add(&klock.next, 1, __ATOMIC_RELAXED);
+	while (__atomic_load_n(&klock.owner, __ATOMIC_ACQUIRE) != ticket)
+		smp_call_handle();
+	klock_hart = hart;
+	klock_depth = 1;
+}
+
+void kernel_unlock(void)
+{
+	if (klock_hart != this_hart() || --klock_depth > 0)
+		return;
+	klock_hart = -1;
+	__atomic_store_n(&klock.owner, klock.owner + 1, __ATOMIC_RELEASE);
+}
+
+/* Like spin_lock_reset(): the code that took the lock will never get
+ * back to release it (schedule() is switching away, or going idle). */
+void kernel_lock_drop(void)
+{
+	if (klock_hart == this_hart()) {
+		klock_depth = 1;
+		kernel_unlock();
+	}
+}
+
 /* Simplest option: No-op locks for debugging
  * Uncomment these and comment out the interrupt-based locks above
  * if you want to completely disable locking during initial testing */
@@ -0,0 +1,51 @@
+#include "kernel.h"
+#include "kernel/hart.h"
+#include "kernel/stats.h"
+#include "kernel/vm.h"
+
+_Static_assert(__NR_MAX <= STATS_NR_SYSCALLS, "struct kstats has a counter for every syscall");
+
+/*
+ * hart 的计数器，hart 为负数时是所有 hart 之和。别的 hart 可能正在累加，
+ * 64 位对齐的读不会读到一半，只是各个计数器不在同一时刻。
+ */
+void stats_snapshot(int hart, struct kstats *out)
+{
+    const int n = sizeof(struct kstats) / sizeof(uint64_t);
+    uint64_t *dst = (uint64_t *)out;
+
+    for (int i = 0; i < n; i++) {
+        dst[i] = 0;
+    }
+    for (int h = 0; h < MAXNUM_CPU; h++) {
+        if (hart >= 0 && h != hart) {
+            continue;
+        }
+        const volatile uint64_t *src = (const volatile uint64_t *)&per_cpu(h, stats);
+        for (int i = 0; i < n; i++) {
+            dst[i] += src[i];
+        }
+    }
+}
+
+/**
+ * @brief 把内核统计计数器的快照复制给用户
+ * @param hart 只取这个 hart 的计数器，负数表示所有 hart 之和
+ * @param buf 用户缓冲区
+ * @param size 缓冲区大小，比 struct kstats 小时只复制前面的部分
+ * @return 复制的字节数，失败返回 -1
+ */
+long do_getstats(int hart, struct kstats *buf, size_t size)
+{
+    // 快照有将近 1KB，不放在 4KB 的任务栈上；系统调用持有内核锁，不会同时使用
+    static struct kstats snap;
+
+    if (buf == NULL || hart >= MAXNUM_CPU) {
+        return -1;
+    }
+    if (size > sizeof(snap)) {
+        size = sizeof(snap);
+    }
+    stats_snapshot(hart, &snap);
+    return copy_to_user(buf, &snap, size) < 0 ? -1 : (long)size;
+}
@@ -1,34 +1,161 @@
 #include "string.h"
+#include "kernel/vector.h"
+
+/*
+ * Memory functions
+ *
+ * Work a 64-bit word at a time, with the inner loops unrolled to a
+ * 64-byte cache line. Leading bytes are copied one at a time until the
+ * destination is word aligned, and trailing bytes after the last full
+ * word. Misaligned word accesses may trap to M-mode and be emulated by
+ * the firmware, so when source and destination are not mutually aligned
+ * memcpy reads aligned source words and shifts them into place instead.
+ */
+
+#define WORD_SIZE sizeof(unsigned long)
+#define WORD_MASK (WORD_SIZE - 1)
+#define LINE_SIZE (8 * WORD_SIZE)
+
+#define IS_ALIGNED(p) (((uintptr_t)(p) & WORD_MASK) == 0)
 
 void *memcpy(void *dest, const void *src, size_t n)
 {
-    if (!dest || !src) {
+    unsigned char *d = (unsigned char *)dest;
+    const unsigned char *s = (const unsigned char *)src;
+
+    if (n >= 2 * WORD_SIZE) {
+        while (!IS_ALIGNED(d)) {
+            *d++ = *s++;
+            n--;
+        }
+
+        unsigned long *dw = (unsigned long *)d;
+
+        if (IS_ALIGNED(s)) {
+            const unsigned long *sw = (const unsigned long *)s;
+
+            while (n >= LINE_SIZE) {
+                unsigned long w0 = sw[0], w1 = sw[1], w2 = sw[2], w3 = sw[3];
+                unsigned long w4 = sw[4], w5 = sw[5], w6 = sw[6], w7 = sw[7];
+                dw[0] = w0; dw[1] = w1; dw[2] = w2; dw[3] = w3;
+                dw[4] = w4; dw[5] = w5; dw[6] = w6; dw[7] = w7;
+                dw += 8;
+                sw += 8;
+                n -= LINE_SIZE;
+            }
+            while (n >= WORD_SIZE) {
+                *dw++ = *sw++;
+                n -= WORD_SIZE;
+            }
+            s = (const unsigned char *)sw;
+        } else {
+            /*
+             * Little endian: each destination word is the high bytes of
+             * one aligned source word and the low bytes of the next. The
+             * aligned over-read never crosses a page boundary.
+             */
+            unsigned int shift = ((uintptr_t)s & WORD_MASK) * 8;
+            const unsigned long *sw = (const unsigned long *)((uintptr_t)s & ~WORD_MASK);
+            unsigned long prev = *sw++;
+
+            while (n >= WORD_SIZE) {
+                unsigned long next = *sw++;
+                *dw++ = (prev >> shift) | (next << (8 * WORD_SIZE - shift));
+                prev = next;
+                n -= WORD_SIZE;
+                s += WORD_SIZE;
+            }
+        }
+        d = (unsigned char *)dw;
+    }
+
+    while (n--) {
+        *d++ = *s++;
+    }
+    return dest;
+}
+
+/*
+ * Like memcpy, but the regions may overlap. Copying forwards is safe
+ * whenever dest is below src (every word is loaded before the stores can
+ * reach it), so only the dest-above-src overlap copies backwards.
+ */
+void *memmove(void *dest, const void *src, size_t n)
+{
+    unsigned char *d = (unsigned char *)dest;
+    const unsigned char *s = (const unsigned char *)src;
+
+    if (d == s || n == 0) {
         return dest;
     }
-    
-    char *d = (char *)dest;
-    const char *s = (const char *)src;
-    
-    for (size_t i = 0; i < n; i++) {
-        d[i] = s[i];
+    if (d < s || d >= s + n) {
+        return memcpy(dest, src, n);
+    }
+
+    d += n;
+    s += n;
+    if (n >= 2 * WORD_SIZE && (((uintptr_t)d ^ (uintptr_t)s) & WORD_MASK) == 0) {
+        while (!IS_ALIGNED(d)) {
+            *--d = *--s;
+            n--;
+        }
+
+        unsigned long *dw = (unsigned long *)d;
+        const unsigned long *sw = (const unsigned long *)s;
+
+        while (n >= LINE_SIZE) {
+            dw -= 8;
+            sw -= 8;
+            unsigned long w7 = sw[7], w6 = sw[6], w5 = sw[5], w4 = sw[4];
+            unsigned long w3 = sw[3], w2 = sw[2], w1 = sw[1], w0 = sw[0];
+            dw[7] = w7; dw[6] = w6; dw[5] = w5; dw[4] = w4;
+            dw[3] = w3; dw[2] = w2; dw[1] = w1; dw[0] = w0;
+            n -= LINE_SIZE;
+        }
+        while (n >= WORD_SIZE) {
+            *--dw = *--sw;
+            n -= WORD_SIZE;
+        }
+        d = (unsigned char *)dw;
+        s = (const unsigned char *)sw;
+    }
+
+    while (n--) {
+        *--d = *--s;
     }
-    
     return dest;
 }
 
 void *memset(void *s, int c, size_t n)
 {
-    if (!s) {
-        return s;
-    }
-    
-    unsigned char *ptr = (unsigned char *)s;
+    unsigned char *p = (unsigned char *)s;
     unsigned char value = (unsigned char)c;
-    
-    for (size_t i = 0; i < n; i++) {
-        ptr[i] = value;
+
+    if (n >= 2 * WORD_SIZE) {
+        unsigned long w = value * 0x0101010101010101UL;
+
+        while (!IS_ALIGNED(p)) {
+            *p++ = value;
+            n--;
+        }
+
+        unsigned long *pw = (unsigned long *)p;
+        while (n >= LINE_SIZE) {
+            pw[0] = w; pw[1] = w; pw[2] = w; pw[3] = w;
+            pw[4] = w; pw[5] = w; pw[6] = w; pw[7] = w;
+            pw += 8;
+            n -= LINE_SIZE;
+        }
+        while (n >= WORD_SIZE) {
+            *pw++ = w;
+            n -= WORD_SIZE;
+        }
+        p = (unsigned char *)pw;
+    }
+
+    while (n--) {
+        *p++ = value;
     }
-    
     return s;
 }
 
@@ -36,47 +163,196 @@ int memcmp(const void *s1, const void *s2, size_t n)
 {
     const unsigned char *p1 = (const unsigned char *)s1;
     const unsigned char *p2 = (const unsigned char *)s2;
-    
+
+    /* skip equal words; the first differing word is resolved bytewise below */
+    if (n >= 2 * WORD_SIZE && (((uintptr_t)p1 ^ (uintptr_t)p2) & WORD_MASK) == 0) {
+        while (!IS_ALIGNED(p1)) {
+            if (*p1 != *p2) {
+                return (int)(*p1 - *p2);
+            }
+            p1++;
+            p2++;
+            n--;
+        }
+
+        const unsigned long *w1 = (const unsigned long *)p1;
+        const unsigned long *w2 = (const unsigned long *)p2;
+        while (n >= WORD_SIZE && *w1 == *w2) {
+            w1++;
+            w2++;
+            n -= WORD_SIZE;
+        }
+        p1 = (const unsigned char *)w1;
+        p2 = (const unsigned char *)w2;
+    }
+
     for (size_t i = 0; i < n; i++) {
         if (p1[i] != p2[i]) {
             return (int)(p1[i] - p2[i]);
         }
     }
-    
+
     return 0;
 }
 
+/*
+ * String functions
+ *
+ * Scan a word at a time once the pointer is word aligned. Aligned loads
+ * never cross a page boundary, so reading past the terminating NUL within
+ * the same word is harmless.
+ *
+ * zero_bytes() flags the NUL bytes of a word. With Zbb, orc.b turns every
+ * non-zero byte into 0xff and every zero byte into 0x00, so its complement
+ * marks exactly the zero bytes; without Zbb the classic
+ * (w - 0x01..01) & ~w & 0x80..80 trick is exact for the lowest zero byte,
+ * which is the only one we look at. RISC-V is little endian, so the lowest
+ * flagged byte is the first one in memory and ctz finds it directly.
+ */
+
+#define ONES  0x0101010101010101UL
+#define HIGHS 0x8080808080808080UL
+
+static inline unsigned long zero_bytes(unsigned long w)
+{
+#ifdef __riscv_zbb
+    unsigned long r;
+    asm("orc.b %0, %1" : "=r"(r) : "r"(w));
+    return ~r;
+#else
+    return (w - ONES) & ~w & HIGHS;
+#endif
+}
+
+/* index of the first flagged byte in a non-zero mask */
+static inline unsigned int first_byte(unsigned long mask)
+{
+#ifdef __riscv_zbb
+    return __builtin_ctzl(mask) / 8;
+#else
+    unsigned int i = 0;
+    while (!(mask & 0xff)) {
+        mask >>= 8;
+        i++;
+    }
+    return i;
+#endif
+}
+
 size_t strlen(const char *s)
 {
-    if (!s) {
-        return 0;
+    const char *p = s;
+
+    while (!IS_ALIGNED(p)) {
+        if (*p == '\0') {
+            return p - s;
+        }
+        p++;
     }
-    
-    size_t len = 0;
-    const size_t MAX_STRING_LENGTH = 65536; // 64KB 限制
-    
-    while (len < MAX_STRING_LENGTH && s[len] != '\0') {
-        len++;
+
+    const unsigned long *w = (const unsigned long *)p;
+    unsigned long z;
+    while ((z = zero_bytes(*w)) == 0) {
+        w++;
     }
-    
-    return len;
+    return (const char *)w + first_byte(z) - s;
 }
 
 int strcmp(const char *s1, const char *s2)
 {
-    if (!s1 || !s2) {
-        return s1 ? 1 : (s2 ? -1 : 0);
+    const unsigned char *p1 = (const unsigned char *)s1;
+    const unsigned char *p2 = (const unsigned char *)s2;
+
+    /* bring p1 to a word boundary */
+    while (!IS_ALIGNED(p1)) {
+        if (*p1 != *p2 || *p1 == '\0') {
+            return *p1 - *p2;
+        }
+        p1++;
+        p2++;
     }
-    
-    size_t i = 0;
-    while (s1[i] && s2[i]) {
-        if (s1[i] != s2[i]) {
-            return (unsigned char)s1[i] - (unsigned char)s2[i];
+
+    const unsigned long *w1 = (const unsigned long *)p1;
+
+    if (IS_ALIGNED(p2)) {
+        const unsigned long *w2 = (const unsigned long *)p2;
+        unsigned long a, b, stop;
+
+        /* stop at the first differing byte or the first NUL, whichever is earlier */
+        for (;;) {
+            a = *w1++;
+            b = *w2++;
+            stop = (a ^ b) | zero_bytes(a);
+            if (stop) {
+                break;
+            }
         }
-        i++;
+        unsigned int shift = first_byte(stop) * 8;
+        return (int)((a >> shift) & 0xff) - (int)((b >> shift) & 0xff);
     }
-    
-    return (unsigned char)s1[i] - (unsigned char)s2[i];
+
+    /*
+     * p2 is misaligned relative to p1: assemble its words from two aligned
+     * loads. The next aligned word of p2 is only loaded once the bytes of
+     * the current one that we still need are known to hold no NUL.
+     */
+    unsigned int off = (uintptr_t)p2 & WORD_MASK;
+    unsigned int shift = off * 8;
+    const unsigned long *w2 = (const unsigned long *)((uintptr_t)p2 & ~WORD_MASK);
+    unsigned long prev = *w2++;
+
+    for (;;) {
+        if (zero_bytes(prev >> shift << shift | ((1UL << shift) - 1))) {
+            break;
+        }
+        unsigned long next = *w2++;
+        unsigned long b = (prev >> shift) | (next << (8 * WORD_SIZE - shift));
+        unsigned long a = *w1;
+        if ((a ^ b) | zero_bytes(a)) {
+            break;
+        }
+        w1++;
+        prev = next;
+    }
+
+    /* the answer is within the next few bytes */
+    p1 = (const unsigned char *)w1;
+    p2 = (const unsigned char *)s2 + (p1 - (const unsigned char *)s1);
+    while (*p1 == *p2 && *p1 != '\0') {
+        p1++;
+        p2++;
+    }
+    return *p1 - *p2;
+}
+
+char *strchr(const char *s, int c)
+{
+    unsigned char ch = (unsigned char)c;
+
+    while (!IS_ALIGNED(s)) {
+        if ((unsigned char)*s == ch) {
+            return (char *)s;
+        }
+        if (*s == '\0') {
+            return NULL;
+        }
+        s++;
+    }
+
+    const unsigned long *w = (const unsigned long *)s;
+    unsigned long pattern = ch * ONES;
+    unsigned long stop;
+    for (;;) {
+        unsigned long x = *w;
+        stop = zero_bytes(x) | zero_bytes(x ^ pattern);
+        if (stop) {
+            break;
+        }
+        w++;
+    }
+
+    const char *p = (const char *)w + first_byte(stop);
+    return (unsigned char)*p == ch ? (char *)p : NULL;
 }
 
 int strncmp(const char *s1, const char *s2, size_t n)
@@ -176,3 +452,63 @@ void fast_memzero(void *s, size_t n)
 {
     memset(s, 0, n);
 }
+
+/*
+ * Kernel-only variants
+ *
+ * memcpy() and friends above are shared with user code, which runs with
+ * the vector unit switched off, so they must stay scalar. The kernel can
+ * call these instead: when the boot hart has V (see kernel/vector.c) and
+ * the buffer is large enough to pay for toggling sstatus.VS, they use the
+ * RVV loops in arch/riscv/vector.S, otherwise they are the scalar versions.
+ */
+
+#define VEC_MIN_BYTES 256
+
+void *kmemcpy(void *dest, const void *src, size_t n)
+{
+    reg_t flags;
+
+    if (n >= VEC_MIN_BYTES && kernel_vector_begin(&flags)) {
+        vec_memcpy(dest, src, n);
+        kernel_vector_end(flags);
+        return dest;
+    }
+    return memcpy(dest, src, n);
+}
+
+void *kmemset(void *s, int c, size_t n)
+{
+    reg_t flags;
+
+    if (n >= VEC_MIN_BYTES && kernel_vector_begin(&flags)) {
+        vec_memset(s, c, n);
+        kernel_vector_end(flags);
+        return s;
+    }
+    return memset(s, c, n);
+}
+
+int kmemcmp(const void *s1, const void *s2, size_t n)
+{
+    reg_t flags;
+
+    if (n >= VEC_MIN_BYTES && kernel_vector_begin(&flags)) {
+        int ret = vec_memcmp(s1, s2, n);
+        kernel_vector_end(flags);
+        return ret;
+    }
+    return memcmp(s1, s2, n);
+}
+
+size_t kstrlen(const char *s)
+{
+    reg_t flags;
+
+    if (kernel_vector_begin(&flags)) {
+        size_t len = vec_strlen(s);
+        kernel_vector_end(flags);
+        return len;
+    }
+    return strlen(s);
+}
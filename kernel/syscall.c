@@ -2,9 +2,12 @@
 #include "kernel/sched.h"
 #include "kernel/printk.h"
 #include "kernel/timer.h"
+#include "kernel/uart.h"
 #include "string.h"
 #include "arch/sbi.h"
 #include "syscalls.h"
+#include "kernel/vm.h"
+#include "kernel/stats.h"
 
 /* ==================== 系统调用实现 ==================== */
 
@@ -31,18 +34,61 @@ long do_write(int fd, const void *buf, size_t len)
     }
 
     char k_buf[MAX_WRITE_LEN];
-    memcpy(k_buf, buf, len);
-
-    for (size_t i = 0; i < len; i++) {
-        sbi_console_putchar(k_buf[i]);
+    if (copy_from_user(k_buf, buf, len) < 0) {
+        return -1;
     }
-    return len;
+
+    // 只是放入串口发送缓冲区，不等待串口线路
+    return uart_write(k_buf, len);
 }
 
 long do_read(int fd, void *buf, size_t count)
 {
-    (void)fd; (void)buf; (void)count;
-    return -1; // 暂未实现
+    if (fd != 0) {
+        printk("sys_read: Invalid file descriptor %d.\n", fd);
+        return -1;
+    }
+    if (buf == NULL) {
+        printk("sys_read: Invalid user buffer (NULL).\n");
+        return -1;
+    }
+
+    // buf 可能在任务页表的用户窗口里，先读进内核缓冲区
+    char k_buf[MAX_WRITE_LEN];
+    if (count > sizeof(k_buf)) {
+        count = sizeof(k_buf);
+    }
+
+    if (current_task_id == -1) {
+        // 不是由调度器管理的上下文，不能睡眠
+        size_t n = uart_read(k_buf, count);
+        return copy_to_user(buf, k_buf, n) < 0 ? -1 : (long)n;
+    }
+
+    struct context *ctx = &tasks[current_task_id].ctx;
+    for (;;) {
+        size_t n = uart_read(k_buf, count);
+        if (n > 0 || count == 0) {
+            return copy_to_user(buf, k_buf, n) < 0 ? -1 : (long)n;
+        }
+        // 还没有输入：在 UART 的等待队列上睡眠。被中断唤醒后从 ecall 重新
+        // 执行本系统调用（a0-a2 仍保存着原来的参数），所以先把 pc 退回去。
+        ctx->pc -= 4;
+        uart_wait_rx();
+        ctx->pc += 4;
+    }
+}
+
+/* 控制台接收统计：唤醒读者的次数、唤醒延迟和溢出丢掉的字节 */
+int do_console_stats(struct uart_rx_stats *stats)
+{
+    struct uart_rx_stats st;
+
+    if (stats == NULL) {
+        return -1;
+    }
+    uart_get_rx_stats(&st);
+    return copy_to_user(stats, &st, sizeof(st)) < 0 ? -1 : 0;
 }
 
 void do_yield(void)
@@ -96,6 +142,71 @@ long do_hart_current_id(void)
     return sbi_get_hartid();
 }
 
+/**
+ * @brief 让一个停止的 hart 上线并加入调度
+ * @return 0 成功，-1 失败
+ */
+int do_hart_online(int hartid)
+{
+    return sched_hart_online(hartid);
+}
+
+/**
+ * @brief 让一个 hart 下线，它上面的任务和定时器交给其它 hart
+ * @return 0 成功，-1 失败（比如它是最后一个可以接管时钟的 hart）
+ */
+int do_hart_offline(int hartid)
+{
+    return sched_hart_offline(hartid);
+}
+
+/* pid 为负数时表示调用者自己（任务 ID 从 0 开始，0 不能像 Linux 那样表示自己） */
+static int affinity_task(int pid)
+{
+    return pid < 0 ? get_current_task_id() : pid;
+}
+
+/**
+ * @brief 设置任务可以运行的 hart
+ * @param pid 任务 ID，负数表示当前任务
+ * @param size mask 指向的字节数，至少 sizeof(unsigned long)
+ * @param mask hart 位掩码，第 i 位表示 hart i
+ * @return 0 成功，-1 任务不存在或掩码里没有在线的 hart
+ */
+int do_sched_setaffinity(int pid, size_t size, const unsigned long *mask)
+{
+    unsigned long m;
+
+    if (size < sizeof(m) || copy_from_user(&m, mask, sizeof(m)) < 0) {
+        return -1;
+    }
+    return task_set_affinity(affinity_task(pid), m);
+}
+
+/**
+ * @brief 读取任务可以运行的 hart
+ * @return 0 成功，-1 任务不存在或缓冲区无效
+ */
+int do_sched_getaffinity(int pid, size_t size, unsigned long *mask)
+{
+    unsigned long m;
+
+    if (size < sizeof(m) || task_get_affinity(affinity_task(pid), &m) < 0) {
+        return -1;
+    }
+    return copy_to_user(mask, &m, sizeof(m)) < 0 ? -1 : 0;
+}
+
+/**
+ * @brief 任务正在运行或上次运行的 hart
+ * @param pid 任务 ID，负数表示当前任务
+ * @return hart 号，-1 任务不存在或还没运行过
+ */
+int do_sched_getcpu(int pid)
+{
+    return task_get_cpu(affinity_task(pid));
+}
+
 /* ==================== 系统调用分发 ==================== */
 
 // 生成系统调用表
@@ -127,6 +238,13 @@ void verify_syscall_table(void)
 void do_syscall(struct context *ctx)
 {
     uint32_t num = ctx->a7;
+
+    if (current_task_id >= 0) {
+        tasks[current_task_id].syscalls++;
+    }
+    if (num < STATS_NR_SYSCALLS) {
+        stat_inc(syscalls[num]);
+    }
     
     // 添加调试信息
     // printk("DEBUG: syscall num=%d, table addr=%p\n", num, syscall_table);
@@ -1,5 +1,8 @@
 #include "kernel.h"
 #include "arch/sbi.h"
+#include "kernel/hart.h"
+#include "kernel/smp.h"
+#include "kernel/stats.h"
 extern timer *insert_to_timer_list(timer *timer_head, timer *_timer);
 extern timer *delete_from_timer_list(timer *timer_head, timer *_timer);
 timer *timers = NULL, *next_timer = NULL;
@@ -7,19 +10,55 @@ timer *timers = NULL, *next_timer = NULL;
 extern void schedule(void);
 
 static uint32_t _tick = 0;
+// 处理时钟中断的 hart，timer_init() 之前为 -1
+static int timer_hart = -1;
 
 /* Wrapper function to match timer callback signature */
 static void schedule_wrapper(void *arg)
 {
     (void)arg; // Suppress unused parameter warning
-    schedule();
+    // 被隔离的 hart 不自己刷新 printk，由这里代劳
+    printk_tick();
+    scheduler_tick();
+}
+
+/*
+ * 设置本 hart 的硬件定时器：定时器链表的到期时间（只有 timer_hart 处理）
+ * 和下一次采样（kernel/profile.c）中较早的一个。
+ */
+static void timer_program(void)
+{
+    uint64_t when = this_cpu_read(sample_deadline);
+
+    if (this_hart() == timer_hart && this_cpu_read(timer_deadline) < when) {
+        when = this_cpu_read(timer_deadline);
+    }
+    /* Use SBI call to set timer instead of direct CLINT access */
+    sbi_set_timer(when);
 }
 
 /* load timer interval(in ticks) for next timer interrupt.*/
 void timer_load(uint64_t timeout_tick)
 {
-    /* Use SBI call to set timer instead of direct CLINT access */
-    sbi_set_timer(timeout_tick);
+    this_cpu_write(timer_deadline, timeout_tick);
+    timer_program();
+}
+
+/*
+ * 设置本 hart 下一次采样的时间，TIMER_NEVER 表示停止采样。不处理定时器
+ * 链表的 hart 只在采样期间打开时钟中断。
+ */
+void timer_set_sample(uint64_t when)
+{
+    this_cpu_write(sample_deadline, when);
+    if (this_hart() != timer_hart) {
+        if (when == TIMER_NEVER) {
+            w_sie(r_sie() & ~SIE_STIE);
+        } else {
+            w_sie(r_sie() | SIE_STIE);
+        }
+    }
+    timer_program();
 }
 
 uint64_t get_time(void)
@@ -38,6 +77,7 @@ void timer_init()
 
     /* enable supervisor-mode timer interrupts. */
     w_sie(r_sie() | SIE_STIE);
+    timer_hart = this_hart();
     /* supervisor-mode global interrupts are controlled by sstatus.SIE */
     w_sstatus(r_sstatus() | SSTATUS_SIE);
 }
@@ -54,7 +94,10 @@ timer *timer_create(void (*handler)(void *arg), void *arg, uint32_t timeout)
     t->timeout_tick = get_time() + timeout * TIMER_INTERVAL;
     t->next = NULL;
     timers = insert_to_timer_list(timers, t);
-    // timer_load(timeout); // 确保加载定时器
+    // 新的定时器最早到期：马上重设硬件定时器，从别的 hart 创建时由 IPI 代劳
+    if (timers == t && timer_hart >= 0) {
+        smp_timer_arm(timer_hart, t->timeout_tick);
+    }
     return t;
 }
 
@@ -64,6 +107,37 @@ void timer_delete(timer *timer)
     free(timer);
 }
 
+/*
+ * 在接管的 hart 上调用：hart 要下线时，如果时钟中断由它处理，改由本
+ * hart 处理，并按最早的定时器重新设置本 hart 的定时器。
+ */
+void timer_migrate_from(int hart)
+{
+    if (timer_hart != hart || hart == this_hart()) {
+        return;
+    }
+    timer_hart = this_hart();
+    w_sie(r_sie() | SIE_STIE);
+    if (timers != NULL) {
+        timer_load(timers->timeout_tick);
+    }
+}
+
+/*
+ * 本 hart 下一次时钟中断的时间：timer_hart 上定时器链表的到期时间，以及
+ * 采样时的下一次采样。读本 hart 自己记下的时间，空闲循环不用去碰全局的
+ * 定时器链表。
+ */
+uint64_t timer_next_event(void)
+{
+    uint64_t next = this_cpu_read(sample_deadline);
+
+    if (this_hart() == timer_hart && this_cpu_read(timer_deadline) < next) {
+        next = this_cpu_read(timer_deadline);
+    }
+    return next;
+}
+
 void run_timer_list()
 {
     // printk("timer expired: %ld\n", timers->timeout_tick);
@@ -72,6 +146,7 @@ void run_timer_list()
     {
         timer *expired = timers;
         timers = timers->next;
+        stat_inc(timer_expiries);
 
         // 执行定时器回调
         expired->func(expired->arg);
@@ -90,6 +165,11 @@ void run_timer_list()
 
 void timer_handler()
 {
+    // 其它 hart 上的时钟中断只用于采样，样本已经记下，设置下一次即可
+    if (this_hart() != timer_hart) {
+        timer_program();
+        return;
+    }
     spin_lock();
     //printk("tick: %d\n", _tick++);
     //printk("time: %ld\n", get_time());
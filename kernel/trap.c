@@ -1,42 +1,97 @@
 #include "kernel.h"
 #include "arch/sbi.h"
 #include "kernel/sched.h"  // 包含调度器头文件，获取extern声明
+#include "kernel/uart.h"
+#include "kernel/hart.h"
+#include "kernel/fpu.h"
+#include "kernel/vm.h"
+#include "kernel/smp.h"
+#include "kernel/stats.h"
+#include "kernel/profile.h"
 
 extern void trap_vector(void);
-extern void uart_isr(void);
 extern void timer_handler(void);
 extern void schedule(void);
 extern void do_syscall(struct context *ctx);
 
 extern int current_ctx;
-struct context context_inited = {0};
 
-void trap_init()
-{	/*
+/*
+ * 调度器切换到第一个任务之前，陷阱保存寄存器用的上下文。
+ * 每个 hart 一个：trap_vector 还要从其中的 ktp 取回内核的 tp。
+ */
+static struct context boot_ctx[MAXNUM_CPU];
+
+/**
+ * @brief 初始化当前 hart 的陷阱入口
+ * @param hartid 当前 hart 的 ID，用来选择它的启动上下文
+ * @note 调用时的 tp 就是此后陷入内核时使用的 tp
+ */
+void trap_init(long hartid)
+{
+	struct context *ctx = &boot_ctx[hartid < MAXNUM_CPU ? hartid : 0];
+
+	ctx->ktp = r_tp();
+	/*
 	 * set the trap-vector base-address for supervisor-mode
 	 */
 	asm volatile("csrw stvec, %0" : : "r" ((reg_t)trap_vector));
-	asm volatile("csrw sscratch, %0" : : "r" ((reg_t)&context_inited));
+	asm volatile("csrw sscratch, %0" : : "r" ((reg_t)ctx));
+
+	// 陷阱入口就绪后就可以接收其它 hart 的调用了
+	smp_hart_online(hartid);
+}
+
+void external_interrupt_handler()
+{
+	int irq = plic_claim();
+
+	if (irq == UART0_IRQ)
+	{
+		uart_isr();
+	}
+	else if (irq)
+	{
+		printk("unexpected interrupt irq = %d\n", irq);
+	}
+
+	if (irq)
+	{
+		plic_complete(irq);
+	}
+}
+
+/**
+ * @brief 在当前 hart 上挂起一个软中断
+ * @details
+ *   只设置 pending 位和 sip.SSIP，不做任何实际工作。内核在陷阱处理中
+ *   始终关中断，所以软中断会在本次陷阱返回、重新开中断之后才执行。
+ * @param nr 软中断号 (SOFTIRQ_*)
+ */
+void raise_softirq(int nr)
+{
+	__atomic_fetch_or(&get_cpu_data()->softirq_pending, 1UL << nr, __ATOMIC_RELAXED);
+	set_sip(SIP_SSIP);
 }
 
-// void external_interrupt_handler()
-// {
-// 	int irq = plic_claim();
-
-// 	if (irq == UART0_IRQ)
-// 	{
-// 		uart_isr();
-// 	}
-// 	else if (irq)
-// 	{
-// 		printk("unexpected interrupt irq = %d\n", irq);
-// 	}
-
-// 	if (irq)
-// 	{
-// 		plic_complete(irq);
-// 	}
-// }
+/**
+ * @brief 执行当前 hart 上挂起的软中断
+ * @details
+ *   其它 hart 的 IPI 也以软件中断的形式到达，trap_handler() 在拿内核锁
+ *   之前已经执行了它们排进来的调用（kernel/smp.c），这些调用可能再挂起
+ *   软中断，比如远程重新调度。schedule() 不会返回，所以放在最后执行。
+ */
+void do_softirq(void)
+{
+	unsigned long pending = __atomic_exchange_n(&get_cpu_data()->softirq_pending, 0, __ATOMIC_ACQ_REL);
+
+	if (pending & (1UL << SOFTIRQ_PRINTK)) {
+		printk_softirq();
+	}
+	if (pending & (1UL << SOFTIRQ_RESCHED)) {
+		schedule();
+	}
+}
 
 /**
  * @brief 内核的中心陷阱处理器
@@ -54,6 +109,24 @@ reg_t trap_handler(reg_t epc, reg_t cause, struct context *ctx)
 {	reg_t return_pc = epc;
 	reg_t cause_code = cause & 0xfff;
 	//printk("trap_handler\n");
+
+	this_cpu_inc(irq_depth);
+	if (cause_code < STATS_NR_CAUSES) {
+		if (cause & 0x8000000000000000ULL) {
+			stat_inc(interrupts[cause_code]);
+		} else {
+			stat_inc(exceptions[cause_code]);
+		}
+	}
+
+	// 跨 hart 调用不拿内核锁执行：发起者可能正拿着锁同步等它们执行完
+	if ((cause & 0x8000000000000000ULL) && cause_code == 1) {
+		clear_sip(SIP_SSIP);
+		smp_call_handle();
+	}
+	// 陷阱处理期间持有内核锁；调用 schedule() 切走时由它放开
+	kernel_lock();
+
 	if (cause & 0x8000000000000000ULL) // 64-bit interrupt flag
 	{
 		// 异步陷阱：中断处理
@@ -61,16 +134,15 @@ reg_t trap_handler(reg_t epc, reg_t cause, struct context *ctx)
 		{
 		case 1: // Supervisor software interrupt
 		{
-			/* In S-mode, clear the software interrupt via SBI */
-			sbi_clear_ipi();
-			schedule();
+			do_softirq();
 			break;
 		}
 		case 5: // Supervisor timer interrupt
+			profile_tick(epc, !(r_sstatus() & SSTATUS_SPP));
 			timer_handler();
 			break;
 		case 9: // Supervisor external interrupt
-			//external_interrupt_handler();
+			external_interrupt_handler();
 			break;
 		default:
 			printk("未知的异步异常！\n");
@@ -83,6 +155,10 @@ reg_t trap_handler(reg_t epc, reg_t cause, struct context *ctx)
 		switch (cause_code)
 		{
 		case 2:
+			// 任务第一次使用浮点/向量指令：交给它 FPU/向量单元后重新执行
+			if (fpu_trap(epc)) {
+				break;
+			}
 			printk("Illegal instruction!\n");
 			printk("PC: 0x%lx, Cause: 0x%lx\n", epc, cause);
 			printk("Current task ID: %d\n", current_task_id);
@@ -92,12 +168,28 @@ reg_t trap_handler(reg_t epc, reg_t cause, struct context *ctx)
 			while (1);
 			break;
 		case 5:
-			printk("Fault load!\n");
-			while(1);
-			break;
 		case 7:
-			printk("Fault store!\n");
-			while(1);
+			printk("%s access fault! addr 0x%lx, PC: 0x%lx\n",
+			       cause_code == 5 ? "Load" : "Store", r_stval(), epc);
+			if (current_task_id >= 0 && !(r_sstatus() & SSTATUS_SPP)) {
+				// 和缺页一样，用户态的访问错误只结束这个任务
+				task_exit(-1);
+			}
+			while (1);
+			break;
+		case 13:
+		case 15:
+			// 用户窗口里的页第一次被访问，或者写了写时复制的页：
+			// 分配清零的页面或复制一份后重新执行
+			if (vm_fault(r_stval(), cause_code == 15)) {
+				break;
+			}
+			printk("Page fault! addr 0x%lx, PC: 0x%lx, Cause: 0x%lx\n", r_stval(), epc, cause);
+			if (current_task_id >= 0 && !(r_sstatus() & SSTATUS_SPP)) {
+				// 非法的用户访问只结束这个任务
+				task_exit(-1);
+			}
+			while (1);
 			break;
 		case 8:
 			///printk("Environment call from U-mode!\n");
@@ -122,5 +214,7 @@ reg_t trap_handler(reg_t epc, reg_t cause, struct context *ctx)
 			break;
 		}
 	}
+	kernel_unlock();
+	this_cpu_write(irq_depth, this_cpu_read(irq_depth) - 1);
 	return return_pc;
 }
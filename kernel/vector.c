@@ -0,0 +1,114 @@
+#include "kernel.h"
+#include "fdt.h"
+#include "string.h"
+#include "kernel/vector.h"
+#include "kernel/fpu.h"
+
+/*
+ * RISC-V Vector extension support
+ *
+ * The kernel uses V only through the kmem*() helpers in kernel/string.c.
+ * It turns VS on around each use and back off afterwards. User tasks get
+ * the vector unit lazily (kernel/fpu.c); if one of them owns the live
+ * registers, the kernel writes them back to the task before using V.
+ */
+
+int has_vector = 0;
+unsigned long vector_vlenb = 0;
+
+/* "rv64imafdcvh_zicsr_...": the single-letter extensions end at the first '_' */
+static int isa_string_has_v(const char *isa, int len)
+{
+    if (len < 5 || strncmp(isa, "rv", 2) != 0) {
+        return 0;
+    }
+    for (int i = 4; i < len && isa[i] != '\0' && isa[i] != '_'; i++) {
+        if (isa[i] == 'v') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* newer device trees also list extensions one per string in riscv,isa-extensions */
+static int stringlist_contains(const char *list, int len, const char *name)
+{
+    int pos = 0;
+
+    while (pos < len) {
+        if (strcmp(list + pos, name) == 0) {
+            return 1;
+        }
+        pos += strlen(list + pos) + 1;
+    }
+    return 0;
+}
+
+/*
+ * DESCRIPTION:
+ *	Decide once, on the boot hart, whether the kmem*() helpers may use
+ *	the vector unit, and leave sstatus.VS Off so that every task created
+ *	afterwards inherits VS = Off.
+ */
+void vector_init(void)
+{
+    void *fdt = (void *)get_dtb_addr();
+    uint64_t hartid = get_boot_hartid();
+    const char *prop;
+    int len = 0;
+
+    w_sstatus(r_sstatus() & ~SSTATUS_VS);
+
+    if (fdt != NULL && fdt_check_header(fdt) == 0) {
+        prop = fdt_get_cpu_property(fdt, hartid, "riscv,isa-extensions", &len);
+        if (prop != NULL) {
+            has_vector = stringlist_contains(prop, len, "v");
+        } else {
+            prop = fdt_get_cpu_property(fdt, hartid, "riscv,isa", &len);
+            if (prop != NULL) {
+                has_vector = isa_string_has_v(prop, len);
+            }
+        }
+    }
+
+    if (has_vector) {
+        /* VS is WARL: if it does not stick, the hart cannot run V code */
+        w_sstatus(r_sstatus() | SSTATUS_VS_INITIAL);
+        if ((r_sstatus() & SSTATUS_VS) == SSTATUS_VS_OFF) {
+            has_vector = 0;
+        } else {
+            vector_vlenb = vec_vlenb();
+            printk("vector: RVV present, VLEN=%ld bits, kernel memory helpers use V\n",
+                   (long)vector_vlenb * 8);
+        }
+        w_sstatus(r_sstatus() & ~SSTATUS_VS);
+    }
+
+    if (!has_vector) {
+        printk("vector: no V extension, kernel memory helpers stay scalar\n");
+    }
+}
+
+int kernel_vector_begin(reg_t *flags)
+{
+    if (!has_vector) {
+        return 0;
+    }
+
+    *flags = local_irq_save();
+    int live_dirty = (r_sstatus() & SSTATUS_VS) == SSTATUS_VS_DIRTY;
+    w_sstatus((r_sstatus() & ~SSTATUS_VS) | SSTATUS_VS_INITIAL);
+    vector_evict_user(live_dirty);
+    return 1;
+}
+
+void kernel_vector_end(reg_t flags)
+{
+    /*
+     * The registers now hold kernel data nobody needs: switch V off. If the
+     * interrupted task was the owner, its next vector instruction traps and
+     * reloads its saved state.
+     */
+    w_sstatus(r_sstatus() & ~SSTATUS_VS);
+    local_irq_restore(flags);
+}
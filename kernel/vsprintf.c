@@ -0,0 +1,322 @@
+#include "vsprintf.h"
+#include "string.h"
+
+/*
+ * Formatting engine
+ *
+ * Linked once and used by both printk() and the user printf(), so like
+ * kernel/string.c it must not depend on anything kernel-only.
+ *
+ * Output is produced in chunks: runs of literal text, padding and the
+ * digits of a number are each appended with a single clipped memcpy or
+ * memset instead of checking the space left for every character.
+ * Numbers are built right to left in a small scratch buffer: decimal two
+ * digits per step from a 00..99 table, with the division by 100 done as
+ * a multiply by its reciprocal; hex one nibble per shift.
+ */
+
+#define FL_LEFT     (1 << 0)    /* '-' */
+#define FL_ZERO     (1 << 1)    /* '0' */
+#define FL_ALT      (1 << 2)    /* '#' */
+#define FL_PLUS     (1 << 3)    /* '+' */
+#define FL_SPACE    (1 << 4)    /* ' ' */
+
+struct fmt_out {
+    char *buf;
+    size_t cap;     /* bytes that may be stored, not counting the NUL */
+    size_t pos;     /* bytes the complete output needs so far */
+};
+
+struct fmt_spec {
+    int flags;
+    size_t width;
+    int precision;  /* -1 when not given */
+};
+
+static const char dec_pairs[200] =
+    "00010203040506070809" "10111213141516171819"
+    "20212223242526272829" "30313233343536373839"
+    "40414243444546474849" "50515253545556575859"
+    "60616263646566676869" "70717273747576777879"
+    "80818283848586878889" "90919293949596979899";
+
+static const char hex_lower[] = "0123456789abcdef";
+static const char hex_upper[] = "0123456789ABCDEF";
+
+static void emit(struct fmt_out *o, const char *src, size_t len)
+{
+    if (o->pos < o->cap) {
+        size_t room = o->cap - o->pos;
+        memcpy(o->buf + o->pos, src, len < room ? len : room);
+    }
+    o->pos += len;
+}
+
+static void emit_fill(struct fmt_out *o, char c, size_t len)
+{
+    if (o->pos < o->cap) {
+        size_t room = o->cap - o->pos;
+        memset(o->buf + o->pos, c, len < room ? len : room);
+    }
+    o->pos += len;
+}
+
+static inline unsigned long mulhu(unsigned long a, unsigned long b)
+{
+#ifdef __riscv
+    unsigned long hi;
+    asm("mulhu %0, %1, %2" : "=r"(hi) : "r"(a), "r"(b));
+    return hi;
+#else
+    return (unsigned long)(((unsigned __int128)a * b) >> 64);
+#endif
+}
+
+/* v / 100 for any 64-bit v: ((v >> 2) * ceil(2^68 / 100)) >> 68 */
+static inline unsigned long div100(unsigned long v)
+{
+    return mulhu(v >> 2, 0x28f5c28f5c28f5c3UL) >> 2;
+}
+
+/* Write v in decimal so that it ends right before end; return its first digit */
+static char *put_dec(char *end, unsigned long v)
+{
+    while (v >= 100) {
+        unsigned long q = div100(v);
+        unsigned long r = v - q * 100;
+        end -= 2;
+        end[0] = dec_pairs[2 * r];
+        end[1] = dec_pairs[2 * r + 1];
+        v = q;
+    }
+    if (v >= 10) {
+        end -= 2;
+        end[0] = dec_pairs[2 * v];
+        end[1] = dec_pairs[2 * v + 1];
+    } else {
+        *--end = (char)('0' + v);
+    }
+    return end;
+}
+
+static char *put_hex(char *end, unsigned long v, const char *digits)
+{
+    do {
+        *--end = digits[v & 0xf];
+        v >>= 4;
+    } while (v);
+    return end;
+}
+
+/* [spaces][prefix][zeros][digits][spaces] */
+static void emit_number(struct fmt_out *o, const struct fmt_spec *spec,
+                        const char *prefix, size_t prefix_len,
+                        const char *digits, size_t ndigits)
+{
+    size_t zeros = 0;
+    if (spec->precision >= 0 && (size_t)spec->precision > ndigits) {
+        zeros = (size_t)spec->precision - ndigits;
+    }
+
+    size_t len = prefix_len + zeros + ndigits;
+    size_t pad = spec->width > len ? spec->width - len : 0;
+
+    if (pad && !(spec->flags & FL_LEFT)) {
+        if ((spec->flags & FL_ZERO) && spec->precision < 0) {
+            zeros += pad;
+        } else {
+            emit_fill(o, ' ', pad);
+        }
+        pad = 0;
+    }
+    emit(o, prefix, prefix_len);
+    emit_fill(o, '0', zeros);
+    emit(o, digits, ndigits);
+    emit_fill(o, ' ', pad);
+}
+
+static void emit_text(struct fmt_out *o, const struct fmt_spec *spec,
+                      const char *s, size_t len)
+{
+    size_t pad = spec->width > len ? spec->width - len : 0;
+
+    if (!(spec->flags & FL_LEFT)) {
+        emit_fill(o, ' ', pad);
+    }
+    emit(o, s, len);
+    if (spec->flags & FL_LEFT) {
+        emit_fill(o, ' ', pad);
+    }
+}
+
+int vsnprintf(char *out, size_t n, const char *fmt, va_list ap)
+{
+    struct fmt_out o = { out, (out && n) ? n - 1 : 0, 0 };
+    char tmp[24];       /* 20 decimal or 16 hex digits */
+    char *end = tmp + sizeof(tmp);
+
+    while (*fmt) {
+        if (*fmt != '%') {
+            const char *pct = strchr(fmt, '%');
+            size_t run = pct ? (size_t)(pct - fmt) : strlen(fmt);
+            emit(&o, fmt, run);
+            fmt += run;
+            continue;
+        }
+        fmt++;
+
+        struct fmt_spec spec = { 0, 0, -1 };
+        for (;; fmt++) {
+            if (*fmt == '-') {
+                spec.flags |= FL_LEFT;
+            } else if (*fmt == '0') {
+                spec.flags |= FL_ZERO;
+            } else if (*fmt == '#') {
+                spec.flags |= FL_ALT;
+            } else if (*fmt == '+') {
+                spec.flags |= FL_PLUS;
+            } else if (*fmt == ' ') {
+                spec.flags |= FL_SPACE;
+            } else {
+                break;
+            }
+        }
+
+        if (*fmt == '*') {
+            int w = va_arg(ap, int);
+            if (w < 0) {
+                spec.flags |= FL_LEFT;
+                w = -w;
+            }
+            spec.width = (size_t)w;
+            fmt++;
+        } else {
+            while (*fmt >= '0' && *fmt <= '9') {
+                spec.width = spec.width * 10 + (size_t)(*fmt++ - '0');
+            }
+        }
+
+        if (*fmt == '.') {
+            fmt++;
+            if (*fmt == '*') {
+                int p = va_arg(ap, int);
+                spec.precision = p < 0 ? -1 : p;
+                fmt++;
+            } else {
+                spec.precision = 0;
+                while (*fmt >= '0' && *fmt <= '9') {
+                    spec.precision = spec.precision * 10 + (*fmt++ - '0');
+                }
+            }
+        }
+
+        /* 1: long, 0: int, -1: short, -2: char */
+        int size = 0;
+        if (*fmt == 'l' || *fmt == 'z') {
+            size = 1;
+            while (*fmt == 'l' || *fmt == 'z') {
+                fmt++;
+            }
+        } else if (*fmt == 'h') {
+            size = -1;
+            if (*++fmt == 'h') {
+                size = -2;
+                fmt++;
+            }
+        }
+
+        char conv = *fmt;
+        if (conv == '\0') {
+            break;
+        }
+        fmt++;
+
+        switch (conv) {
+        case 'd':
+        case 'i': {
+            long v = size > 0 ? va_arg(ap, long) : va_arg(ap, int);
+            if (size == -1) {
+                v = (short)v;
+            } else if (size == -2) {
+                v = (signed char)v;
+            }
+            unsigned long u = v < 0 ? -(unsigned long)v : (unsigned long)v;
+            const char *sign = v < 0 ? "-" : (spec.flags & FL_PLUS) ? "+" :
+                               (spec.flags & FL_SPACE) ? " " : "";
+            char *p = (u == 0 && spec.precision == 0) ? end : put_dec(end, u);
+            emit_number(&o, &spec, sign, *sign ? 1 : 0, p, (size_t)(end - p));
+            break;
+        }
+        case 'u':
+        case 'x':
+        case 'X': {
+            unsigned long u = size > 0 ? va_arg(ap, unsigned long) : va_arg(ap, unsigned int);
+            if (size == -1) {
+                u = (unsigned short)u;
+            } else if (size == -2) {
+                u = (unsigned char)u;
+            }
+            char *p = end;
+            if (u != 0 || spec.precision != 0) {
+                p = conv == 'u' ? put_dec(end, u) :
+                    put_hex(end, u, conv == 'x' ? hex_lower : hex_upper);
+            }
+            int alt = conv != 'u' && (spec.flags & FL_ALT) && u != 0;
+            emit_number(&o, &spec, conv == 'X' ? "0X" : "0x", alt ? 2 : 0, p, (size_t)(end - p));
+            break;
+        }
+        case 'p': {
+            /* pointers always show all 16 hex digits */
+            unsigned long u = (unsigned long)va_arg(ap, void *);
+            char *p = put_hex(end, u, hex_lower);
+            if (spec.precision < 0) {
+                spec.precision = 2 * sizeof(void *);
+            }
+            emit_number(&o, &spec, "0x", 2, p, (size_t)(end - p));
+            break;
+        }
+        case 's': {
+            const char *s = va_arg(ap, const char *);
+            size_t len;
+            if (s == NULL) {
+                s = "(null)";
+            }
+            if (spec.precision >= 0) {
+                for (len = 0; len < (size_t)spec.precision && s[len]; len++)
+                    ;
+            } else {
+                len = strlen(s);
+            }
+            emit_text(&o, &spec, s, len);
+            break;
+        }
+        case 'c': {
+            char c = (char)va_arg(ap, int);
+            emit_text(&o, &spec, &c, 1);
+            break;
+        }
+        case '%':
+            emit(&o, "%", 1);
+            break;
+        default:
+            /* unknown conversion: print it as written */
+            emit(&o, "%", 1);
+            emit(&o, &conv, 1);
+            break;
+        }
+    }
+
+    if (out && n) {
+        out[o.pos < o.cap ? o.pos : o.cap] = '\0';
+    }
+    return (int)o.pos;
+}
+
+int snprintf(char *out, size_t n, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(out, n, fmt, ap);
+    va_end(ap);
+    return len;
+}
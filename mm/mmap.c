@@ -0,0 +1,176 @@
+#include "kernel.h"
+#include "string.h"
+#include "kernel/vm.h"
+#include "uapi/mman.h"
+
+/*
+ * 用户态内存：sbrk 堆和匿名映射
+ *
+ * 两者都在任务页表的用户窗口里（见 mm/vm.c）：sbrk 和 mmap 只记录地址
+ * 范围，物理页在第一次访问时才分配并清零。MAP_POPULATE 要求 mmap 当场
+ * 分配全部页面。munmap 只能整块释放一个映射。clone 的子任务继承父任务的
+ * break 和映射，页面按写时复制共享（vm_task_clone()）。
+ */
+
+#define SBRK_FAILED ((void *)-1)
+
+static struct task_struct *current_user_task(void)
+{
+    if (current_task_id < 0) {
+        return NULL;
+    }
+
+    struct task_struct *task = &tasks[current_task_id];
+    if (vm_task_init(task) < 0) {
+        return NULL;
+    }
+    return task;
+}
+
+static inline uintptr_t page_round_up(uintptr_t a)
+{
+    return (a + PAGE_SIZE - 1) & ~(uintptr_t)(PAGE_SIZE - 1);
+}
+
+/**
+ * @brief 调整当前任务的 program break
+ * @param increment 增加（或减少）的字节数，0 只查询
+ * @return 原来的 break；超出 USER_HEAP_MAX 或内存不足时返回 (void *)-1
+ */
+void *do_sbrk(long increment)
+{
+    struct task_struct *task = current_user_task();
+
+    if (task == NULL) {
+        return SBRK_FAILED;
+    }
+
+    struct task_mm *mm = &task->mm;
+    uintptr_t old = mm->brk;
+    uintptr_t limit = USER_HEAP_BASE + USER_HEAP_MAX;
+
+    if (increment > 0 && (uintptr_t)increment > limit - old) {
+        return SBRK_FAILED;
+    }
+    if (increment < 0 && (uintptr_t)-increment > old - USER_HEAP_BASE) {
+        return SBRK_FAILED;
+    }
+
+    mm->brk = old + increment;
+    if (increment < 0) {
+        // 整页归还；留下的半页清掉 break 之上的部分，再次增长时仍是零
+        vm_unmap_range(task, page_round_up(mm->brk), page_round_up(old));
+        if (mm->brk & (PAGE_SIZE - 1)) {
+            vm_zero_tail(task, mm->brk);
+        }
+    }
+    return (void *)old;
+}
+
+/* 在 mmap 区找一段 npages 页、不和已有映射重叠的地址 */
+static uintptr_t find_gap(struct task_mm *mm, size_t npages)
+{
+    uintptr_t start = USER_MMAP_BASE;
+    size_t len = npages * PAGE_SIZE;
+
+    for (int moved = 1; moved;) {
+        moved = 0;
+        for (int i = 0; i < TASK_MAX_MMAPS; i++) {
+            struct mm_region *r = &mm->mmaps[i];
+            uintptr_t r_end = r->start + r->npages * PAGE_SIZE;
+            if (r->start != 0 && start < r_end && r->start < start + len) {
+                start = r_end;
+                moved = 1;
+            }
+        }
+    }
+    return (start + len <= USER_VA_END) ? start : 0;
+}
+
+/**
+ * @brief 建立匿名映射
+ * @param addr 提示地址，被忽略
+ * @param length 字节数，向上取整到页
+ * @param prot PROT_* 组合，目前映射总是可读写
+ * @param flags 必须包含 MAP_ANONYMOUS 和 MAP_PRIVATE，可以加 MAP_POPULATE
+ * @param fd 必须为 -1
+ * @param offset 必须为 0
+ * @return 映射的起始地址，失败时返回 MAP_FAILED
+ */
+void *do_mmap(void *addr, size_t length, int prot, int flags, int fd, long offset)
+{
+    (void)addr;
+    (void)prot;
+    if (length == 0 || length > USER_VA_END - USER_MMAP_BASE || fd != -1 || offset != 0) {
+        return MAP_FAILED;
+    }
+    if ((flags & (MAP_ANONYMOUS | MAP_PRIVATE)) != (MAP_ANONYMOUS | MAP_PRIVATE)) {
+        return MAP_FAILED;
+    }
+
+    struct task_struct *task = current_user_task();
+    if (task == NULL) {
+        return MAP_FAILED;
+    }
+
+    struct task_mm *mm = &task->mm;
+    struct mm_region *slot = NULL;
+    for (int i = 0; i < TASK_MAX_MMAPS; i++) {
+        if (mm->mmaps[i].start == 0) {
+            slot = &mm->mmaps[i];
+            break;
+        }
+    }
+    if (slot == NULL) {
+        return MAP_FAILED;
+    }
+
+    size_t npages = page_round_up(length) / PAGE_SIZE;
+    uintptr_t start = find_gap(mm, npages);
+    if (start == 0) {
+        return MAP_FAILED;
+    }
+
+    slot->start = start;
+    slot->npages = npages;
+    if ((flags & MAP_POPULATE) && vm_map_range(task, start, start + npages * PAGE_SIZE) < 0) {
+        vm_unmap_range(task, start, start + npages * PAGE_SIZE);
+        slot->start = 0;
+        slot->npages = 0;
+        return MAP_FAILED;
+    }
+    return (void *)start;
+}
+
+/**
+ * @brief 解除 do_mmap() 建立的映射
+ * @param addr 映射的起始地址
+ * @param length 字节数，向上取整到页后必须等于映射的大小
+ * @return 0 成功，-1 没有这样的映射
+ */
+int do_munmap(void *addr, size_t length)
+{
+    if (current_task_id < 0 || addr == NULL) {
+        return -1;
+    }
+
+    struct task_struct *task = &tasks[current_task_id];
+    size_t npages = page_round_up(length) / PAGE_SIZE;
+
+    for (int i = 0; i < TASK_MAX_MMAPS; i++) {
+        struct mm_region *r = &task->mm.mmaps[i];
+        if (r->start == (uintptr_t)addr && r->npages == npages) {
+            vm_unmap_range(task, r->start, r->start + npages * PAGE_SIZE);
+            r->start = 0;
+            r->npages = 0;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void mm_task_release(struct task_struct *task)
+{
+    vm_task_release(task);
+    memset(&task->mm, 0, sizeof(task->mm));
+}
@@ -1,5 +1,7 @@
 #include "kernel.h"
 #include "kernel/mm.h"
+#include "kernel/stats.h"
+#include "string.h"
 
 /*
  * 以下全局变量由链接器脚本(os.ld)定义，用于标识内存的关键边界
@@ -28,6 +30,7 @@ static uint32_t _num_pages = 0;
 static inline void _clear(struct Page *page)
 {
 	page->flags = 0;
+	page->shares = 0;
 }
 
 // 检查页是否空闲
@@ -107,7 +110,7 @@ void page_init()
  * 分配一个由连续物理页组成的内存块
  * - npages: 需要分配的页数
  */
-void *page_alloc(int npages)
+static void *__page_alloc(int npages)
 {
 	if (npages <= 0 || npages > _num_pages) {
 		printk("WARNING: page_alloc called with invalid npages=%d (max=%d)\n", npages, _num_pages);
@@ -154,6 +157,7 @@ void *page_alloc(int npages)
 				}
 				// 标记内存块的最后一页
 				_set_flag(&page_descriptors[i + npages - 1], PAGE_LAST);
+				stat_add(page_allocs, npages);
 				
 				// 返回分配的内存块的实际物理地址
 				return (void *)((uint32_t)&_memory_start + i * PAGE_SIZE);
@@ -163,6 +167,86 @@ void *page_alloc(int npages)
 	return NULL; // 内存不足
 }
 
+/*
+ * 预清零页池
+ *
+ * 空闲循环（kernel/sched.c 的 idle_loop()）没有别的事做时调用
+ * page_pool_refill()，每次分配一页、清零后放进池子。带 PAGE_ZERO 的
+ * 单页分配先从池子里拿，拿不到才当场清零。池中的页在描述符里是 TAKEN，
+ * 普通分配失败时会先把池子还回去再重试一次。
+ * 池子和页描述符都由内核锁保护：多核上关中断挡不住别的 hart，调用
+ * page_pool_refill() 和分配/释放页面时都必须持有内核锁（空闲循环在放开
+ * 内核锁之前补充页池）。
+ */
+#define ZERO_POOL_SIZE 32
+
+static void *zero_pool[ZERO_POOL_SIZE];
+static int zero_pool_count = 0;
+static struct page_pool_stats pool_stats;
+
+static void page_pool_drain(void)
+{
+	while (zero_pool_count > 0) {
+		page_free(zero_pool[--zero_pool_count]);
+	}
+}
+
+/*
+ * 往预清零页池补充一页
+ * 返回 1 表示补充了一页，0 表示池子已满或者没有空闲内存
+ */
+int page_pool_refill(void)
+{
+	if (zero_pool_count >= ZERO_POOL_SIZE) {
+		return 0;
+	}
+
+	void *p = __page_alloc(1);
+	if (p == NULL) {
+		return 0;
+	}
+	kmemset(p, 0, PAGE_SIZE);
+	zero_pool[zero_pool_count++] = p;
+	pool_stats.refills++;
+	return 1;
+}
+
+void page_pool_get_stats(struct page_pool_stats *out)
+{
+	*out = pool_stats;
+	out->count = zero_pool_count;
+}
+
+/*
+ * 分配 npages 个连续物理页
+ * - flags: PAGE_ZERO 要求返回清零的页面
+ */
+void *page_alloc_flags(int npages, int flags)
+{
+	void *p;
+
+	if ((flags & PAGE_ZERO) && npages == 1 && zero_pool_count > 0) {
+		pool_stats.pool_hits++;
+		return zero_pool[--zero_pool_count];
+	}
+
+	p = __page_alloc(npages);
+	if (p == NULL && zero_pool_count > 0) {
+		page_pool_drain();
+		p = __page_alloc(npages);
+	}
+	if (p != NULL && (flags & PAGE_ZERO)) {
+		kmemset(p, 0, (size_t)npages * PAGE_SIZE);
+		pool_stats.sync_zeroed++;
+	}
+	return p;
+}
+
+void *page_alloc(int npages)
+{
+	return page_alloc_flags(npages, 0);
+}
+
 /*
  * 释放内存块
  * - p: 内存块的起始地址
@@ -219,6 +303,56 @@ void page_free(void *p)
 			page++;
 		}
 	}
+	stat_add(page_frees, release_count);
+}
+
+/*
+ * 共享页的引用计数
+ *
+ * 写时复制（mm/vm.c）让多个任务的页表指向同一个物理页。描述符里的
+ * shares 记录除第一个使用者之外还有几个，所以普通分配的页不需要额外
+ * 初始化。这几个函数只用于单页。
+ */
+static struct Page *page_desc(void *p)
+{
+	if ((uint32_t)p < _alloc_start || (uint32_t)p >= _alloc_end) {
+		return NULL;
+	}
+	struct Page *page_descriptors = (struct Page *)_align_page((uint32_t)&BSS_END);
+	return &page_descriptors[((uint32_t)p - (uint32_t)&_memory_start) / PAGE_SIZE];
+}
+
+void page_get(void *p)
+{
+	struct Page *page = page_desc(p);
+
+	if (page == NULL || _is_free(page)) {
+		printk("WARNING: page_get called with invalid page 0x%x\n", (uint32_t)p);
+		return;
+	}
+	page->shares++;
+}
+
+void page_put(void *p)
+{
+	struct Page *page = page_desc(p);
+
+	if (page != NULL && page->shares > 0) {
+		page->shares--;
+		return;
+	}
+	page_free(p);
+}
+
+// 返回使用这一页的任务数，空闲页为 0
+int page_refs(void *p)
+{
+	struct Page *page = page_desc(p);
+
+	if (page == NULL || _is_free(page)) {
+		return 0;
+	}
+	return page->shares + 1;
 }
 
 /* --- Public utility functions for testing --- */
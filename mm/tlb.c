@@ -0,0 +1,150 @@
+#include "kernel.h"
+#include "arch/sbi.h"
+#include "kernel/hart.h"
+#include "kernel/tlb.h"
+
+/*
+ * TLB 刷新
+ *
+ * 内核在 satp = Bare 下修改页表，本 hart 的 sfence.vma 在 Bare 下同样
+ * 作用于缓存的 Sv39 表项。远端的刷新交给 SBI RFENCE 扩展：一次调用
+ * 覆盖掩码里的所有 hart，返回时它们都已经刷新完毕，不需要自己发 IPI。
+ * 调用者必须关中断（在陷阱处理中本来就是）。
+ */
+
+static DEFINE_PER_CPU(struct tlb_stats, hart_stats);
+
+static inline void local_flush_page(uintptr_t va, unsigned long asid)
+{
+    if (asid) {
+        asm volatile("sfence.vma %0, %1" : : "r"(va), "r"(asid) : "memory");
+    } else {
+        asm volatile("sfence.vma %0, zero" : : "r"(va) : "memory");
+    }
+}
+
+static inline void local_flush_asid(unsigned long asid)
+{
+    if (asid) {
+        asm volatile("sfence.vma zero, %0" : : "r"(asid) : "memory");
+    } else {
+        asm volatile("sfence.vma" : : : "memory");
+    }
+}
+
+static void remote_flush(unsigned long mask, uintptr_t start, size_t size, unsigned long asid)
+{
+    if (asid) {
+        sbi_remote_sfence_vma_asid(mask, 0, start, size, asid);
+    } else {
+        sbi_remote_sfence_vma(mask, 0, start, size);
+    }
+    this_cpu_var(hart_stats).rfence_calls++;
+}
+
+/* 刷新 asid 的全部表项 */
+static void flush_all(unsigned long hart_mask, unsigned long asid)
+{
+    unsigned long self = 1UL << this_hart();
+
+    if (hart_mask & self) {
+        local_flush_asid(asid);
+        this_cpu_var(hart_stats).local_full++;
+    }
+    if (hart_mask & ~self) {
+        remote_flush(hart_mask & ~self, 0, (size_t)-1, asid);
+    }
+}
+
+void tlb_batch_init(struct tlb_batch *b, unsigned long hart_mask, unsigned long asid)
+{
+    b->hart_mask = hart_mask;
+    b->asid = asid;
+    b->nranges = 0;
+    b->full = 0;
+    b->pages = 0;
+}
+
+/* 记下 va 所在的页；和上一段相邻时直接延长 */
+void tlb_batch_add(struct tlb_batch *b, uintptr_t va)
+{
+    va &= ~(uintptr_t)(PAGE_SIZE - 1);
+    b->pages++;
+    if (b->full) {
+        return;
+    }
+    if (b->pages > TLB_FLUSH_ALL_PAGES) {
+        b->full = 1;
+        return;
+    }
+
+    if (b->nranges > 0 && b->ranges[b->nranges - 1].end == va) {
+        b->ranges[b->nranges - 1].end = va + PAGE_SIZE;
+        return;
+    }
+    if (b->nranges == TLB_BATCH_RANGES) {
+        b->full = 1;
+        return;
+    }
+    b->ranges[b->nranges].start = va;
+    b->ranges[b->nranges].end = va + PAGE_SIZE;
+    b->nranges++;
+}
+
+/* 按收集到的页刷新本 hart 和掩码里的其它 hart，然后清空 batch */
+void tlb_batch_flush(struct tlb_batch *b)
+{
+    unsigned long self = 1UL << this_hart();
+    unsigned long remote = b->hart_mask & ~self;
+
+    if (b->pages == 0) {
+        return;
+    }
+
+    if (b->full) {
+        flush_all(b->hart_mask, b->asid);
+        this_cpu_var(hart_stats).full_fallbacks++;
+    } else {
+        for (int i = 0; i < b->nranges; i++) {
+            struct tlb_range *r = &b->ranges[i];
+            if (b->hart_mask & self) {
+                for (uintptr_t va = r->start; va < r->end; va += PAGE_SIZE) {
+                    local_flush_page(va, b->asid);
+                    this_cpu_var(hart_stats).local_pages++;
+                }
+            }
+            if (remote) {
+                remote_flush(remote, r->start, r->end - r->start, b->asid);
+            }
+        }
+    }
+    tlb_batch_init(b, b->hart_mask, b->asid);
+}
+
+void tlb_flush_page(unsigned long hart_mask, unsigned long asid, uintptr_t va)
+{
+    struct tlb_batch b;
+
+    tlb_batch_init(&b, hart_mask, asid);
+    tlb_batch_add(&b, va);
+    tlb_batch_flush(&b);
+}
+
+void tlb_flush_asid(unsigned long hart_mask, unsigned long asid)
+{
+    flush_all(hart_mask, asid);
+}
+
+void tlb_get_stats(struct tlb_stats *out)
+{
+    out->local_pages = 0;
+    out->local_full = 0;
+    out->rfence_calls = 0;
+    out->full_fallbacks = 0;
+    for (int i = 0; i < MAXNUM_CPU; i++) {
+        out->local_pages += per_cpu_var(hart_stats, i).local_pages;
+        out->local_full += per_cpu_var(hart_stats, i).local_full;
+        out->rfence_calls += per_cpu_var(hart_stats, i).rfence_calls;
+        out->full_fallbacks += per_cpu_var(hart_stats, i).full_fallbacks;
+    }
+}
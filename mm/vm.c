@@ -0,0 +1,458 @@
+#include "kernel.h"
+#include "string.h"
+#include "kernel/vm.h"
+#include "kernel/tlb.h"
+#include "kernel/hart.h"
+
+/*
+ * Sv39 用户页表和按需分页
+ *
+ * 内核、用户任务的代码和数据链接在同一个镜像里，而 Sv39 下 S 态不能执行
+ * 带 U 位的页，所以内核不使用页表：陷阱入口（trampoline 页）先把 satp
+ * 切回 Bare，返回用户态前再换成任务的页表。trampoline 页在用户页表里
+ * 只有 S 态可执行，其它物理内存和 MMIO 都按原地址映射给用户态，和没有
+ * 页表时一样。这部分映射所有任务共用，每个任务只有自己的根页表。
+ *
+ * 窗口 [USER_VA_BASE, USER_VA_END) 里的堆和匿名映射只记录范围，第一次
+ * 访问时缺页，vm_fault() 才分配一页清零的页面（minor fault），通常直接
+ * 来自空闲时补充的预清零页池（mm/page.c）。内核访问这些
+ * 地址时不经过 MMU，要用 copy_from_user() / copy_to_user() 或
+ * vm_user_page() 查表，缺页的话同样当场补上。
+ *
+ * vm_task_clone() 让子任务共享父任务窗口里已经分配的页：两边的 PTE 都
+ * 去掉写权限、打上 PTE_COW，物理页的引用计数加一，只复制页表本身。
+ * 之后谁先写，谁在缺页时得到一份私有的拷贝；只剩一个使用者的页直接
+ * 改回可写。窗口之外的内存（代码、全局变量、任务栈）本来就是所有任务
+ * 共用的，不在复制范围内。
+ *
+ * 硬件支持 ASID 时，每个任务的页表带自己的 ASID（任务槽位 + 1），进出
+ * 内核和切换任务都不再整体刷新 TLB；相应地，修改 PTE 之后要用
+ * mm/tlb.c 刷新 mm->cpu_mask 里所有 hart 上的旧表项。从无效变成有效的
+ * PTE 不刷新，旧的无效表项引起的缺页在 vm_fault() 里刷新后重试。
+ */
+
+extern char _trampoline_start[];    // os.ld
+extern char _trampoline_end[];
+extern reg_t satp_probe(reg_t satp);  // arch/riscv/context.S
+
+#define PT_ENTRIES 512
+#define MEGAPAGE_SIZE (1UL << 21)
+#define RAM_GIGAPAGE 0x80000000UL
+
+#define PTE_USER_DATA (PTE_V | PTE_R | PTE_W | PTE_U | PTE_A | PTE_D)
+
+/* 所有任务共用的恒等映射：根页表的模板、0x80000000 起 1 GB 的二级表 */
+static pte_t shared_root[PT_ENTRIES] __attribute__((aligned(PAGE_SIZE)));
+static pte_t ram_l1[PT_ENTRIES] __attribute__((aligned(PAGE_SIZE)));
+static pte_t trampoline_l0[PT_ENTRIES] __attribute__((aligned(PAGE_SIZE)));
+static unsigned long asid_max;  // 硬件实现的最大 ASID，0 表示不支持
+
+void vm_init(void)
+{
+    uintptr_t tramp = (uintptr_t)_trampoline_start;
+    uintptr_t mega = tramp & ~(MEGAPAGE_SIZE - 1);
+
+    // 0 - 1 GB 是 UART、PLIC 等 MMIO
+    shared_root[0] = PA2PTE(0) | PTE_USER_DATA;
+
+    for (int i = 0; i < PT_ENTRIES; i++) {
+        ram_l1[i] = PA2PTE(RAM_GIGAPAGE + i * MEGAPAGE_SIZE) | PTE_USER_DATA | PTE_X;
+    }
+    // trampoline 所在的 2 MB 拆成 4 KB 页，trampoline 本身不给用户态
+    for (int i = 0; i < PT_ENTRIES; i++) {
+        uintptr_t pa = mega + i * PAGE_SIZE;
+        if (pa >= tramp && pa < (uintptr_t)_trampoline_end) {
+            trampoline_l0[i] = PA2PTE(pa) | PTE_V | PTE_R | PTE_X | PTE_A;
+        } else {
+            trampoline_l0[i] = PA2PTE(pa) | PTE_USER_DATA | PTE_X;
+        }
+    }
+    ram_l1[PX(1, tramp)] = PA2PTE(trampoline_l0) | PTE_V;
+    shared_root[PX(2, RAM_GIGAPAGE)] = PA2PTE(ram_l1) | PTE_V;
+
+    // trampoline 在任务的页表下读写 tasks[] 里的上下文，这些页带 U 位
+    w_sstatus(r_sstatus() | SSTATUS_SUM);
+
+    // ASID 字段是 WARL：写全 1 再读回来，留下的位就是实现了的位
+    asid_max = (satp_probe(MAKE_SATP(shared_root) | SATP_ASID_MASK) & SATP_ASID_MASK) >> SATP_ASID_SHIFT;
+
+    printk("VM: Sv39 user page tables, trampoline at %p, user window 0x%lx - 0x%lx, max ASID %ld\n",
+           _trampoline_start, USER_VA_BASE, USER_VA_END, (long)asid_max);
+}
+
+static inline int in_window(uintptr_t va)
+{
+    return va >= USER_VA_BASE && va < USER_VA_END;
+}
+
+/* va 是否属于任务的堆或某个映射 */
+static int va_valid(struct task_mm *mm, uintptr_t va)
+{
+    if (va >= USER_HEAP_BASE && va < mm->brk) {
+        return 1;
+    }
+    for (int i = 0; i < TASK_MAX_MMAPS; i++) {
+        struct mm_region *r = &mm->mmaps[i];
+        if (r->start != 0 && va >= r->start && va < r->start + r->npages * PAGE_SIZE) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* 窗口内 va 的末级 PTE，alloc 时补齐中间的页表 */
+static pte_t *walk(struct task_mm *mm, uintptr_t va, int alloc)
+{
+    pagetable_t pt = mm->pagetable;
+
+    for (int level = 2; level > 0; level--) {
+        pte_t *pte = &pt[PX(level, va)];
+        if (*pte & PTE_V) {
+            pt = (pagetable_t)PTE2PA(*pte);
+            continue;
+        }
+        if (!alloc || (pt = page_alloc_flags(1, PAGE_ZERO)) == NULL) {
+            return NULL;
+        }
+        mm->pt_pages++;
+        *pte = PA2PTE(pt) | PTE_V;
+    }
+    return &pt[PX(0, va)];
+}
+
+/* 给 va 所在的页分配一个清零的物理页；已经映射时什么也不做 */
+static pte_t *map_zero_page(struct task_mm *mm, uintptr_t va)
+{
+    pte_t *pte = walk(mm, va, 1);
+
+    if (pte == NULL) {
+        return NULL;
+    }
+    if (!(*pte & PTE_V)) {
+        void *pa = page_alloc_flags(1, PAGE_ZERO);
+        if (pa == NULL) {
+            return NULL;
+        }
+        *pte = PA2PTE(pa) | PTE_USER_DATA;
+        mm->pages++;
+    }
+    return pte;
+}
+
+/* 对写时复制页的写：还有别人在用就复制一份，否则直接改回可写 */
+static int cow_break(struct task_mm *mm, pte_t *pte, uintptr_t va)
+{
+    void *old = (void *)PTE2PA(*pte);
+    pte_t flags = (PTE_FLAGS(*pte) & ~PTE_COW) | PTE_W;
+
+    if (page_refs(old) > 1) {
+        void *copy = page_alloc(1);
+        if (copy == NULL) {
+            return -1;
+        }
+        kmemcpy(copy, old, PAGE_SIZE);
+        page_put(old);
+        *pte = PA2PTE(copy) | flags;
+        mm->cow_copies++;
+    } else {
+        *pte = PA2PTE(old) | flags;
+    }
+    tlb_flush_page(mm->cpu_mask, mm->asid, va);
+    mm->cow_faults++;
+    return 0;
+}
+
+/**
+ * @brief 给任务建立自己的根页表
+ * @details 之后每次返回用户态都会装入它（ctx.satp）。已经有页表时直接返回。
+ * @return 0 成功，-1 内存不足
+ */
+int vm_task_init(struct task_struct *task)
+{
+    struct task_mm *mm = &task->mm;
+
+    if (mm->pagetable != NULL) {
+        return 0;
+    }
+
+    pagetable_t root = page_alloc(1);
+    if (root == NULL) {
+        return -1;
+    }
+    memcpy(root, shared_root, PAGE_SIZE);
+
+    unsigned long asid = (unsigned long)(task - tasks) + 1;
+    mm->pagetable = root;
+    mm->pt_pages = 1;
+    mm->brk = USER_HEAP_BASE;
+    mm->asid = asid <= asid_max ? asid : 0;
+    task->ctx.satp = MAKE_SATP(root) | ((reg_t)mm->asid << SATP_ASID_SHIFT);
+    return 0;
+}
+
+/* 释放窗口里的全部物理页和页表，任务回到没有页表的状态 */
+void vm_task_release(struct task_struct *task)
+{
+    struct task_mm *mm = &task->mm;
+    pagetable_t root = mm->pagetable;
+
+    if (root == NULL) {
+        return;
+    }
+    // 槽位复用时 ASID 也会复用，先清掉它在各个 hart 上的表项
+    tlb_flush_asid(mm->cpu_mask, mm->asid);
+    for (uint64_t i = PX(2, USER_VA_BASE); i <= PX(2, USER_VA_END - 1); i++) {
+        if (!(root[i] & PTE_V)) {
+            continue;
+        }
+        pagetable_t l1 = (pagetable_t)PTE2PA(root[i]);
+        for (int j = 0; j < PT_ENTRIES; j++) {
+            if (!(l1[j] & PTE_V)) {
+                continue;
+            }
+            pagetable_t l0 = (pagetable_t)PTE2PA(l1[j]);
+            for (int k = 0; k < PT_ENTRIES; k++) {
+                if (l0[k] & PTE_V) {
+                    page_put((void *)PTE2PA(l0[k]));
+                }
+            }
+            page_free(l0);
+        }
+        page_free(l1);
+    }
+    page_free(root);
+
+    mm->pagetable = NULL;
+    mm->pages = 0;
+    mm->pt_pages = 0;
+    mm->cpu_mask = 0;
+    task->ctx.satp = 0;
+}
+
+/**
+ * @brief 子任务按写时复制共享父任务的堆和映射
+ * @details 调用时子任务还没有运行过。父任务改成只读的页最后一起刷新 TLB。
+ * @return 0 成功，-1 内存不足（已经共享的部分由 mm_task_release() 回收）
+ */
+int vm_task_clone(struct task_struct *child, struct task_struct *parent)
+{
+    struct task_mm *pm = &parent->mm;
+    struct task_mm *cm = &child->mm;
+    pagetable_t root = pm->pagetable;
+    struct tlb_batch batch;
+    int ret = 0;
+
+    if (root == NULL) {
+        return 0;
+    }
+    if (vm_task_init(child) < 0) {
+        return -1;
+    }
+    cm->brk = pm->brk;
+    memcpy(cm->mmaps, pm->mmaps, sizeof(cm->mmaps));
+    tlb_batch_init(&batch, pm->cpu_mask, pm->asid);
+
+    for (uint64_t i = PX(2, USER_VA_BASE); ret == 0 && i <= PX(2, USER_VA_END - 1); i++) {
+        if (!(root[i] & PTE_V)) {
+            continue;
+        }
+        pagetable_t l1 = (pagetable_t)PTE2PA(root[i]);
+        for (int j = 0; ret == 0 && j < PT_ENTRIES; j++) {
+            if (!(l1[j] & PTE_V)) {
+                continue;
+            }
+            pagetable_t l0 = (pagetable_t)PTE2PA(l1[j]);
+            for (int k = 0; k < PT_ENTRIES; k++) {
+                if (!(l0[k] & PTE_V)) {
+                    continue;
+                }
+                uintptr_t va = (i << 30) | ((uintptr_t)j << 21) | ((uintptr_t)k << 12);
+                pte_t *dst = walk(cm, va, 1);
+                if (dst == NULL) {
+                    ret = -1;
+                    break;
+                }
+                if (l0[k] & PTE_W) {
+                    l0[k] = (l0[k] & ~PTE_W) | PTE_COW;
+                    tlb_batch_add(&batch, va);
+                }
+                *dst = l0[k];
+                page_get((void *)PTE2PA(l0[k]));
+                cm->pages++;
+            }
+        }
+    }
+    tlb_batch_flush(&batch);
+    return ret;
+}
+
+/**
+ * @brief 立即为 [start, end) 分配物理页（MAP_POPULATE）
+ * @return 0 成功，-1 内存不足
+ */
+int vm_map_range(struct task_struct *task, uintptr_t start, uintptr_t end)
+{
+    for (uintptr_t va = start; va < end; va += PAGE_SIZE) {
+        if (map_zero_page(&task->mm, va) == NULL) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* 释放 [start, end) 中已经分配的页，start/end 按页对齐 */
+void vm_unmap_range(struct task_struct *task, uintptr_t start, uintptr_t end)
+{
+    struct task_mm *mm = &task->mm;
+    struct tlb_batch batch;
+
+    tlb_batch_init(&batch, mm->cpu_mask, mm->asid);
+    for (uintptr_t va = start; va < end; va += PAGE_SIZE) {
+        pte_t *pte = walk(mm, va, 0);
+        if (pte != NULL && (*pte & PTE_V)) {
+            page_put((void *)PTE2PA(*pte));
+            *pte = 0;
+            mm->pages--;
+            tlb_batch_add(&batch, va);
+        }
+    }
+    tlb_batch_flush(&batch);
+}
+
+/**
+ * @brief 把 va 到所在页末尾清零（sbrk 缩小后 break 之上的半页）
+ * @details 不检查 va 是否还属于堆：调用时 break 可能已经降到 va 之下。
+ *          页还没分配时什么也不做，以后缺页分配的本来就是零页；
+ *          写时复制的页先复制，不改动别的任务看到的内容。
+ */
+void vm_zero_tail(struct task_struct *task, uintptr_t va)
+{
+    if (!in_window(va) || task->mm.pagetable == NULL) {
+        return;
+    }
+
+    pte_t *pte = walk(&task->mm, va, 0);
+    if (pte == NULL || !(*pte & PTE_V)) {
+        return;
+    }
+    if ((*pte & PTE_COW) && cow_break(&task->mm, pte, va) < 0) {
+        return;
+    }
+    uintptr_t off = va & (PAGE_SIZE - 1);
+    kmemset((char *)PTE2PA(*pte) + off, 0, PAGE_SIZE - off);
+}
+
+/**
+ * @brief 用户地址 va 在内核里可以直接访问的地址
+ * @details 窗口之外是恒等映射，原样返回；窗口里的页还没分配时当场分配，
+ *          和用户态缺页一样计入 minor_faults。内核要写这一页时 write 为 1，
+ *          写时复制的页先复制出任务私有的一份。
+ * @return 内核可用的指针，va 不属于任务的堆或映射时返回 NULL
+ */
+void *vm_user_page(struct task_struct *task, uintptr_t va, int write)
+{
+    if (!in_window(va)) {
+        return (void *)va;
+    }
+    if (task == NULL || task->mm.pagetable == NULL || !va_valid(&task->mm, va)) {
+        return NULL;
+    }
+
+    pte_t *pte = walk(&task->mm, va, 0);
+    if (pte == NULL || !(*pte & PTE_V)) {
+        pte = map_zero_page(&task->mm, va);
+        if (pte == NULL) {
+            return NULL;
+        }
+        task->mm.minor_faults++;
+    } else if (write && (*pte & PTE_COW) && cow_break(&task->mm, pte, va) < 0) {
+        return NULL;
+    }
+    return (void *)(PTE2PA(*pte) + (va & (PAGE_SIZE - 1)));
+}
+
+/**
+ * @brief 用户态的 load/store page fault
+ * @param write store page fault 为 1
+ * @return 1 已分配或复制了页面，重新执行即可；0 不是合法的用户地址
+ */
+int vm_fault(uintptr_t va, int write)
+{
+    if (current_task_id < 0) {
+        return 0;
+    }
+
+    struct task_struct *task = &tasks[current_task_id];
+    if (!in_window(va) || task->mm.pagetable == NULL || !va_valid(&task->mm, va)) {
+        return 0;
+    }
+
+    pte_t *pte = walk(&task->mm, va, 0);
+    if (pte != NULL && (*pte & PTE_V)) {
+        if (write && (*pte & PTE_COW)) {
+            return cow_break(&task->mm, pte, va) == 0;
+        }
+        // PTE 允许这次访问：本 hart 的 TLB 里还是它变成有效之前的表项
+        if (*pte & (write ? PTE_W : PTE_R)) {
+            tlb_flush_page(1UL << this_hart(), task->mm.asid, va);
+            return 1;
+        }
+        return 0;
+    }
+    if (map_zero_page(&task->mm, va) == NULL) {
+        return 0;
+    }
+    task->mm.minor_faults++;
+    return 1;
+}
+
+static struct task_struct *current_task_or_null(void)
+{
+    return current_task_id >= 0 ? &tasks[current_task_id] : NULL;
+}
+
+/* 分页拷贝；完全不在窗口里的缓冲区直接 kmemcpy */
+static long copy_user(void *kbuf, uintptr_t va, size_t n, int to_user)
+{
+    struct task_struct *task = current_task_or_null();
+    char *k = kbuf;
+
+    if (va >= USER_VA_END || va + n <= USER_VA_BASE) {
+        if (to_user) {
+            kmemcpy((void *)va, k, n);
+        } else {
+            kmemcpy(k, (const void *)va, n);
+        }
+        return 0;
+    }
+
+    while (n > 0) {
+        size_t chunk = PAGE_SIZE - (va & (PAGE_SIZE - 1));
+        if (chunk > n) {
+            chunk = n;
+        }
+        char *p = vm_user_page(task, va, to_user);
+        if (p == NULL) {
+            return -1;
+        }
+        if (to_user) {
+            kmemcpy(p, k, chunk);
+        } else {
+            kmemcpy(k, p, chunk);
+        }
+        k += chunk;
+        va += chunk;
+        n -= chunk;
+    }
+    return 0;
+}
+
+long copy_from_user(void *dst, const void *usrc, size_t n)
+{
+    return copy_user(dst, (uintptr_t)usrc, n, 0);
+}
+
+long copy_to_user(void *udst, const void *src, size_t n)
+{
+    return copy_user((void *)src, (uintptr_t)udst, n, 1);
+}
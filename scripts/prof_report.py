@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""Turn the samples of a PROFILE_DUMP into a profile report.
+
+The kernel prints the samples on the console (see include/uapi/profile.h):
+
+    PROF-BEGIN hz=<hz>
+    PROF <hart> <task> <U|K> <pc>
+    PROF-TASK <task> <entry>
+    PROF-END samples=<n> dropped=<n>
+
+Save the console output (for example `make rt | tee qemu.log`) and run
+
+    scripts/prof_report.py --elf build/os.elf qemu.log
+
+Kernel and user code are linked into the same image, so every pc is
+symbolized against build/os.elf. The symbols come from `nm -n`, or from the
+os.txt disassembly that `make` writes when no nm is at hand (--txt os.txt).
+Prints a flat profile and a profile per task; idle samples are task -1.
+If the log holds several dumps, all of them are added up.
+"""
+
+import argparse
+import bisect
+import collections
+import re
+import subprocess
+import sys
+
+SAMPLE_RE = re.compile(r"PROF (\d+) (-?\d+) ([UK]) ([0-9a-fA-F]+)\s*$")
+TASK_RE = re.compile(r"PROF-TASK (\d+) ([0-9a-fA-F]+)\s*$")
+BEGIN_RE = re.compile(r"PROF-BEGIN hz=(\d+)")
+END_RE = re.compile(r"PROF-END samples=(\d+) dropped=(\d+)")
+TXT_SYM_RE = re.compile(r"^([0-9a-fA-F]+) <(.+)>:\s*$")
+
+
+class Symbols:
+    """Address to function name lookup over a sorted symbol table."""
+
+    def __init__(self, pairs):
+        pairs = sorted(set(pairs))
+        self.addrs = [a for a, _ in pairs]
+        self.names = [n for _, n in pairs]
+
+    def lookup(self, addr):
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0:
+            return "0x%x" % addr
+        return self.names[i]
+
+
+def symbols_from_nm(nm, elf):
+    out = subprocess.run([nm, "-n", "--defined-only", elf], check=True,
+                         capture_output=True, text=True).stdout
+    pairs = []
+    for line in out.splitlines():
+        fields = line.split()
+        # text symbols only: T/t, plus weak W/w
+        if len(fields) == 3 and fields[1] in "TtWw":
+            pairs.append((int(fields[0], 16), fields[2]))
+    return Symbols(pairs)
+
+
+def symbols_from_txt(path):
+    pairs = []
+    with open(path, errors="replace") as f:
+        for line in f:
+            m = TXT_SYM_RE.match(line)
+            if m:
+                pairs.append((int(m.group(1), 16), m.group(2)))
+    return Symbols(pairs)
+
+
+def parse_log(f):
+    samples = []        # (hart, task, mode, pc)
+    entries = {}        # task -> entry address
+    hz = None
+    dropped = 0
+    for line in f:
+        m = SAMPLE_RE.search(line)
+        if m:
+            samples.append((int(m.group(1)), int(m.group(2)), m.group(3), int(m.group(4), 16)))
+            continue
+        m = TASK_RE.search(line)
+        if m:
+            entries[int(m.group(1))] = int(m.group(2), 16)
+            continue
+        m = BEGIN_RE.search(line)
+        if m:
+            hz = int(m.group(1))
+            continue
+        m = END_RE.search(line)
+        if m:
+            dropped += int(m.group(2))
+    return samples, entries, hz, dropped
+
+
+def print_table(counts, total, top, indent=""):
+    cum = 0
+    print("%s%8s %6s %6s  %s" % (indent, "samples", "%", "cum%", "function"))
+    for (mode, name), n in counts.most_common(top):
+        cum += n
+        print("%s%8d %5.1f%% %5.1f%%  %s%s" % (indent, n, 100.0 * n / total, 100.0 * cum / total,
+                                            name, " [user]" if mode == "U" else ""))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("log", nargs="?", help="console log (default: stdin)")
+    ap.add_argument("--elf", default="build/os.elf", help="kernel image (default: %(default)s)")
+    ap.add_argument("--nm", default="riscv64-unknown-elf-nm", help="nm to read the symbols with")
+    ap.add_argument("--txt", help="use this objdump -S output (os.txt) instead of nm")
+    ap.add_argument("--top", type=int, default=20, help="functions listed per table")
+    args = ap.parse_args()
+
+    if args.txt:
+        syms = symbols_from_txt(args.txt)
+    else:
+        try:
+            syms = symbols_from_nm(args.nm, args.elf)
+        except (OSError, subprocess.CalledProcessError) as e:
+            sys.exit("cannot read symbols with %s (%s); try --txt os.txt" % (args.nm, e))
+
+    if args.log:
+        with open(args.log, errors="replace") as f:
+            samples, entries, hz, dropped = parse_log(f)
+    else:
+        samples, entries, hz, dropped = parse_log(sys.stdin)
+    if not samples:
+        sys.exit("no PROF samples in the log")
+
+    total = len(samples)
+    flat = collections.Counter()
+    per_task = collections.defaultdict(collections.Counter)
+    per_hart = collections.Counter()
+    for hart, task, mode, pc in samples:
+        key = (mode, syms.lookup(pc))
+        flat[key] += 1
+        per_task[task][key] += 1
+        per_hart[hart] += 1
+
+    print("%d samples%s, %d dropped; per hart: %s" % (
+        total, " at %d Hz" % hz if hz else "", dropped,
+        ", ".join("%d: %d" % (h, n) for h, n in sorted(per_hart.items()))))
+    print()
+    print("Flat profile:")
+    print_table(flat, total, args.top)
+
+    print()
+    print("Per-task profile:")
+    for task, counts in sorted(per_task.items(), key=lambda kv: -sum(kv[1].values())):
+        n = sum(counts.values())
+        if task < 0:
+            name = "idle"
+        elif task in entries:
+            name = "task %d (%s)" % (task, syms.lookup(entries[task]))
+        else:
+            name = "task %d" % task
+        print()
+        print("%s: %d samples, %.1f%%" % (name, n, 100.0 * n / total))
+        print_table(counts, n, args.top, "  ")
+
+
+if __name__ == "__main__":
+    main()
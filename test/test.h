@@ -1,8 +1,92 @@
 #ifndef __TEST_H__
 #define __TEST_H__
 
+#include "kernel.h"
+#include "uapi/printf.h"
+
+/* rdtime 计数换算成纳秒 */
+#define NS_PER_TICK (1000000000UL / TIMER_INTERVAL)
+
+/* 用户态测试任务读时间：不能调用内核的 get_time() */
+static inline uint64_t user_rdtime(void)
+{
+	uint64_t t;
+	asm volatile("rdtime %0" : "=r"(t));
+	return t;
+}
+
+/*
+ * 整个测试运行的结论（test_main.c）
+ *
+ * 每一项失败都记到 test_failures：test_check*() 自动计数，其它打印 FAIL
+ * 的地方调用 test_failed()。任务式测试在创建报告结果的任务时调用
+ * test_task_begin()，这个任务无论通过、失败还是跳过，退出前都调用一次
+ * test_task_done()。最后一个任务式测试结束后，test_main 创建的结论任务
+ * 打印总的结果。用户态任务和内核链接在同一个镜像里，可以直接更新它们。
+ */
+extern volatile int test_failures;
+extern volatile int test_tasks_pending;
+
+static inline void test_failed(void)
+{
+	__atomic_fetch_add(&test_failures, 1, __ATOMIC_RELAXED);
+}
+
+static inline void test_task_begin(void)
+{
+	__atomic_fetch_add(&test_tasks_pending, 1, __ATOMIC_RELAXED);
+}
+
+static inline void test_task_done(void)
+{
+	__atomic_fetch_sub(&test_tasks_pending, 1, __ATOMIC_RELEASE);
+}
+
+/* 同步测试的断言：每一项都打印结果，失败时累加 *failures */
+static inline void test_check(int cond, const char *what, int *failures)
+{
+	if (cond) {
+		printk("✓ PASS: %s\n", what);
+	} else {
+		printk("✗ FAIL: %s\n", what);
+		(*failures)++;
+		test_failed();
+	}
+}
+
+/* 用户态测试任务的断言：只打印失败的项 "<tag> FAIL: <what>"，并累加 *errors */
+static inline void test_check_user(int ok, const char *tag, const char *what, int *errors)
+{
+	if (!ok) {
+		printf("%s FAIL: %s\n", tag, what);
+		(*errors)++;
+		test_failed();
+	}
+}
+
 // Add test function declarations here
 void test_page(void);
+void test_string(void);
+void test_printf(void);
+void test_sched(void);
+void test_console(void);
+void test_futex(void);
+void test_fpu(void);
+void test_stdio(void);
+void test_heap(void);
+void test_paging(void);
+void test_fork(void);
+void test_ipi(void);
+void test_tlb(void);
+void test_affinity(void);
+void test_isolation(void);
+void test_cpuidle(void);
+void test_hotplug(void);
+void test_percpu(void);
+void test_false_sharing(void);
+void test_stats(void);
+void test_profile(void);
+void test_user_multicore_start(void);
 
 // Main test runner
 void test_main(void);
@@ -0,0 +1,164 @@
+#include "kernel.h"
+#include "kernel/smp.h"
+#include "uapi/printf.h"
+#include "syscalls.h"
+#include "test.h"
+
+/*
+ * CPU 亲和性测试（任务在调度器启动后于用户态运行）
+ *
+ *   - pinned 任务用 sched_setaffinity() 把自己绑到一个从核上，之后每轮
+ *     yield() 都检查自己仍在那个 hart 上，并且没有再迁移过；
+ *   - noisy 任务把自己排除在那个 hart 之外，检查从来没有在上面运行；
+ *   - 读回的掩码和设置的一致，空掩码和不在线的 hart 被拒绝。
+ *
+ * 测试任务和内核链接在同一个镜像里，直接读 tasks[] 里的迁移次数。
+ */
+
+#define AFFINITY_ROUNDS 2000
+
+static volatile long pinned_hart = -1;
+static volatile int pinned_ready;
+static volatile int tasks_done;
+static volatile int errors;
+
+static void fail(const char *what)
+{
+	test_failed();
+	printf("[affinity] FAIL: %s\n", what);
+	errors++;
+}
+
+/* 在线的从核中编号最大的一个，没有就返回 -1 */
+static long pick_hart(void)
+{
+	unsigned long online = smp_online_mask();
+	long boot = hart_current_id();
+
+	for (long h = MAXNUM_CPU - 1; h >= 0; h--) {
+		if ((online & (1UL << h)) && h != boot) {
+			return h;
+		}
+	}
+	return -1;
+}
+
+static void affinity_pinned_task(void *param)
+{
+	(void)param;
+	int self = getpid();
+	unsigned long mask;
+
+	if (sched_getaffinity(-1, sizeof(mask), &mask) < 0 || mask == 0) {
+		fail("sched_getaffinity() of a new task");
+	}
+	mask = 0;
+	if (sched_setaffinity(-1, sizeof(mask), &mask) == 0) {
+		fail("an empty mask was accepted");
+	}
+	mask = 1UL << (MAXNUM_CPU - 1);
+	if (!(smp_online_mask() & mask) && sched_setaffinity(-1, sizeof(mask), &mask) == 0) {
+		fail("a mask of offline harts was accepted");
+	}
+
+	long target = pick_hart();
+	if (target < 0) {
+		printf("[affinity] skipped: no secondary hart online\n");
+		pinned_ready = 1;
+		tasks_done++;
+		test_task_done();
+		exit(0);
+	}
+	mask = 1UL << target;
+	if (sched_setaffinity(self, sizeof(mask), &mask) < 0) {
+		fail("sched_setaffinity() to one hart");
+	}
+	unsigned long got = 0;
+	sched_getaffinity(self, sizeof(got), &got);
+	if (got != mask) {
+		fail("sched_getaffinity() does not return the mask just set");
+	}
+
+	// 设置之后的第一次调度把任务搬到目标 hart 上
+	while (hart_current_id() != target) {
+		yield();
+	}
+	pinned_hart = target;
+	pinned_ready = 1;
+	uint32_t migrations = tasks[self].migrations;
+
+	int wrong = 0;
+	for (int i = 0; i < AFFINITY_ROUNDS; i++) {
+		yield();
+		if (hart_current_id() != target) {
+			wrong++;
+		}
+	}
+	if (wrong) {
+		test_failed();
+		printf("[affinity] FAIL: pinned task left hart %ld in %d of %d rounds\n",
+		       target, wrong, AFFINITY_ROUNDS);
+		errors++;
+	}
+	if (tasks[self].migrations != migrations) {
+		fail("pinned task migrated");
+	}
+	printf("[affinity] pinned to hart %ld: %d rounds, %ld migrations in total\n",
+	       target, AFFINITY_ROUNDS, (long)tasks[self].migrations);
+
+	tasks_done++;
+	while (tasks_done < 2) {
+		yield();
+	}
+	if (errors == 0) {
+		printf("[affinity] PASS: tasks only run on the harts in their affinity mask\n");
+	}
+	test_task_done();
+	exit(0);
+}
+
+static void affinity_noisy_task(void *param)
+{
+	(void)param;
+	int self = getpid();
+
+	while (!pinned_ready) {
+		yield();
+	}
+	if (pinned_hart < 0) {
+		tasks_done++;
+		exit(0);
+	}
+
+	unsigned long mask = smp_online_mask() & ~(1UL << pinned_hart);
+	if (sched_setaffinity(self, sizeof(mask), &mask) < 0) {
+		fail("sched_setaffinity() excluding one hart");
+	}
+	while (hart_current_id() == pinned_hart) {
+		yield();
+	}
+
+	int wrong = 0;
+	for (int i = 0; i < AFFINITY_ROUNDS; i++) {
+		yield();
+		if (hart_current_id() == pinned_hart) {
+			wrong++;
+		}
+	}
+	if (wrong) {
+		test_failed();
+		printf("[affinity] FAIL: noisy task ran on hart %ld in %d of %d rounds\n",
+		       pinned_hart, wrong, AFFINITY_ROUNDS);
+		errors++;
+	}
+	tasks_done++;
+	exit(0);
+}
+
+void test_affinity(void)
+{
+	printk("--- Starting CPU Affinity Test (runs under the scheduler) ---\n");
+	test_task_begin();
+	task_create(affinity_pinned_task, NULL, 4, DEFAULT_TIMESLICE);
+	task_create(affinity_noisy_task, NULL, 4, DEFAULT_TIMESLICE);
+}
@@ -0,0 +1,118 @@
+#include "kernel.h"
+#include "uapi/uart.h"
+#include "uapi/printf.h"
+#include "syscalls.h"
+#include "test.h"
+
+/*
+ * 阻塞式控制台读取测试
+ *
+ * 读者任务调用 read(0, ...)，在没有输入时睡眠在 UART 的等待队列上，
+ * 由接收中断唤醒。输入来自 QEMU 的标准输入，可以手动输入，也可以用管道：
+ *
+ *     printf 'hello\nworld\nq\n' | make rt
+ *
+ * 每读到一批数据，就打印唤醒延迟：从中断处理函数唤醒读者到读者真正
+ * 读走数据之间经过的 rdtime 计数（console_stats 系统调用）。输入以 'q'
+ * 开头的一行时测试结束。
+ *
+ * 没有人输入时（make rt 直接在终端里运行），CONSOLE_WAIT_SECS 秒后
+ * 看门狗任务报告跳过；读者仍然睡在 read() 里，之后有输入还会继续。
+ */
+
+#define TICKS_PER_US (TIMER_INTERVAL / 1000000)
+#define CONSOLE_WAIT_SECS 5
+
+static volatile int got_input;
+static volatile int reported;
+
+/* 读者和看门狗谁先得出结论谁报告，测试只结束一次 */
+static void console_done(void)
+{
+	if (!__atomic_exchange_n(&reported, 1, __ATOMIC_ACQ_REL)) {
+		test_task_done();
+	}
+}
+
+static void print_rx_stats(void)
+{
+	struct uart_rx_stats st;
+	if (console_stats(&st) < 0) {
+		test_failed();
+		printf("[console] FAIL: console_stats() failed\n");
+		return;
+	}
+
+	long avg = st.wakeups ? (long)(st.total_ticks / st.wakeups) : 0;
+	printf("[console] wakeups=%ld avg=%ld ticks (%ld us) max=%ld ticks (%ld us) overruns=%d\n",
+	       (long)st.wakeups, avg, avg / TICKS_PER_US,
+	       (long)st.max_ticks, (long)st.max_ticks / TICKS_PER_US, (int)st.overruns);
+}
+
+static void console_reader_task(void *param)
+{
+	char buf[64];
+	long total = 0;
+
+	(void)param;
+	printf("[console] reader started, type a line (a line starting with 'q' ends the test)\n");
+
+	while (1) {
+		long n = read(0, buf, sizeof(buf) - 1);
+		if (n <= 0) {
+			// 阻塞读取只会在拿到数据后返回
+			test_failed();
+			printf("[console] FAIL: read returned %ld without input\n", n);
+			console_done();
+			exit(-1);
+		}
+		buf[n] = 0;
+		total += n;
+		got_input = 1;
+
+		printf("[console] read %ld bytes: %s", n, buf);
+		if (buf[n - 1] != '\n' && buf[n - 1] != '\r') {
+			printf("\n");
+		}
+		print_rx_stats();
+
+		if (buf[0] == 'q') {
+			break;
+		}
+	}
+
+	printf("[console] PASS: %ld bytes read without polling\n", total);
+	console_done();
+	exit(0);
+}
+
+static void console_watchdog_task(void *param)
+{
+	(void)param;
+	sleep(CONSOLE_WAIT_SECS);
+	if (!got_input) {
+		printf("[console] skipped: no console input within %d s "
+		       "(pipe some in, e.g. printf 'hello\\nq\\n' | make rt)\n", CONSOLE_WAIT_SECS);
+		console_done();
+	}
+	exit(0);
+}
+
+/* 读者睡眠时必须还有一个可运行的任务，沿用 os_main() 中 just_while 的做法 */
+static void console_spin_task(void *param)
+{
+	(void)param;
+	while (1) {
+		for (volatile int i = 0; i < 1000000; i++)
+			;
+	}
+}
+
+void test_console(void)
+{
+	printk("--- Starting Console Read Test (runs under the scheduler) ---\n");
+	test_task_begin();
+	task_create(console_reader_task, NULL, 1, DEFAULT_TIMESLICE);
+	task_create(console_watchdog_task, NULL, 1, DEFAULT_TIMESLICE);
+	task_create(console_spin_task, NULL, 31, DEFAULT_TIMESLICE);
+}
@@ -0,0 +1,189 @@
+#include "kernel.h"
+#include "arch/sbi.h"
+#include "kernel/hart.h"
+#include "kernel/smp.h"
+#include "kernel/cpuidle.h"
+#include "uapi/printf.h"
+#include "uapi/sync.h"
+#include "uapi/stats.h"
+#include "syscalls.h"
+#include "test.h"
+
+/*
+ * 空闲状态测试（任务在调度器启动后于用户态运行）
+ *
+ * 再启动一个还停着的 hart，上面只绑定一个 sleeper 任务：它在信号量上
+ * 阻塞，这个 hart 就进入空闲状态。绑定在别的 hart 上的 waker 每隔一段
+ * 时间 post 一次，间隔从 50 us 到 20 ms 分三档，每档若干轮：
+ *   - governor 按最近的空闲时间预测，间隔越长应该选越深的状态；
+ *   - 每档打印这个 hart 进入各状态的次数，以及内核测到的唤醒延迟
+ *     （IPI 发出到恢复执行）和 sleeper 看到的延迟（post 到它运行）；
+ *   - 检查间隔越长，平均进入的状态越深。
+ * 各状态的计数用 getstats() 读这个 hart 的统计计数器。
+ */
+
+#define CPUIDLE_ROUNDS 16
+
+/* 测试用的 hart；没有停着的 hart 时为 -1，测试跳过 */
+static long idle_hart = -1;
+/* 被隔离的 hart 只用退出够快的状态，不检查深度 */
+static int idle_isolated;
+
+static const uint64_t gaps_us[] = { 50, 1000, 20000 };
+#define NR_GAPS (sizeof(gaps_us) / sizeof(gaps_us[0]))
+
+static sem_t wake_sem = SEM_INITIALIZER(0);
+static sem_t done_sem = SEM_INITIALIZER(0);
+static volatile uint64_t posted_at;
+static uint64_t user_latency[NR_GAPS];
+static volatile int woken;
+
+/* 和 kernel/cpuidle.c 的状态编号一致 */
+static const char *state_names[CPUIDLE_NR_STATES] = { "wfi", "retentive", "non-retentive" };
+
+extern void _secondary_start(void);
+
+static void cpuidle_sleeper_task(void *param)
+{
+	(void)param;
+
+	for (unsigned g = 0; g < NR_GAPS; g++) {
+		for (int i = 0; i < CPUIDLE_ROUNDS; i++) {
+			sem_wait(&wake_sem);
+			user_latency[g] += user_rdtime() - posted_at;
+			woken++;
+			sem_post(&done_sem);
+		}
+	}
+	exit(0);
+}
+
+/* 读空闲 hart 的统计计数器 */
+static void read_idle_stats(struct kstats *st)
+{
+	if (getstats(idle_hart, st, sizeof(*st)) != (long)sizeof(*st)) {
+		test_failed();
+		printf("[cpuidle] FAIL: getstats() of hart %ld\n", idle_hart);
+	}
+}
+
+static void cpuidle_waker_task(void *param)
+{
+	(void)param;
+	static struct kstats before, after;
+	long depth[NR_GAPS];	// 每档平均进入的状态编号 x100，越大越深
+	int failed = 0;
+
+	for (unsigned g = 0; g < NR_GAPS; g++) {
+		uint64_t gap = gaps_us[g] * (TIMER_INTERVAL / 1000000);
+
+		read_idle_stats(&before);
+		for (int i = 0; i < CPUIDLE_ROUNDS; i++) {
+			uint64_t start = user_rdtime();
+			while (user_rdtime() - start < gap)
+				;
+			posted_at = user_rdtime();
+			sem_post(&wake_sem);
+			sem_wait(&done_sem);
+		}
+		read_idle_stats(&after);
+
+		printf("[cpuidle] gap %ld us: user wake latency avg %ld ns\n", (long)gaps_us[g],
+		       (long)(user_latency[g] / CPUIDLE_ROUNDS * NS_PER_TICK));
+		uint64_t entries = 0, weighted = 0;
+		for (int s = 0; s < CPUIDLE_NR_STATES; s++) {
+			uint64_t usage = after.idle[s].entries - before.idle[s].entries;
+			uint64_t wakeups = after.idle[s].wakeups - before.idle[s].wakeups;
+			uint64_t residency = after.idle[s].residency - before.idle[s].residency;
+			uint64_t latency = after.idle[s].latency - before.idle[s].latency;
+			printf("[cpuidle]   %-13s %3ld entries, avg residency %ld us, avg wake latency %ld ns\n",
+			       state_names[s], (long)usage,
+			       usage ? (long)(residency / usage * NS_PER_TICK / 1000) : 0L,
+			       wakeups ? (long)(latency / wakeups * NS_PER_TICK) : 0L);
+			entries += usage;
+			weighted += usage * s;
+		}
+		depth[g] = entries ? (long)(weighted * 100 / entries) : 0;
+	}
+
+	uint64_t entries = 0, deep_entries = 0, deep_refused = 0;
+	for (int s = 0; s < CPUIDLE_NR_STATES; s++) {
+		entries += after.idle[s].entries;
+		if (s != CPUIDLE_WFI) {
+			deep_entries += after.idle[s].entries;
+			deep_refused += after.idle[s].refused;
+		}
+		printf("[cpuidle] %s: %ld entries, %ld refused by SBI\n",
+		       state_names[s], (long)after.idle[s].entries, (long)after.idle[s].refused);
+	}
+	if (woken != (int)(NR_GAPS * CPUIDLE_ROUNDS)) {
+		test_failed();
+		printf("[cpuidle] FAIL: %d of %d wake-ups arrived\n", woken, (int)(NR_GAPS * CPUIDLE_ROUNDS));
+		failed = 1;
+	}
+	if (entries == 0) {
+		test_failed();
+		printf("[cpuidle] FAIL: hart %ld never entered an idle state\n", idle_hart);
+		failed = 1;
+	}
+
+	// 间隔越长 governor 应该选越深的状态；SBI 不支持挂起时只剩 wfi，不检查
+	if (deep_entries == 0 && deep_refused > 0) {
+		printf("[cpuidle] SBI refused every suspend, depth check skipped\n");
+	} else if (idle_isolated) {
+		printf("[cpuidle] hart %ld is isolated and only uses fast states, depth check skipped\n",
+		       idle_hart);
+	} else {
+		for (unsigned g = 1; g < NR_GAPS; g++) {
+			if (depth[g] < depth[g - 1]) {
+				test_failed();
+				printf("[cpuidle] FAIL: gap %ld us chose shallower states than gap %ld us\n",
+				       (long)gaps_us[g], (long)gaps_us[g - 1]);
+				failed = 1;
+			}
+		}
+		if (depth[NR_GAPS - 1] <= depth[0]) {
+			test_failed();
+			printf("[cpuidle] FAIL: the longest gap did not choose deeper states than the shortest\n");
+			failed = 1;
+		}
+	}
+	if (!failed) {
+		printf("[cpuidle] PASS: every wake-up reached the idle hart, longer gaps chose deeper states\n");
+	}
+	test_task_done();
+	exit(0);
+}
+
+void test_cpuidle(void)
+{
+	printk("--- Starting CPU Idle Test (runs under the scheduler) ---\n");
+
+	// 找一个还停着的 hart，只给它绑定 sleeper
+	for (long h = 0; h < MAXNUM_CPU && idle_hart < 0; h++) {
+		struct sbiret st = sbi_hart_get_status(h);
+		if (st.error == SBI_SUCCESS && st.value == SBI_HSM_STATE_STOPPED &&
+		    hart_start(h, (unsigned long)_secondary_start, (unsigned long)secondary_start_kernel) == 0) {
+			idle_hart = h;
+		}
+	}
+	if (idle_hart < 0) {
+		printk("cpuidle: no stopped hart to start, skipped\n");
+		return;
+	}
+	for (int i = 0; i < 1000000 && !(smp_online_mask() & (1UL << idle_hart)); i++)
+		;
+
+	idle_isolated = (hart_isolated_mask() >> idle_hart) & 1;
+	unsigned long others = smp_online_mask() & ~(1UL << idle_hart) & ~hart_isolated_mask();
+	int sleeper = task_create(cpuidle_sleeper_task, NULL, 2, DEFAULT_TIMESLICE);
+	int waker = task_create(cpuidle_waker_task, NULL, 2, DEFAULT_TIMESLICE);
+	if (waker >= 0) {
+		test_task_begin();
+	}
+	if (sleeper < 0 || waker < 0 ||
+	    task_set_affinity(sleeper, 1UL << idle_hart) < 0 || task_set_affinity(waker, others) < 0) {
+		test_failed();
+		printk("✗ FAIL: cannot create the cpuidle tasks\n");
+	}
+}
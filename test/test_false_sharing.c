@@ -0,0 +1,155 @@
+#include "kernel.h"
+#include "kernel/hart.h"
+#include "kernel/smp.h"
+#include "syscalls.h"
+#include "test.h"
+
+/*
+ * 调度路径的伪共享测试（任务在调度器启动后于用户态运行）
+ *
+ * 每个参与调度的 hart（在线、没有被隔离）上绑定一个高优先级任务，反复
+ * yield()：每次都经过 schedule() 和 pick_next_task()，读写运行队列、
+ * 本 hart 的 per-CPU 数据和自己的 task_struct。先只让一个任务单独跑，
+ * 再让所有任务同时跑，比较每次 yield 的平均耗时：同时跑时变慢的部分
+ * 来自内核锁和被多个 hart 写的缓存行。
+ *
+ * QEMU TCG 不模拟缓存一致性，比值主要反映内核锁的竞争；在真实的多核
+ * 硬件上才看得出缓存行的影响。所以只检查每个任务都完成了全部 yield，
+ * 并且一直在自己的 hart 上。
+ */
+
+#define FS_YIELDS 2000
+#define FS_PRIORITY 1
+
+static int nworkers;
+static long worker_hart[MAXNUM_CPU];
+static volatile int bench_phase;	// 1：只有 0 号任务跑；2：所有任务一起跑
+static volatile int bench_done;
+static volatile int arrived;
+static uint64_t elapsed[2][MAXNUM_CPU];
+static volatile int moved;
+
+static void wait_phase(int phase)
+{
+	int p;
+
+	while ((p = bench_phase) < phase) {
+		futex_wait(&bench_phase, p);
+	}
+}
+
+static void finish_phase(void)
+{
+	__atomic_fetch_add(&bench_done, 1, __ATOMIC_RELEASE);
+	futex_wake(&bench_done, 1);
+}
+
+static uint64_t yield_loop(long hart)
+{
+	uint64_t start = user_rdtime();
+
+	for (int i = 0; i < FS_YIELDS; i++) {
+		yield();
+	}
+	uint64_t t = user_rdtime() - start;
+	if (hart_current_id() != hart) {
+		moved++;
+	}
+	return t;
+}
+
+static void sched_bench_task(void *param)
+{
+	long idx = (long)param;
+	long hart = worker_hart[idx];
+
+	wait_phase(1);
+	if (idx == 0) {
+		elapsed[0][0] = yield_loop(hart);
+		finish_phase();
+	}
+
+	wait_phase(2);
+	// 都醒来之后再一起开始
+	__atomic_fetch_add(&arrived, 1, __ATOMIC_RELEASE);
+	while (__atomic_load_n(&arrived, __ATOMIC_ACQUIRE) < nworkers)
+		;
+	elapsed[1][idx] = yield_loop(hart);
+	finish_phase();
+	exit(0);
+}
+
+/* 把阶段推进到 phase，等 n 个任务做完 */
+static void run_phase(int phase, int n)
+{
+	int d;
+
+	bench_done = 0;
+	bench_phase = phase;
+	futex_wake(&bench_phase, nworkers);
+	while ((d = bench_done) < n) {
+		futex_wait(&bench_done, d);
+	}
+}
+
+static void sched_bench_control_task(void *param)
+{
+	(void)param;
+
+	run_phase(1, 1);
+	run_phase(2, nworkers);
+
+	uint64_t solo = elapsed[0][0];
+	uint64_t together = 0;
+	for (int i = 0; i < nworkers; i++) {
+		together += elapsed[1][i];
+	}
+	together /= nworkers;
+
+	printf("[false sharing] yield(): alone %ld ns, %d harts at once %ld ns",
+	       (long)(solo * NS_PER_TICK / FS_YIELDS), nworkers,
+	       (long)(together * NS_PER_TICK / FS_YIELDS));
+	if (solo) {
+		printf(" (%ld%%)", (long)(together * 100 / solo));
+	}
+	printf("\n");
+	if (moved) {
+		test_failed();
+		printf("[false sharing] FAIL: %d pinned tasks left their hart\n", moved);
+	} else {
+		printf("[false sharing] PASS: %d pinned tasks each yielded %d times alone and together\n",
+		       nworkers, FS_YIELDS);
+	}
+	test_task_done();
+	exit(0);
+}
+
+void test_false_sharing(void)
+{
+	unsigned long harts = (smp_online_mask() | (1UL << this_hart())) & ~hart_isolated_mask();
+
+	printk("--- Starting Scheduler False Sharing Benchmark (runs under the scheduler) ---\n");
+	if (__builtin_popcountl(harts) < 2) {
+		printk("false sharing: needs two normal harts online, skipped\n");
+		return;
+	}
+
+	for (long h = 0; h < MAXNUM_CPU; h++) {
+		if (!(harts & (1UL << h))) {
+			continue;
+		}
+		int id = task_create(sched_bench_task, (void *)(long)nworkers, FS_PRIORITY, DEFAULT_TIMESLICE);
+		if (id < 0 || task_set_affinity(id, 1UL << h) < 0) {
+			test_failed();
+			printk("✗ FAIL: cannot create a yield task on hart %ld\n", h);
+			return;
+		}
+		worker_hart[nworkers++] = h;
+	}
+	if (task_create(sched_bench_control_task, NULL, 3, DEFAULT_TIMESLICE) < 0) {
+		test_failed();
+		printk("✗ FAIL: cannot create the benchmark control task\n");
+		return;
+	}
+	test_task_begin();
+}
@@ -0,0 +1,166 @@
+#include "kernel.h"
+#include "kernel/vm.h"
+#include "string.h"
+#include "uapi/printf.h"
+#include "syscalls.h"
+#include "test.h"
+
+/*
+ * 写时复制 clone 测试（任务在调度器启动后于用户态运行）
+ *
+ * 父任务先把 HEAP_SIZE 的 sbrk 堆全部写满，再 clone 一个子任务：
+ *   - 打印 clone 的耗时，以及它为子任务分配的物理页数（只有页表），
+ *     和立即复制整个堆所需的页数对比；
+ *   - 子任务不写就能读到父任务的数据；写 WRITE_PAGES 页时发生同样多次
+ *     写时复制缺页，父任务看到的内容不变；
+ *   - 子任务退出后父任务的页面都只剩一个使用者，再写也不用复制。
+ *
+ * 测试任务和内核链接在同一个镜像里，直接读 task_mm 和页的引用计数（用户态
+ * 的 tp 是 TLS，current_task_id 只能在内核里用，任务用 getpid() 找到自己）；
+ * 两个任务之间用全局变量同步，全局变量不在用户窗口里，不会被复制。
+ */
+
+#define HEAP_SIZE (16UL << 20)
+#define HEAP_PAGES (HEAP_SIZE / PAGE_SIZE)
+#define WRITE_PAGES 16
+
+static volatile int child_go;
+static volatile int child_errors;
+
+static uint64_t *page_word(char *heap, unsigned long i)
+{
+	return (uint64_t *)(heap + i * PAGE_SIZE);
+}
+
+static void fork_child_task(void *param)
+{
+	char *heap = param;
+	struct task_mm *mm = &tasks[getpid()].mm;
+
+	while (!child_go) {
+		yield();
+	}
+
+	// 只读：看到的是父任务的页面，不需要复制
+	for (unsigned long i = 0; i < HEAP_PAGES; i += HEAP_PAGES / 64) {
+		if (*page_word(heap, i) != i) {
+			child_errors++;
+		}
+	}
+	if (mm->cow_faults != 0) {
+		child_errors++;
+	}
+
+	for (unsigned long i = 0; i < WRITE_PAGES; i++) {
+		*page_word(heap, i) = ~i;
+	}
+	for (unsigned long i = 0; i < WRITE_PAGES; i++) {
+		if (*page_word(heap, i) != ~i) {
+			child_errors++;
+		}
+	}
+	if (mm->cow_copies != WRITE_PAGES) {
+		test_failed();
+		printf("[fork] FAIL: child wrote %d pages, %ld were copied\n",
+		       WRITE_PAGES, (long)mm->cow_copies);
+		child_errors++;
+	}
+
+	exit(0);
+}
+
+static void fork_parent_task(void *param)
+{
+	struct task_mm *mm = &tasks[getpid()].mm;
+	int errors = 0;
+
+	(void)param;
+	char *heap = sbrk(HEAP_SIZE);
+	if (heap == (void *)-1) {
+		test_failed();
+		printf("[fork] FAIL: sbrk of %ld bytes\n", (long)HEAP_SIZE);
+		test_task_done();
+		exit(0);
+	}
+	for (unsigned long i = 0; i < HEAP_PAGES; i++) {
+		*page_word(heap, i) = i;
+	}
+
+	uint64_t start = user_rdtime();
+	int child = clone(fork_child_task, heap);
+	uint64_t ticks = user_rdtime() - start;
+
+	if (child < 0) {
+		test_failed();
+		printf("[fork] FAIL: clone\n");
+		test_task_done();
+		exit(0);
+	}
+	struct task_mm *cm = &tasks[child].mm;
+	printf("[fork] clone with a %ld MB heap: ~%ld us, %d pages shared, %d new pages (page tables) instead of %ld for a copy\n",
+	       (long)(HEAP_SIZE >> 20), (long)(ticks * NS_PER_TICK / 1000),
+	       (int)cm->pages, (int)cm->pt_pages, (long)HEAP_PAGES);
+	if (cm->pages != mm->pages || cm->pt_pages > HEAP_PAGES / 64) {
+		test_failed();
+		printf("[fork] FAIL: clone should share every page and only allocate page tables\n");
+		errors++;
+	}
+
+	child_go = 1;
+	while (tasks[child].state != TASK_EXITED) {
+		yield();
+	}
+
+	// 子任务的页表和它复制出来的页都已归还，父任务的页又是独占的
+	int still_shared = 0;
+	for (unsigned long i = 0; i < HEAP_PAGES; i++) {
+		void *pa = vm_user_page(&tasks[getpid()], (uintptr_t)page_word(heap, i), 0);
+		if (page_refs((void *)((uintptr_t)pa & ~(uintptr_t)(PAGE_SIZE - 1))) != 1) {
+			still_shared++;
+		}
+	}
+
+	// 子任务写过的页在父任务里保持原样
+	for (unsigned long i = 0; i < HEAP_PAGES; i++) {
+		if (*page_word(heap, i) != i) {
+			test_failed();
+			printf("[fork] FAIL: the child's write to page %ld reached the parent\n", (long)i);
+			errors++;
+			break;
+		}
+	}
+
+	// 子任务已经退出，父任务的页只剩一个使用者：写缺页但不复制
+	uint64_t copies_before = mm->cow_copies;
+	uint64_t faults_before = mm->cow_faults;
+	*page_word(heap, 0) = 1;
+	if (mm->cow_faults != faults_before + 1 || mm->cow_copies != copies_before) {
+		test_failed();
+		printf("[fork] FAIL: sole owner should get its page back without a copy\n");
+		errors++;
+	}
+	if (child_errors) {
+		test_failed();
+		printf("[fork] FAIL: %d checks failed in the child\n", child_errors);
+		errors += child_errors;
+	}
+	if (still_shared != 0) {
+		test_failed();
+		printf("[fork] FAIL: %d pages still shared after the child exited\n", still_shared);
+		errors++;
+	}
+	if (errors == 0) {
+		printf("[fork] PASS: copy-on-write clone shares the heap until it is written\n");
+	}
+	sbrk(-(long)HEAP_SIZE);
+	test_task_done();
+	exit(0);
+}
+
+void test_fork(void)
+{
+	printk("--- Starting Copy-on-write Clone Test (runs under the scheduler) ---\n");
+	if (task_create(fork_parent_task, NULL, 5, DEFAULT_TIMESLICE) >= 0) {
+		test_task_begin();
+	}
+}
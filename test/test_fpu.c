@@ -0,0 +1,265 @@
+#include "kernel.h"
+#include "kernel/fpu.h"
+#include "kernel/hart.h"
+#include "kernel/vector.h"
+#include "uapi/printf.h"
+#include "uapi/sync.h"
+#include "syscalls.h"
+#include "test.h"
+
+/*
+ * 惰性 FPU/向量上下文切换测试（任务在调度器启动后于用户态运行）
+ *
+ * 两个同优先级的任务用 yield() 轮流运行，依次测四种组合：
+ *   整数 + 整数、浮点 + 整数、浮点 + 浮点、向量 + 向量（需要 QEMU v=true）。
+ * 浮点任务每轮做几次浮点运算，并把自己的标记值放在 fs0、舍入模式放在 frm，
+ * yield 回来后检查它们没有被另一个任务改掉；向量任务同样检查 v1。
+ * 每种组合打印平均每次切换的耗时，以及期间发生的首次使用陷阱和寄存器保存次数：
+ * 浮点 + 整数时浮点任务一直拥有 FPU，不应该有任何保存。
+ *
+ * 跨 hart 迁移：migrant 任务写好 fs0/frm（有 V 时还有 v1）后在信号量上
+ * 阻塞，它所在的 hart 因此进入空闲，寄存器仍是 Dirty；helper 任务在另一个
+ * hart 上把它的亲和性改到对面再唤醒它，检查寄存器跟着它到了新的 hart。
+ * 只有一个 hart 在线时跳过。
+ *
+ * 测试任务和内核链接在同一个镜像里，可以直接调用 fpu_get_stats() 读统计。
+ */
+
+#define SWITCH_ROUNDS 2000
+
+enum { WORK_INT, WORK_FP, WORK_VEC };
+
+#define NUM_MIXES 4
+static const int mix_work[2][NUM_MIXES] = {
+	{ WORK_INT, WORK_FP, WORK_FP, WORK_VEC },
+	{ WORK_INT, WORK_INT, WORK_FP, WORK_VEC },
+};
+static const char *mix_names[NUM_MIXES] = { "int + int", "fp + int", "fp + fp", "vector + vector" };
+
+#define MIGRATE_ROUNDS 50
+#define MIGRATE_GAP_US 100
+
+static volatile int arrived;
+static volatile int errors;
+
+static sem_t migrate_ready = SEM_INITIALIZER(0);
+static sem_t migrate_go = SEM_INITIALIZER(0);
+static volatile long migrant_hart = -1;
+static volatile int migrant_pid;
+static volatile int migrate_skip;
+
+/* 不声明 clobber：-O0 下编译器不会在这些函数之间使用 fs0/v1 */
+static void fp_mark(uint64_t v, int rm)
+{
+	asm volatile("fmv.d.x fs0, %0\n\tfsrm %1" : : "r"(v), "r"(rm));
+}
+
+static int fp_check(uint64_t v, int rm)
+{
+	uint64_t got;
+	long got_rm;
+	asm volatile("fmv.x.d %0, fs0\n\tfrrm %1" : "=r"(got), "=r"(got_rm));
+	return got == v && got_rm == rm;
+}
+
+static void vec_mark(uint64_t v)
+{
+	asm volatile(".option push\n\t.option arch, +v\n\t"
+		     "vsetivli zero, 2, e64, m1, ta, ma\n\t"
+		     "vmv.v.x v1, %0\n\t"
+		     ".option pop" : : "r"(v));
+}
+
+static int vec_check(uint64_t v)
+{
+	uint64_t got;
+	asm volatile(".option push\n\t.option arch, +v\n\t"
+		     "vsetivli zero, 2, e64, m1, ta, ma\n\t"
+		     "vmv.x.s %0, v1\n\t"
+		     ".option pop" : "=r"(got));
+	return got == v;
+}
+
+static volatile double fp_acc = 1.0;
+
+static void run_round(int work, long id, int i)
+{
+	uint64_t mark = ((uint64_t)(id + 1) << 32) | (uint64_t)i;
+	int rm = (int)id + 1;	// RTZ / RDN
+
+	switch (work) {
+	case WORK_FP:
+		fp_mark(mark, rm);
+		for (int k = 0; k < 4; k++) {
+			fp_acc = fp_acc * 1.000001 + 0.5;
+		}
+		yield();
+		if (!fp_check(mark, rm)) {
+			errors++;
+		}
+		break;
+	case WORK_VEC:
+		vec_mark(mark);
+		yield();
+		if (!vec_check(mark)) {
+			errors++;
+		}
+		break;
+	default:
+		yield();
+		break;
+	}
+}
+
+static void wait_for_partner(int mix)
+{
+	arrived++;
+	while (arrived < 2 * (mix + 1)) {
+		yield();
+	}
+}
+
+static void fpu_switch_task(void *param)
+{
+	long id = (long)param;
+
+	for (int mix = 0; mix < NUM_MIXES; mix++) {
+		if (mix_work[id][mix] == WORK_VEC && !has_vector) {
+			if (id == 0) {
+				printf("[fpu] %s: skipped, no V extension\n", mix_names[mix]);
+			}
+			wait_for_partner(mix);
+			continue;
+		}
+
+		struct fpu_stats before, after;
+		fpu_get_stats(&before);
+		uint64_t start = user_rdtime();
+		for (int i = 0; i < SWITCH_ROUNDS; i++) {
+			run_round(mix_work[id][mix], id, i);
+		}
+		uint64_t ticks = user_rdtime() - start;
+		fpu_get_stats(&after);
+
+		// 两个任务交替运行，每轮包含两次切换
+		if (id == 0) {
+			printf("[fpu] %s: ~%ld ns per switch, fp traps %ld saves %ld, v traps %ld saves %ld\n",
+			       mix_names[mix], (long)(ticks * NS_PER_TICK / (2 * SWITCH_ROUNDS)),
+			       (long)(after.fp_traps - before.fp_traps), (long)(after.fp_saves - before.fp_saves),
+			       (long)(after.v_traps - before.v_traps), (long)(after.v_saves - before.v_saves));
+		}
+		wait_for_partner(mix);
+	}
+
+	if (id == 0) {
+		if (errors == 0) {
+			printf("[fpu] PASS: FP and vector registers survive context switches\n");
+		} else {
+			test_failed();
+			printf("[fpu] FAIL: %d corrupted register checks\n", errors);
+		}
+		test_task_done();
+	}
+	exit(0);
+}
+
+/* 每轮换一个 hart 醒来，醒来后 fs0/frm/v1 必须还是阻塞前写的值 */
+static void fpu_migrant_task(void *param)
+{
+	(void)param;
+	long hart = hart_current_id();
+	unsigned long mask = 1UL << hart;
+	int bad = 0, moved = 0;
+
+	sched_setaffinity(-1, sizeof(mask), &mask);
+	migrant_pid = getpid();
+	migrant_hart = hart;
+
+	for (int i = 0; i < MIGRATE_ROUNDS; i++) {
+		uint64_t mark = (0x5a5aUL << 32) | (uint64_t)i;
+		int rm = 1 + (i & 3);	// RTZ、RDN、RUP、RMM 轮换
+
+		fp_mark(mark, rm);
+		fp_acc = fp_acc * 1.000001 + 0.5;
+		if (has_vector) {
+			vec_mark(mark);
+		}
+		sem_post(&migrate_ready);
+		sem_wait(&migrate_go);
+		if (migrate_skip) {
+			break;
+		}
+		if (!fp_check(mark, rm) || (has_vector && !vec_check(mark))) {
+			bad++;
+		}
+		long now = hart_current_id();
+		if (now != hart) {
+			moved++;
+			hart = now;
+		}
+	}
+
+	if (migrate_skip) {
+		printf("[fpu] cross-hart migration skipped: no second hart online\n");
+	} else if (bad) {
+		test_failed();
+		printf("[fpu] FAIL: registers lost in %d of %d cross-hart wake-ups\n", bad, MIGRATE_ROUNDS);
+	} else if (moved == 0) {
+		test_failed();
+		printf("[fpu] FAIL: the migrant never woke up on another hart\n");
+	} else {
+		printf("[fpu] PASS: FP%s registers follow a task woken on another hart (%d moves)\n",
+		       has_vector ? "/vector" : "", moved);
+	}
+	test_task_done();
+	exit(0);
+}
+
+/* 等 migrant 睡下，把它的亲和性在两个 hart 之间来回改，再唤醒它 */
+static void fpu_migrate_helper_task(void *param)
+{
+	(void)param;
+
+	while (migrant_hart < 0) {
+		yield();
+	}
+	long home = migrant_hart;
+	unsigned long mask = ~(1UL << home);
+	if (sched_setaffinity(-1, sizeof(mask), &mask) < 0) {
+		migrate_skip = 1;
+		sem_post(&migrate_go);
+		exit(0);
+	}
+	while (hart_current_id() == home) {
+		yield();
+	}
+	long away = hart_current_id();
+
+	uint64_t gap = MIGRATE_GAP_US * (TIMER_INTERVAL / 1000000);
+	for (int i = 0; i < MIGRATE_ROUNDS; i++) {
+		sem_wait(&migrate_ready);
+		// 留出时间让 migrant 在信号量上睡下、它的 hart 进入空闲
+		uint64_t start = user_rdtime();
+		while (user_rdtime() - start < gap)
+			;
+		mask = 1UL << ((i & 1) ? home : away);
+		sched_setaffinity(migrant_pid, sizeof(mask), &mask);
+		sem_post(&migrate_go);
+	}
+	exit(0);
+}
+
+void test_fpu(void)
+{
+	printk("--- Starting Lazy FPU Test (runs under the scheduler) ---\n");
+	// 两个任务绑在同一个 hart 上，才是在测同一个 hart 上的切换
+	int a = task_create(fpu_switch_task, (void *)0, 5, DEFAULT_TIMESLICE);
+	int b = task_create(fpu_switch_task, (void *)1, 5, DEFAULT_TIMESLICE);
+	task_set_affinity(a, 1UL << this_hart());
+	task_set_affinity(b, 1UL << this_hart());
+	test_task_begin();
+
+	task_create(fpu_migrant_task, NULL, 5, DEFAULT_TIMESLICE);
+	task_create(fpu_migrate_helper_task, NULL, 5, DEFAULT_TIMESLICE);
+	test_task_begin();
+}
@@ -0,0 +1,207 @@
+#include "kernel.h"
+#include "uapi/printf.h"
+#include "uapi/sync.h"
+#include "syscalls.h"
+#include "test.h"
+
+/*
+ * Futex 和用户态同步原语测试（任务在调度器启动后于用户态运行）
+ *
+ *   - ping 任务：测量无竞争 mutex_lock/mutex_unlock 的开销（不进入内核），
+ *     然后和 pong 任务用两个信号量做乒乓，测量一次往返（两次阻塞+唤醒+
+ *     任务切换）的耗时；
+ *   - 两个 worker 任务：持锁时主动 yield 制造竞争，在 mutex 上阻塞和交接，
+ *     最后用条件变量等待对方结束并检查计数；
+ *   - 跨 hart 交接：waiter 用 sched_setaffinity() 绑在自己的 hart 上，在
+ *     信号量上睡眠；waker 绑在其它 hart 上，每隔 HANDOFF_GAP_US post 一次，
+ *     测量从 post 到 waiter 恢复运行的延迟（futex 唤醒 + IPI + 对方 hart
+ *     从空闲中醒来并切换到 waiter）。只有一个 hart 在线时跳过。
+ *
+ * 除了跨 hart 交接，任务可能分布在不同的 hart 上，阻塞和唤醒也可能跨
+ * hart 发生。
+ */
+
+#define UNCONTENDED_ROUNDS 10000
+#define PINGPONG_ROUNDS 1000
+#define WORKER_ROUNDS 200
+#define HANDOFF_ROUNDS 200
+#define HANDOFF_GAP_US 100
+
+static mutex_t bench_lock = MUTEX_INITIALIZER;
+static sem_t ping_sem = SEM_INITIALIZER(0);
+static sem_t pong_sem = SEM_INITIALIZER(0);
+
+static mutex_t count_lock = MUTEX_INITIALIZER;
+static cond_t done_cond = COND_INITIALIZER;
+static long counter;
+static int workers_done;
+
+static sem_t handoff_sem = SEM_INITIALIZER(0);
+static sem_t handoff_ack = SEM_INITIALIZER(0);
+static volatile long waiter_hart = -1;
+static volatile int handoff_go;		/* 1: 开始交接，-1: 跳过 */
+static volatile uint64_t handoff_posted_at;
+
+static void futex_ping_task(void *param)
+{
+	(void)param;
+
+	uint64_t start = user_rdtime();
+	for (int i = 0; i < UNCONTENDED_ROUNDS; i++) {
+		mutex_lock(&bench_lock);
+		mutex_unlock(&bench_lock);
+	}
+	uint64_t ticks = user_rdtime() - start;
+	printf("[futex] uncontended lock+unlock: ~%ld ns (%d rounds, %ld ticks)\n",
+	       (long)(ticks * NS_PER_TICK / UNCONTENDED_ROUNDS), UNCONTENDED_ROUNDS, (long)ticks);
+
+	start = user_rdtime();
+	for (int i = 0; i < PINGPONG_ROUNDS; i++) {
+		sem_post(&pong_sem);
+		sem_wait(&ping_sem);
+	}
+	ticks = user_rdtime() - start;
+	printf("[futex] ping-pong round trip: ~%ld ns (%d rounds, %ld ticks)\n",
+	       (long)(ticks * NS_PER_TICK / PINGPONG_ROUNDS), PINGPONG_ROUNDS, (long)ticks);
+
+	test_task_done();
+	exit(0);
+}
+
+static void futex_pong_task(void *param)
+{
+	(void)param;
+
+	for (int i = 0; i < PINGPONG_ROUNDS; i++) {
+		sem_wait(&pong_sem);
+		sem_post(&ping_sem);
+	}
+	exit(0);
+}
+
+static void futex_worker_task(void *param)
+{
+	long id = (long)param;
+
+	for (int i = 0; i < WORKER_ROUNDS; i++) {
+		mutex_lock(&count_lock);
+		long v = counter;
+		if ((i & 7) == 0) {
+			// 持锁让出 CPU，迫使另一个 worker 在 futex 上阻塞
+			yield();
+		}
+		counter = v + 1;
+		mutex_unlock(&count_lock);
+	}
+
+	mutex_lock(&count_lock);
+	workers_done++;
+	cond_broadcast(&done_cond);
+	if (id == 0) {
+		while (workers_done < 2) {
+			cond_wait(&done_cond, &count_lock);
+		}
+		if (counter == 2 * WORKER_ROUNDS) {
+			printf("[futex] PASS: contended mutex counter = %ld\n", counter);
+		} else {
+			test_failed();
+			printf("[futex] FAIL: contended mutex counter = %ld, expected %d\n",
+			       counter, 2 * WORKER_ROUNDS);
+		}
+		test_task_done();
+	}
+	mutex_unlock(&count_lock);
+	exit(0);
+}
+
+static void futex_handoff_waiter_task(void *param)
+{
+	(void)param;
+	long hart = hart_current_id();
+	unsigned long mask = 1UL << hart;
+	uint64_t total = 0, max = 0;
+	int moved = 0;
+
+	sched_setaffinity(-1, sizeof(mask), &mask);
+	waiter_hart = hart;
+	while (handoff_go == 0) {
+		yield();
+	}
+	if (handoff_go < 0) {
+		test_task_done();
+		exit(0);
+	}
+
+	for (int i = 0; i < HANDOFF_ROUNDS; i++) {
+		sem_wait(&handoff_sem);
+		uint64_t latency = user_rdtime() - handoff_posted_at;
+		total += latency;
+		if (latency > max) {
+			max = latency;
+		}
+		if (hart_current_id() != hart) {
+			moved++;
+		}
+		sem_post(&handoff_ack);
+	}
+
+	if (moved) {
+		test_failed();
+		printf("[futex] FAIL: handoff waiter left hart %ld in %d rounds\n", hart, moved);
+	}
+	printf("[futex] cross-hart handoff post -> waiter running: avg ~%ld ns, max ~%ld ns (%d rounds)\n",
+	       (long)(total / HANDOFF_ROUNDS * NS_PER_TICK), (long)(max * NS_PER_TICK), HANDOFF_ROUNDS);
+	test_task_done();
+	exit(0);
+}
+
+static void futex_handoff_waker_task(void *param)
+{
+	(void)param;
+
+	while (waiter_hart < 0) {
+		yield();
+	}
+	unsigned long mask = ~(1UL << waiter_hart);
+	if (sched_setaffinity(-1, sizeof(mask), &mask) < 0) {
+		printf("[futex] cross-hart handoff skipped: no second hart online\n");
+		handoff_go = -1;
+		exit(0);
+	}
+	while (hart_current_id() == waiter_hart) {
+		yield();
+	}
+	long hart = hart_current_id();
+	handoff_go = 1;
+
+	uint64_t gap = HANDOFF_GAP_US * (TIMER_INTERVAL / 1000000);
+	for (int i = 0; i < HANDOFF_ROUNDS; i++) {
+		// 留出时间让 waiter 在 futex 上睡下去
+		uint64_t start = user_rdtime();
+		while (user_rdtime() - start < gap)
+			;
+		handoff_posted_at = user_rdtime();
+		sem_post(&handoff_sem);
+		sem_wait(&handoff_ack);
+	}
+	if (hart_current_id() != hart) {
+		test_failed();
+		printf("[futex] FAIL: handoff waker moved off hart %ld\n", hart);
+	}
+	exit(0);
+}
+
+void test_futex(void)
+{
+	printk("--- Starting Futex Test (runs under the scheduler) ---\n");
+	// 报告结果的是 ping、worker 0 和交接的 waiter
+	for (int i = 0; i < 3; i++) {
+		test_task_begin();
+	}
+	task_create(futex_ping_task, NULL, 10, DEFAULT_TIMESLICE);
+	task_create(futex_pong_task, NULL, 10, DEFAULT_TIMESLICE);
+	task_create(futex_worker_task, (void *)0, 12, DEFAULT_TIMESLICE);
+	task_create(futex_worker_task, (void *)1, 12, DEFAULT_TIMESLICE);
+	task_create(futex_handoff_waiter_task, NULL, 10, DEFAULT_TIMESLICE);
+	task_create(futex_handoff_waker_task, NULL, 10, DEFAULT_TIMESLICE);
+}
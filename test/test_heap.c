@@ -0,0 +1,289 @@
+#include "kernel.h"
+#include "kernel/vm.h"
+#include "string.h"
+#include "uapi/printf.h"
+#include "uapi/mman.h"
+#include "uapi/umalloc.h"
+#include "syscalls.h"
+#include "test.h"
+
+/*
+ * 用户态堆测试（任务在调度器启动后于用户态运行）
+ *
+ * 1. sbrk/mmap/munmap 的基本语义：break 的移动和上限、映射按页对齐且已清零、
+ *    munmap 只接受完整的映射。
+ * 2. umalloc：各种大小的块互不重叠，写入的数据释放前保持不变；umalloc(0)
+ *    和 ucalloc(0, n) 的块释放后能正常回到缓存。
+ * 3. 性能：同一大小反复分配释放（命中本任务缓存）、成批分配再全部释放，
+ *    以及每次分配都调用 mmap 作为对照；打印每次操作的耗时、期间的系统调用
+ *    次数、任务占用的物理页数和缺页（minor fault）总数。
+ */
+
+#define HOT_ROUNDS 10000
+#define BATCH 1000
+#define BATCH_ROUNDS 10
+
+static void *blocks[BATCH];
+static uint32_t rng = 12345;
+
+static uint32_t next_rand(void)
+{
+	rng = rng * 1103515245 + 12345;
+	return rng >> 8;
+}
+
+/* 用户态的 tp 是 TLS，不能用 current_task_id，用 getpid() 找到自己 */
+static struct task_struct *me(void)
+{
+	return &tasks[getpid()];
+}
+
+static int check_syscalls(void)
+{
+	int errors = 0;
+
+	char *b0 = sbrk(0);
+	char *b1 = sbrk(100);
+	char *b2 = sbrk(0);
+	if (b0 == (char *)-1 || b1 != b0 || b2 != b0 + 100 || b0[50] != 0) {
+		test_failed();
+		printf("[heap] FAIL: sbrk grows the break\n");
+		errors++;
+	}
+	if (sbrk(-100) != b2 || sbrk(0) != b0) {
+		test_failed();
+		printf("[heap] FAIL: sbrk shrinks the break\n");
+		errors++;
+	}
+	// 缩到页中间再长回来：break 之上的半页必须重新是零
+	char *b3 = sbrk(200);
+	if (b3 == b0) {
+		memset(b3, 0x5a, 200);
+		sbrk(-100);
+		sbrk(100);
+		for (int i = 100; i < 200; i++) {
+			if (b3[i] != 0) {
+				test_failed();
+				printf("[heap] FAIL: sbrk regrow sees stale byte at +%d\n", i);
+				errors++;
+				break;
+			}
+		}
+		sbrk(-200);
+	} else {
+		test_failed();
+		printf("[heap] FAIL: sbrk(200) returned %p, expected %p\n", b3, b0);
+		errors++;
+	}
+	if (sbrk((long)USER_HEAP_MAX + 1) != (void *)-1) {
+		test_failed();
+		printf("[heap] FAIL: sbrk beyond USER_HEAP_MAX succeeded\n");
+		errors++;
+	}
+
+	char *m = mmap(NULL, 3 * PAGE_SIZE - 1, PROT_READ | PROT_WRITE,
+		       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (m == MAP_FAILED || ((uintptr_t)m & (PAGE_SIZE - 1))) {
+		test_failed();
+		printf("[heap] FAIL: mmap returned %p\n", m);
+		return errors + 1;
+	}
+	for (int i = 0; i < 3 * PAGE_SIZE; i++) {
+		if (m[i] != 0) {
+			test_failed();
+			printf("[heap] FAIL: mmap memory not zeroed at %d\n", i);
+			errors++;
+			break;
+		}
+	}
+	memset(m, 0x5a, 3 * PAGE_SIZE);
+	if (munmap(m, PAGE_SIZE) != -1 || munmap(m + PAGE_SIZE, 2 * PAGE_SIZE) != -1) {
+		test_failed();
+		printf("[heap] FAIL: munmap accepted part of a mapping\n");
+		errors++;
+	}
+	if (munmap(m, 3 * PAGE_SIZE) != 0 || munmap(m, 3 * PAGE_SIZE) != -1) {
+		test_failed();
+		printf("[heap] FAIL: munmap of the whole mapping\n");
+		errors++;
+	}
+	if (mmap(NULL, PAGE_SIZE, PROT_READ, MAP_PRIVATE, 3, 0) != MAP_FAILED) {
+		test_failed();
+		printf("[heap] FAIL: file-backed mmap succeeded\n");
+		errors++;
+	}
+	return errors;
+}
+
+static size_t block_size(int i)
+{
+	// 大多是小块，偶尔有需要 mmap 的大块
+	return (i % 97 == 0) ? 5000 + (size_t)i : 1 + (size_t)(i * 37) % 2000;
+}
+
+/*
+ * 大小为 0 的块：最小的块必须放得下空闲链表指针，否则 ufree 把指针写进
+ * 相邻块的头部，那个块之后的 ufree 会因为魔数不对被忽略。连续切出的几个
+ * 0 字节块全部释放后再分配同样多个，应该全部命中缓存。
+ */
+#define ZERO_BLOCKS 8
+
+static int check_zero_size(void)
+{
+	void *z[ZERO_BLOCKS];
+	struct umalloc_stats before, after;
+
+	for (int i = 0; i < ZERO_BLOCKS; i++) {
+		z[i] = (i & 1) ? ucalloc(0, 8) : umalloc(0);
+		if (z[i] == NULL) {
+			test_failed();
+			printf("[heap] FAIL: zero-size allocation returned NULL\n");
+			return 1;
+		}
+		for (int k = 0; k < i; k++) {
+			if (z[k] == z[i]) {
+				test_failed();
+				printf("[heap] FAIL: zero-size allocations share %p\n", z[i]);
+				return 1;
+			}
+		}
+	}
+	for (int i = 0; i < ZERO_BLOCKS; i++) {
+		ufree(z[i]);
+	}
+
+	umalloc_get_stats(&before);
+	for (int i = 0; i < ZERO_BLOCKS; i++) {
+		z[i] = umalloc(0);
+	}
+	umalloc_get_stats(&after);
+	for (int i = 0; i < ZERO_BLOCKS; i++) {
+		ufree(z[i]);
+	}
+
+	if (after.cache_hits - before.cache_hits != ZERO_BLOCKS) {
+		test_failed();
+		printf("[heap] FAIL: only %ld of %d freed zero-size blocks were reused\n",
+		       (long)(after.cache_hits - before.cache_hits), ZERO_BLOCKS);
+		return 1;
+	}
+	return 0;
+}
+
+static int check_umalloc(void)
+{
+	int errors = 0;
+
+	for (int i = 0; i < BATCH; i++) {
+		blocks[i] = umalloc(block_size(i));
+		if (blocks[i] == NULL || ((uintptr_t)blocks[i] & 15)) {
+			test_failed();
+			printf("[heap] FAIL: umalloc(%ld) returned %p\n", (long)block_size(i), blocks[i]);
+			return errors + 1;
+		}
+		memset(blocks[i], i & 0xff, block_size(i));
+	}
+	for (int i = 0; i < BATCH && !errors; i++) {
+		const unsigned char *p = blocks[i];
+		for (size_t k = 0; k < block_size(i); k++) {
+			if (p[k] != (i & 0xff)) {
+				test_failed();
+				printf("[heap] FAIL: block %d overwritten at byte %ld\n", i, (long)k);
+				errors++;
+				break;
+			}
+		}
+	}
+	for (int i = 0; i < BATCH; i++) {
+		ufree(blocks[i]);
+	}
+
+	int *z = ucalloc(100, sizeof(int));
+	for (int i = 0; z && i < 100; i++) {
+		if (z[i] != 0) {
+			test_failed();
+			printf("[heap] FAIL: ucalloc memory not zeroed\n");
+			errors++;
+			break;
+		}
+	}
+	ufree(z);
+	return errors + check_zero_size();
+}
+
+static void report(const char *name, uint64_t ticks, long ops, uint64_t syscalls)
+{
+	printf("[heap] %s: ~%ld ns per op, %ld syscalls, %d pages held, %ld minor faults so far\n",
+	       name, (long)(ticks * NS_PER_TICK / ops), (long)syscalls, (int)me()->mm.pages,
+	       (long)me()->mm.minor_faults);
+}
+
+static void heap_task(void *param)
+{
+	int errors;
+	uint64_t start, calls;
+
+	(void)param;
+	errors = check_syscalls();
+	errors += check_umalloc();
+
+	// 同一 class 反复分配释放：第一次之后都是缓存命中
+	calls = me()->syscalls;
+	start = user_rdtime();
+	for (int i = 0; i < HOT_ROUNDS; i++) {
+		void *p = umalloc(16 + next_rand() % 1000);
+		ufree(p);
+	}
+	uint64_t hot_calls = me()->syscalls - calls;
+	report("umalloc/ufree pairs", user_rdtime() - start, 2 * HOT_ROUNDS, hot_calls);
+
+	calls = me()->syscalls;
+	start = user_rdtime();
+	for (int r = 0; r < BATCH_ROUNDS; r++) {
+		for (int i = 0; i < BATCH; i++) {
+			blocks[i] = umalloc(16 + next_rand() % 2000);
+		}
+		for (int i = 0; i < BATCH; i++) {
+			ufree(blocks[i]);
+		}
+	}
+	report("batches of umalloc then ufree", user_rdtime() - start,
+	       2L * BATCH * BATCH_ROUNDS, me()->syscalls - calls);
+
+	calls = me()->syscalls;
+	start = user_rdtime();
+	for (int i = 0; i < TASK_MAX_MMAPS; i++) {
+		blocks[i] = mmap(NULL, 64, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	}
+	for (int i = 0; i < TASK_MAX_MMAPS; i++) {
+		munmap(blocks[i], 64);
+	}
+	report("mmap/munmap per allocation", user_rdtime() - start,
+	       2 * TASK_MAX_MMAPS, me()->syscalls - calls);
+
+	struct umalloc_stats st;
+	umalloc_get_stats(&st);
+	printf("[heap] umalloc: %ld allocs, %ld cache hits, %ld sbrk, %ld mmap, %ld munmap\n",
+	       (long)st.allocs, (long)st.cache_hits, (long)st.sbrk_calls,
+	       (long)st.mmap_calls, (long)st.munmap_calls);
+
+	// 热路径上只允许最开始的一次 sbrk
+	if (hot_calls > 1) {
+		test_failed();
+		printf("[heap] FAIL: %ld syscalls on the cached path\n", (long)hot_calls);
+		errors++;
+	}
+	if (errors == 0) {
+		printf("[heap] PASS: sbrk/mmap semantics and umalloc\n");
+	}
+	test_task_done();
+	exit(0);
+}
+
+void test_heap(void)
+{
+	printk("--- Starting User Heap Test (runs under the scheduler) ---\n");
+	if (task_create(heap_task, NULL, 5, DEFAULT_TIMESLICE) >= 0) {
+		test_task_begin();
+	}
+}
@@ -0,0 +1,262 @@
+#include "kernel.h"
+#include "kernel/hart.h"
+#include "kernel/smp.h"
+#include "arch/sbi.h"
+#include "uapi/printf.h"
+#include "syscalls.h"
+#include "test.h"
+
+/*
+ * hart 热插拔测试（任务在调度器启动后于用户态运行）
+ *
+ * 控制任务绑定在启动 hart 上，选一个普通从核（没有别的测试任务只绑定在
+ * 它上面）反复下线、上线：
+ *   - 每一步之后 hart_get_status() 报告的状态应该跟着变；
+ *   - 几个默认亲和性的 worker 一直在计数，每一步之后都要有进展，
+ *     下线期间不能有 worker 运行在那个 hart 上，sched_getcpu() 也不能
+ *     报告那个 hart；
+ *   - 另有一个 worker 只绑定在那个 hart 上，第一次下线时它的亲和性被
+ *     重置，之后照样在别的 hart 上运行。
+ *
+ * 用户态只通过系统调用了解任务和 hart：worker 的任务号在创建时记下，
+ * 可选的 hart（在线的普通从核）由内核态的 test_hotplug() 算好。
+ */
+
+#define HOTPLUG_CYCLES 5
+#define HOTPLUG_WORKERS 3
+#define HOTPLUG_PID_SCAN 64	// 查找别的测试绑定的任务时扫描的任务号范围
+
+static volatile long target_hart = -1;
+static unsigned long target_candidates;
+static int self_id;
+static int worker_ids[HOTPLUG_WORKERS + 1];	// 最后一个是绑定在目标 hart 上的 worker
+#define pinned_id (worker_ids[HOTPLUG_WORKERS])
+static volatile int target_offline;
+static volatile int stop_workers;
+static volatile uint64_t progress[HOTPLUG_WORKERS + 1];
+static volatile int ran_offline;
+static volatile int workers_done;
+
+static void hotplug_worker_task(void *param)
+{
+	long idx = (long)param;
+
+	while (!stop_workers) {
+		int before = target_offline;
+		long hart = hart_current_id();
+		// 系统调用前后都处在下线期间，才能说明它在下线的 hart 上运行过
+		if (before && target_offline && hart == target_hart) {
+			ran_offline++;
+		}
+		progress[idx]++;
+		if ((progress[idx] & 63) == 0) {
+			yield();
+		}
+	}
+	__atomic_fetch_add(&workers_done, 1, __ATOMIC_RELEASE);
+	exit(0);
+}
+
+/* 所有 worker 都有进展（其间控制任务不断让出 CPU） */
+static int workers_progressing(void)
+{
+	uint64_t seen[HOTPLUG_WORKERS + 1];
+
+	for (int i = 0; i <= HOTPLUG_WORKERS; i++) {
+		seen[i] = progress[i];
+	}
+	for (int round = 0; round < 100000; round++) {
+		int all = 1;
+		for (int i = 0; i <= HOTPLUG_WORKERS; i++) {
+			if (progress[i] == seen[i]) {
+				all = 0;
+			}
+		}
+		if (all) {
+			return 1;
+		}
+		yield();
+	}
+	return 0;
+}
+
+static int hart_is_online(long hart)
+{
+	return hart_get_status(hart) == SBI_HSM_STATE_STARTED;
+}
+
+static int is_own_task(int pid)
+{
+	if (pid == self_id) {
+		return 1;
+	}
+	for (int i = 0; i <= HOTPLUG_WORKERS; i++) {
+		if (pid == worker_ids[i]) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* 在线，也没有别的测试的任务只能在上面运行 */
+static long pick_target(void)
+{
+	unsigned long online = 0;
+
+	for (long h = 0; h < hart_count(); h++) {
+		if (hart_is_online(h)) {
+			online |= 1UL << h;
+		}
+	}
+	unsigned long candidates = target_candidates & online;
+	for (int pid = 0; pid < HOTPLUG_PID_SCAN && candidates; pid++) {
+		unsigned long allowed;
+		if (is_own_task(pid) || sched_getaffinity(pid, sizeof(allowed), &allowed) < 0) {
+			continue;
+		}
+		allowed &= online;
+		if ((allowed & (allowed - 1)) == 0) {
+			candidates &= ~allowed;
+		}
+	}
+	return candidates ? __builtin_ctzl(candidates) : -1;
+}
+
+/* 刚有过进展的 worker 都已经在别的 hart 上运行过 */
+static int workers_placed_off(long hart)
+{
+	for (int i = 0; i <= HOTPLUG_WORKERS; i++) {
+		if (sched_getcpu(worker_ids[i]) == hart) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void hotplug_control_task(void *param)
+{
+	(void)param;
+	int failed = 0;
+	long hart = -1;
+
+	// 别的测试可能还有任务只绑定在某个从核上，等它们结束或者换一个
+	for (int round = 0; round < 100000 && hart < 0; round++) {
+		hart = pick_target();
+		if (hart < 0) {
+			yield();
+		}
+	}
+	if (hart < 0) {
+		printf("[hotplug] skipped: no secondary hart free to take offline\n");
+		stop_workers = 1;
+		test_task_done();
+		exit(0);
+	}
+	target_hart = hart;
+	unsigned long mask = 1UL << hart;
+	if (sched_setaffinity(pinned_id, sizeof(mask), &mask) < 0) {
+		test_failed();
+		printf("[hotplug] FAIL: cannot pin a worker to hart %ld\n", hart);
+		failed = 1;
+	}
+
+	// 等 worker 都跑起来，绑定的那个也已经在目标 hart 上
+	if (!workers_progressing()) {
+		test_failed();
+		printf("[hotplug] FAIL: workers did not start\n");
+		failed = 1;
+	}
+
+	for (int i = 0; i < HOTPLUG_CYCLES && !failed; i++) {
+		if (hart_offline(hart) < 0) {
+			test_failed();
+			printf("[hotplug] FAIL: hart_offline(%ld) failed in cycle %d\n", hart, i);
+			failed = 1;
+			break;
+		}
+		target_offline = 1;
+		if (hart_is_online(hart)) {
+			test_failed();
+			printf("[hotplug] FAIL: hart %ld still online after hart_offline()\n", hart);
+			failed = 1;
+		}
+		if (hart_offline(hart) == 0) {
+			test_failed();
+			printf("[hotplug] FAIL: an offline hart went offline again\n");
+			failed = 1;
+		}
+		if (!workers_progressing()) {
+			test_failed();
+			printf("[hotplug] FAIL: workers stalled with hart %ld offline\n", hart);
+			failed = 1;
+		} else if (!workers_placed_off(hart)) {
+			test_failed();
+			printf("[hotplug] FAIL: sched_getcpu() places a worker on offline hart %ld\n", hart);
+			failed = 1;
+		}
+		if (i == 0 && (sched_getaffinity(pinned_id, sizeof(mask), &mask) < 0 || mask == 1UL << hart)) {
+			test_failed();
+			printf("[hotplug] FAIL: the worker pinned to hart %ld kept its affinity\n", hart);
+			failed = 1;
+		}
+
+		target_offline = 0;
+		if (hart_online(hart) < 0) {
+			test_failed();
+			printf("[hotplug] FAIL: hart_online(%ld) failed in cycle %d\n", hart, i);
+			failed = 1;
+			break;
+		}
+		if (!hart_is_online(hart)) {
+			test_failed();
+			printf("[hotplug] FAIL: hart %ld not online after hart_online()\n", hart);
+			failed = 1;
+		}
+		if (!workers_progressing()) {
+			test_failed();
+			printf("[hotplug] FAIL: workers stalled after hart %ld came back\n", hart);
+			failed = 1;
+		}
+	}
+
+	stop_workers = 1;
+	while (__atomic_load_n(&workers_done, __ATOMIC_ACQUIRE) < HOTPLUG_WORKERS + 1) {
+		yield();
+	}
+	if (ran_offline) {
+		test_failed();
+		printf("[hotplug] FAIL: workers ran on offline hart %ld %d times\n", hart, ran_offline);
+		failed = 1;
+	}
+	if (!failed) {
+		printf("[hotplug] PASS: hart %ld went offline and online %d times, workers kept running\n",
+		       hart, HOTPLUG_CYCLES);
+	}
+	test_task_done();
+	exit(0);
+}
+
+void test_hotplug(void)
+{
+	unsigned long candidates = smp_online_mask() & ~hart_isolated_mask() & ~(1UL << this_hart());
+
+	printk("--- Starting Hart Hotplug Test (runs under the scheduler) ---\n");
+	if (candidates == 0) {
+		printk("hotplug: needs a normal secondary hart online, skipped\n");
+		return;
+	}
+	target_candidates = candidates;
+
+	// 控制任务选好目标后把最后一个 worker 绑到目标 hart 上，下线时它的亲和性会被重置
+	for (long i = 0; i <= HOTPLUG_WORKERS; i++) {
+		worker_ids[i] = task_create(hotplug_worker_task, (void *)i, 3, DEFAULT_TIMESLICE);
+	}
+	self_id = task_create(hotplug_control_task, NULL, 3, DEFAULT_TIMESLICE);
+	if (self_id >= 0) {
+		test_task_begin();
+	}
+	if (pinned_id < 0 || self_id < 0 || task_set_affinity(self_id, 1UL << this_hart()) < 0) {
+		test_failed();
+		printk("✗ FAIL: cannot create the hotplug tasks\n");
+	}
+}
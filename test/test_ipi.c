@@ -0,0 +1,143 @@
+#include "kernel.h"
+#include "kernel/hart.h"
+#include "kernel/smp.h"
+#include "test.h"
+
+/*
+ * 跨 hart 调用测试（启动 hart 上同步运行，需要从核已经启动）
+ *
+ * test_user_multicore_start() 启动 hart 2、3，它们的陷阱入口就绪后就会
+ * 出现在在线掩码里，然后等着启动 hart 放开内核锁。这里检查：
+ *   - 同步调用在每个目标 hart 上各执行一次，并且确实在那个 hart 上执行；
+ *   - 一串异步调用按顺序全部执行，队列非空时不再重复发 IPI；
+ * 并测量一对多同步调用的往返延迟。
+ */
+
+#define IPI_ROUNDS 1000
+#define ASYNC_BURST 64
+
+static volatile int ran_on[MAXNUM_CPU];
+static volatile int async_count[MAXNUM_CPU];
+static volatile int async_order_errors;
+
+static void record_hart(void *arg)
+{
+	(void)arg;
+	ran_on[this_hart()]++;
+}
+
+static void nop_call(void *arg)
+{
+	(void)arg;
+}
+
+static void count_in_order(void *arg)
+{
+	int h = this_hart();
+
+	if ((long)arg != async_count[h]) {
+		async_order_errors++;
+	}
+	async_count[h]++;
+}
+
+/* 等从核完成 trap_init() */
+static unsigned long wait_for_secondaries(void)
+{
+	unsigned long others = ~(1UL << this_hart());
+
+	for (int i = 0; i < 1000000; i++) {
+		unsigned long mask = smp_online_mask() & others;
+		if ((mask & (1UL << 2)) && (mask & (1UL << 3))) {
+			return mask;
+		}
+	}
+	return smp_online_mask() & others;
+}
+
+void test_ipi(void)
+{
+	int errors = 0;
+
+	printk("\n--- Running Cross-hart Call (IPI) Test ---\n");
+
+	unsigned long others = wait_for_secondaries();
+	int ntargets = 0;
+	int first = -1;
+	for (int h = 0; h < MAXNUM_CPU; h++) {
+		if (others & (1UL << h)) {
+			ntargets++;
+			if (first < 0) {
+				first = h;
+			}
+		}
+	}
+	if (ntargets == 0) {
+		test_failed();
+		printk("✗ FAIL: no other hart came online\n");
+		return;
+	}
+
+	if (smp_call_function(others, record_hart, NULL, 1) != ntargets) {
+		errors++;
+	}
+	for (int h = 0; h < MAXNUM_CPU; h++) {
+		int expected = (others & (1UL << h)) ? 1 : 0;
+		if (ran_on[h] != expected) {
+			errors++;
+		}
+	}
+	if (errors) {
+		test_failed();
+		printk("✗ FAIL: synchronous call did not run exactly once on each target hart\n");
+	} else {
+		printk("✓ PASS: synchronous call ran once on each of %d harts\n", ntargets);
+	}
+
+	// 一对多往返：发出调用到所有目标执行完为止
+	uint64_t start = get_time();
+	for (int i = 0; i < IPI_ROUNDS; i++) {
+		smp_call_function(others, nop_call, NULL, 1);
+	}
+	uint64_t all_ticks = get_time() - start;
+
+	start = get_time();
+	for (int i = 0; i < IPI_ROUNDS; i++) {
+		smp_call_function(1UL << first, nop_call, NULL, 1);
+	}
+	uint64_t one_ticks = get_time() - start;
+
+	printk("IPI round trip: ~%ld ns to 1 hart, ~%ld ns to all %d other harts\n",
+	       (long)(one_ticks * NS_PER_TICK / IPI_ROUNDS),
+	       (long)(all_ticks * NS_PER_TICK / IPI_ROUNDS), ntargets);
+
+	// 异步调用：目标还在处理时排进去的调用不再单独发 IPI
+	struct smp_stats before, after;
+	smp_get_stats(&before);
+	for (long i = 0; i < ASYNC_BURST; i++) {
+		smp_call_function(others, count_in_order, (void *)i, 0);
+	}
+	// 同一个队列按入队顺序执行，这次同步调用返回时前面的都已执行完
+	smp_call_function(others, nop_call, NULL, 1);
+	smp_get_stats(&after);
+
+	int missing = 0;
+	for (int h = 0; h < MAXNUM_CPU; h++) {
+		if ((others & (1UL << h)) && async_count[h] != ASYNC_BURST) {
+			missing++;
+		}
+	}
+	long calls = (long)(after.calls - before.calls);
+	long ipis = (long)(after.ipis - before.ipis);
+	printk("async burst: %ld calls delivered with %ld IPIs\n", calls, ipis);
+	if (missing || async_order_errors) {
+		test_failed();
+		printk("✗ FAIL: async calls lost or run out of order (%d harts short, %d out of order)\n",
+		       missing, async_order_errors);
+	} else if (ipis > calls) {
+		test_failed();
+		printk("✗ FAIL: more IPIs than calls\n");
+	} else {
+		printk("✓ PASS: async calls run in order on every target\n");
+	}
+}
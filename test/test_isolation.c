@@ -0,0 +1,111 @@
+#include "kernel.h"
+#include "kernel/hart.h"
+#include "kernel/smp.h"
+#include "uapi/printf.h"
+#include "syscalls.h"
+#include "test.h"
+
+/*
+ * 隔离 hart 的抖动测试（任务在调度器启动后于用户态运行）
+ *
+ * 需要用启动参数隔离一个从核（make rt 传入 isolcpus=3）。两个任务分别
+ * 绑定在被隔离的 hart 和一个普通从核上，同时在紧凑循环里连续读 rdtime，
+ * 记录相邻两次读数的最大间隔和超过 JITTER_SPIKE_NS 的次数。普通 hart
+ * 每个时钟节拍都会收到重新调度的 IPI，被隔离的 hart 不会。
+ *
+ * 采样持续两个半调度节拍，保证普通 hart 至少经历两次节拍。
+ */
+
+#define JITTER_DURATION (TIMER_INTERVAL * 5 / 2)
+#define JITTER_SPIKE_NS 10000
+
+struct jitter_result {
+	long hart;
+	uint64_t samples;
+	uint64_t max_gap;
+	uint64_t spikes;
+	int moved;
+};
+
+static struct jitter_result results[2];
+static volatile int jitter_done;
+
+static void jitter_task(void *param)
+{
+	struct jitter_result *r = param;
+	uint64_t spike = JITTER_SPIKE_NS / NS_PER_TICK;
+	uint64_t start = user_rdtime();
+	uint64_t prev = start;
+	uint64_t max_gap = 0, spikes = 0, samples = 0;
+
+	while (prev - start < JITTER_DURATION) {
+		uint64_t now = user_rdtime();
+		uint64_t gap = now - prev;
+		if (gap > max_gap) {
+			max_gap = gap;
+		}
+		if (gap > spike) {
+			spikes++;
+		}
+		prev = now;
+		samples++;
+	}
+
+	r->samples = samples;
+	r->max_gap = max_gap;
+	r->spikes = spikes;
+	r->moved = hart_current_id() != r->hart;
+	__atomic_fetch_add(&jitter_done, 1, __ATOMIC_RELEASE);
+	exit(0);
+}
+
+static void jitter_report_task(void *param)
+{
+	(void)param;
+	int failed = 0;
+
+	while (__atomic_load_n(&jitter_done, __ATOMIC_ACQUIRE) < 2) {
+		yield();
+	}
+	for (int i = 0; i < 2; i++) {
+		struct jitter_result *r = &results[i];
+		printf("[isolation] %s hart %ld: %ld samples, max gap %ld ns, %ld gaps over %d ns\n",
+		       i == 0 ? "isolated" : "normal  ", r->hart, (long)r->samples,
+		       (long)(r->max_gap * NS_PER_TICK), (long)r->spikes, JITTER_SPIKE_NS);
+		if (r->moved) {
+			test_failed();
+			printf("[isolation] FAIL: sampler left hart %ld\n", r->hart);
+			failed = 1;
+		}
+	}
+	if (!failed) {
+		printf("[isolation] PASS: samplers ran on their harts (compare the gaps above)\n");
+	}
+	test_task_done();
+	exit(0);
+}
+
+void test_isolation(void)
+{
+	unsigned long isolated = hart_isolated_mask() & smp_online_mask();
+	unsigned long normal = smp_online_mask() & ~isolated & ~(1UL << this_hart());
+
+	printk("--- Starting Isolated Hart Jitter Test (runs under the scheduler) ---\n");
+	if (isolated == 0 || normal == 0) {
+		printk("isolation: needs an isolated and a normal secondary hart online "
+		       "(boot with isolcpus=3), skipped\n");
+		return;
+	}
+	results[0].hart = __builtin_ctzl(isolated);
+	results[1].hart = __builtin_ctzl(normal);
+
+	for (int i = 0; i < 2; i++) {
+		int id = task_create(jitter_task, &results[i], 3, DEFAULT_TIMESLICE);
+		if (id >= 0) {
+			task_set_affinity(id, 1UL << results[i].hart);
+		}
+	}
+	if (task_create(jitter_report_task, NULL, 3, DEFAULT_TIMESLICE) >= 0) {
+		test_task_begin();
+	}
+}
@@ -1,23 +1,32 @@
 #include "kernel.h"
 #include "kernel/hart.h"
+#include "kernel/smp.h"
 #include "kernel/printk.h"
 #include "arch/sbi.h"
 #include "uapi/printf.h" // 假设用户态的 printf 在这里声明
+#include "test.h"
 
 // 声明从汇编启动的函数
 extern void _secondary_start(void);
 
 /**
- * @brief 将在用户态运行的任务函数
- * @param hartid 这个参数由 _secondary_start 通过 a0 寄存器传入
+ * @brief 绑定在某个 hart 上运行的用户态任务
+ * @param param 任务绑定的 hart ID
  */
-void user_task_test(long hartid)
+void user_task_test(void *param)
 {
+    long hartid = (long)param;
+
     // 无限循环打印
     while (1)
     {
-        // 直接调用用户态的 printf 函数
-        printf("Hart %ld is running in User Mode!\n", hartid);
+        long running_on = hart_current_id();
+        if (running_on == hartid) {
+            printf("Hart %ld is running in User Mode!\n", hartid);
+        } else {
+            test_failed();
+            printf("[multicore] FAIL: task pinned to hart %ld ran on hart %ld\n", hartid, running_on);
+        }
 
         // 加入一个简单的、与hartid相关的延迟，让输出不那么整齐
         for (volatile int i = 0; i < 200000 * (hartid + 1) + 600000; i++)
@@ -27,6 +36,8 @@ void user_task_test(long hartid)
 
 /**
  * @brief 内核态的主测试函数 (由 hart 1 执行)
+ * @details 启动 hart 2 和 3 进入调度器，再给每个 hart 创建一个绑定在它上面的
+ *          低优先级用户任务。
  */
 void test_user_multicore_start(void)
 {
@@ -38,24 +49,23 @@ void test_user_multicore_start(void)
             asm volatile("wfi");
     }
 
-    printk("Kernel: Boot hart (ID: %ld) is starting harts 2 and 3 in User Mode...\n", boot_hart_id);
+    printk("Kernel: Boot hart (ID: %ld) is starting harts 2 and 3...\n", boot_hart_id);
 
-    // 初始化所有核心的 Per-CPU 数据
-    for (int i = 0; i < MAXNUM_CPU; i++)
+    // 启动 hart 2 和 3，第三个参数(opaque)是它们的内核入口
+    for (long hart = 2; hart <= 3; hart++)
     {
-        cpu_data_area[i].hart_id = i;
+        hart_start(hart, (unsigned long)_secondary_start, (unsigned long)secondary_start_kernel);
+        // 亲和性只接受在线的 hart：等它的 trap_init() 完成
+        for (int i = 0; i < 1000000 && !(smp_online_mask() & (1UL << hart)); i++)
+            ;
+        int id = task_create(user_task_test, (void *)hart, 30, DEFAULT_TIMESLICE);
+        if (id >= 0)
+        {
+            task_set_affinity(id, 1UL << hart);
+        }
     }
 
-    // 启动 hart 2 和 3
-    // 第三个参数(opaque)我们将要执行的用户态函数 user_task 的地址传过去
-    hart_start(2, (unsigned long)_secondary_start, (unsigned long)user_task_test);
-    hart_start(3, (unsigned long)_secondary_start, (unsigned long)user_task_test);
-
-    printk("Kernel: Hart %ld has requested harts 2 and 3 to start. Now entering WFI.\n", boot_hart_id);
+    printk("Kernel: Hart %ld has requested harts 2 and 3 to start.\n", boot_hart_id);
 
-    // 主核心完成任务，进入低功耗等待状态
-    while (1)
-    {
-        asm volatile("wfi");
-    }
+    // 主核心返回，继续运行调度器和其它测试任务
 }
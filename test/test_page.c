@@ -1,5 +1,109 @@
 #include "kernel/mm.h"
 #include "kernel/printk.h"
+#include "kernel/timer.h"
+#include "string.h"
+#include "test.h"
+
+#define POOL_TEST_PAGES 16
+
+static int page_is_zero(const void *p)
+{
+    static const char zero[PAGE_SIZE];
+    return memcmp(p, zero, PAGE_SIZE) == 0;
+}
+
+/* 分配 n 个单页，任何一次失败就还掉已拿到的页并返回 -1 */
+static int alloc_pages(void **pages, int n, int flags)
+{
+    for (int i = 0; i < n; i++) {
+        pages[i] = page_alloc_flags(1, flags);
+        if (pages[i] == NULL) {
+            while (--i >= 0) {
+                page_free(pages[i]);
+            }
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void free_pages(void **pages, int n)
+{
+    for (int i = 0; i < n; i++) {
+        page_free(pages[i]);
+    }
+}
+
+/*
+ * 预清零页池：比较从池中取清零页和 page_alloc + 当场清零的延迟。
+ * 这里还没有空闲循环，先手动把池子补满。
+ */
+static void test_zero_pool(void)
+{
+    void *pages[POOL_TEST_PAGES];
+    struct page_pool_stats before, after;
+    int errors = 0;
+
+    printk("\n--- Running Pre-zeroed Page Pool Test ---\n");
+
+    // 先弄脏一批页再还回去，确认拿到的页确实被清零过
+    if (alloc_pages(pages, POOL_TEST_PAGES, 0) < 0) {
+        test_failed();
+        printk("✗ FAIL: page_alloc(1) returned NULL\n");
+        return;
+    }
+    for (int i = 0; i < POOL_TEST_PAGES; i++) {
+        memset(pages[i], 0xa5, PAGE_SIZE);
+    }
+    free_pages(pages, POOL_TEST_PAGES);
+    while (page_pool_refill())
+        ;
+
+    page_pool_get_stats(&before);
+    uint64_t start = get_time();
+    if (alloc_pages(pages, POOL_TEST_PAGES, PAGE_ZERO) < 0) {
+        test_failed();
+        printk("✗ FAIL: page_alloc_flags(1, PAGE_ZERO) returned NULL\n");
+        return;
+    }
+    uint64_t pool_ticks = get_time() - start;
+    page_pool_get_stats(&after);
+
+    for (int i = 0; i < POOL_TEST_PAGES; i++) {
+        if (!page_is_zero(pages[i])) {
+            errors++;
+        }
+    }
+    free_pages(pages, POOL_TEST_PAGES);
+
+    // 没有页池时的做法：分配后当场清零
+    start = get_time();
+    if (alloc_pages(pages, POOL_TEST_PAGES, 0) < 0) {
+        test_failed();
+        printk("✗ FAIL: page_alloc(1) returned NULL\n");
+        return;
+    }
+    for (int i = 0; i < POOL_TEST_PAGES; i++) {
+        kmemset(pages[i], 0, PAGE_SIZE);
+    }
+    uint64_t sync_ticks = get_time() - start;
+    free_pages(pages, POOL_TEST_PAGES);
+
+    printk("page_alloc + zero: ~%ld ns per page from the pool, ~%ld ns zeroing synchronously\n",
+           (long)(pool_ticks * NS_PER_TICK / POOL_TEST_PAGES),
+           (long)(sync_ticks * NS_PER_TICK / POOL_TEST_PAGES));
+
+    if (after.pool_hits - before.pool_hits != POOL_TEST_PAGES) {
+        test_failed();
+        printk("✗ FAIL: only %ld of %d zeroed allocations came from the pool\n",
+               (long)(after.pool_hits - before.pool_hits), POOL_TEST_PAGES);
+    } else if (errors) {
+        test_failed();
+        printk("✗ FAIL: %d pages from the pool were not zero\n", errors);
+    } else {
+        printk("✓ PASS: PAGE_ZERO allocations come pre-zeroed from the pool\n");
+    }
+}
 
 void test_page(void)
 {
@@ -32,6 +136,7 @@ void test_page(void)
     if (p_zero == NULL) {
         printk("✓ PASS: page_alloc(0) correctly returned NULL\n");
     } else {
+        test_failed();
         printk("✗ FAIL: page_alloc(0) should return NULL but returned %p\n", p_zero);
     }
     
@@ -44,6 +149,7 @@ void test_page(void)
         page_free(p_max);
         printk("✓ PASS: Successfully freed maximum allocation\n");
     } else {
+        test_failed();
         printk("✗ FAIL: Could not allocate maximum pages\n");
     }
     
@@ -53,6 +159,7 @@ void test_page(void)
     if (p_over == NULL) {
         printk("✓ PASS: page_alloc(%d) correctly returned NULL (insufficient memory)\n", max_pages + 1);
     } else {
+        test_failed();
         printk("✗ FAIL: page_alloc(%d) should fail but returned %p\n", max_pages + 1, p_over);
         page_free(p_over);
     }
@@ -130,6 +237,7 @@ void test_page(void)
             if (addr % PAGE_SIZE == 0) {
                 printk("✓ PASS: %d pages allocated at properly aligned address %p\n", i, p_align);
             } else {
+                test_failed();
                 printk("✗ FAIL: %d pages allocated at misaligned address %p\n", i, p_align);
             }
             page_free(p_align);
@@ -155,6 +263,7 @@ void test_page(void)
             
             page_free(large_alloc);
         } else {
+            test_failed();
             printk("✗ FAIL: Large allocation of %d pages failed\n", large_size);
         }
     }
@@ -202,5 +311,7 @@ void test_page(void)
     printk("✓ PASS: Completed 5 stress cycles\n");
     
     printk("--- EXTREME Page Allocator Tests Completed ---\n");
+
+    test_zero_pool();
 }
 
@@ -0,0 +1,113 @@
+#include "kernel.h"
+#include "kernel/vm.h"
+#include "string.h"
+#include "uapi/printf.h"
+#include "uapi/mman.h"
+#include "syscalls.h"
+#include "test.h"
+
+/*
+ * 按需分页测试（任务在调度器启动后于用户态运行）
+ *
+ * 任务映射一块 BUF_SIZE 的缓冲区，只访问其中 TOUCH_PAGES 页，分别用
+ *   - 默认的按需分页：mmap 只记录范围，第一次访问时缺页、分配并清零；
+ *   - MAP_POPULATE：mmap 当场分配并清零全部页面（原来的做法）；
+ * 打印 "映射 + 访问" 的耗时、缺页次数和实际占用的物理页数。
+ * 同时检查新页面是零、写入的数据保留、munmap 后页面全部归还。
+ */
+
+#define BUF_SIZE (8UL << 20)
+#define TOUCH_PAGES 16
+
+/* 用户态的 tp 是 TLS，不能用 current_task_id，用 getpid() 找到自己 */
+static struct task_mm *my_mm(void)
+{
+	return &tasks[getpid()].mm;
+}
+
+/* 映射、访问、检查、解除映射，返回错误数 */
+static int run_case(const char *name, int extra_flags)
+{
+	int errors = 0;
+	uint32_t pages_before = my_mm()->pages;
+	uint64_t faults_before = my_mm()->minor_faults;
+
+	uint64_t start = user_rdtime();
+	char *buf = mmap(NULL, BUF_SIZE, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
+	if (buf == MAP_FAILED) {
+		test_failed();
+		printf("[paging] FAIL: %s mmap of %ld bytes\n", name, (long)BUF_SIZE);
+		return 1;
+	}
+	// 分散地访问 TOUCH_PAGES 页
+	for (int i = 0; i < TOUCH_PAGES; i++) {
+		char *p = buf + (BUF_SIZE / TOUCH_PAGES) * i + 8;
+		if (*p != 0) {
+			errors++;
+		}
+		*p = (char)(i + 1);
+	}
+	uint64_t ticks = user_rdtime() - start;
+
+	uint32_t resident = my_mm()->pages - pages_before;
+	uint64_t faults = my_mm()->minor_faults - faults_before;
+	printf("[paging] %s: map + touch %d of %ld pages ~%ld us, %ld minor faults, %d pages resident\n",
+	       name, TOUCH_PAGES, (long)(BUF_SIZE / PAGE_SIZE),
+	       (long)(ticks * NS_PER_TICK / 1000), (long)faults, (int)resident);
+
+	for (int i = 0; i < TOUCH_PAGES; i++) {
+		if (buf[(BUF_SIZE / TOUCH_PAGES) * i + 8] != (char)(i + 1)) {
+			errors++;
+		}
+	}
+	if (errors) {
+		test_failed();
+		printf("[paging] FAIL: %s pages not zero-filled or lost writes\n", name);
+	}
+	if (!(extra_flags & MAP_POPULATE) && (faults != TOUCH_PAGES || resident != TOUCH_PAGES)) {
+		test_failed();
+		printf("[paging] FAIL: %s expected one fault and one page per touched page\n", name);
+		errors++;
+	}
+	if (munmap(buf, BUF_SIZE) != 0 || my_mm()->pages != pages_before) {
+		test_failed();
+		printf("[paging] FAIL: %s munmap did not return every page\n", name);
+		errors++;
+	}
+	return errors;
+}
+
+static void paging_task(void *param)
+{
+	int errors = 0;
+
+	(void)param;
+	errors += run_case("on demand", 0);
+	errors += run_case("MAP_POPULATE", MAP_POPULATE);
+
+	// 内核通过 copy_from_user() 读取窗口里的缓冲区
+	const char *text = "[paging] write() from a demand-paged buffer\n";
+	size_t len = strlen(text);
+	char *msg = sbrk(PAGE_SIZE);
+	memcpy(msg, text, len);
+	if (write(1, msg, len) != (long)len) {
+		test_failed();
+		printf("[paging] FAIL: write() from the heap window\n");
+		errors++;
+	}
+
+	if (errors == 0) {
+		printf("[paging] PASS: demand paging and lazy zero-fill\n");
+	}
+	test_task_done();
+	exit(0);
+}
+
+void test_paging(void)
+{
+	printk("--- Starting Demand Paging Test (runs under the scheduler) ---\n");
+	if (task_create(paging_task, NULL, 5, DEFAULT_TIMESLICE) >= 0) {
+		test_task_begin();
+	}
+}
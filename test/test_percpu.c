@@ -0,0 +1,88 @@
+#include "kernel.h"
+#include "arch/sbi.h"
+#include "kernel/hart.h"
+#include "kernel/smp.h"
+#include "test.h"
+
+/*
+ * per-CPU 数据测试（启动 hart 上同步运行，需要从核已经启动）
+ *
+ *   - 每个 hart 的 tp 都指向 cpu_data_area[] 中自己的那一项，其中的
+ *     hart_id 和 SBI 传入的一致；
+ *   - 各项互不重叠，并且都从缓存行边界开始；DEFINE_PER_CPU 的变量也是；
+ *   - this_cpu_inc() 只改本 hart 的计数。
+ */
+
+static volatile struct per_cpu_data *seen_cpu[MAXNUM_CPU];
+static volatile long seen_id[MAXNUM_CPU];
+static DEFINE_PER_CPU(uint64_t, test_counter);
+
+static void record_cpu(void *arg)
+{
+	(void)arg;
+	int h = this_hart();
+
+	seen_cpu[h] = get_cpu_data();
+	seen_id[h] = sbi_get_hartid();
+	this_cpu_var(test_counter)++;
+}
+
+void test_percpu(void)
+{
+	int errors = 0;
+	int self = this_hart();
+
+	printk("\n--- Running Per-CPU Data Test ---\n");
+
+	if (get_cpu_data() != &cpu_data_area[self] || this_cpu_read(hart_id) != sbi_get_hartid()) {
+		test_failed();
+		printk("✗ FAIL: tp does not point to this hart's per-CPU data\n");
+		errors++;
+	}
+	if (this_cpu_read(irq_depth) != 0) {
+		test_failed();
+		printk("✗ FAIL: irq_depth is %d outside a trap\n", this_cpu_read(irq_depth));
+		errors++;
+	}
+	for (int h = 0; h < MAXNUM_CPU; h++) {
+		if ((uintptr_t)&cpu_data_area[h] % CACHE_LINE_SIZE != 0 ||
+		    (uintptr_t)&per_cpu_var(test_counter, h) % CACHE_LINE_SIZE != 0) {
+			test_failed();
+			printk("✗ FAIL: per-CPU data of hart %d is not cache-line aligned\n", h);
+			errors++;
+		}
+	}
+
+	unsigned long others = smp_online_mask() & ~(1UL << self);
+	record_cpu(NULL);
+	smp_call_function(others, record_cpu, NULL, 1);
+	int nharts = 0;
+	for (int h = 0; h < MAXNUM_CPU; h++) {
+		if (!((others | (1UL << self)) & (1UL << h))) {
+			if (per_cpu_var(test_counter, h) != 0) {
+				test_failed();
+				printk("✗ FAIL: counter of idle hart %d changed\n", h);
+				errors++;
+			}
+			continue;
+		}
+		nharts++;
+		if (seen_cpu[h] != &cpu_data_area[h] || seen_id[h] != h || per_cpu(h, hart_id) != h) {
+			test_failed();
+			printk("✗ FAIL: hart %d sees per-CPU data %p with hart_id %ld\n",
+			       h, (void *)seen_cpu[h], seen_id[h]);
+			errors++;
+		}
+		if (per_cpu_var(test_counter, h) != 1) {
+			test_failed();
+			printk("✗ FAIL: counter of hart %d is %ld, expected 1\n",
+			       h, (long)per_cpu_var(test_counter, h));
+			errors++;
+		}
+	}
+
+	if (!errors) {
+		printk("✓ PASS: %d harts use their own %d-byte per-CPU area through tp\n",
+		       nharts, (int)sizeof(struct per_cpu_data));
+	}
+}
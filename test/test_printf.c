@@ -0,0 +1,222 @@
+#include "kernel.h"
+#include "string.h"
+#include "vsprintf.h"
+#include "test.h"
+
+/*
+ * 格式化引擎测试
+ *
+ * 1. 正确性：用一组格式串检查 vsnprintf() 的输出和返回值，包括宽度、精度、
+ *    补零、左对齐、长度修饰符和截断；
+ * 2. 性能：混合 %d/%x/%s/%p 的格式串，比较新的引擎和原来 printk 中
+ *    逐字符检查边界、按位做除法的实现（下面的 ref_vsnprintf）。
+ */
+
+#define FMT_BENCH_ROUNDS 5000
+
+static int ref_vsnprintf(char * out, size_t n, const char* s, va_list vl)
+{
+	int format = 0;
+	int longarg = 0;
+	size_t pos = 0;
+	for (; *s; s++) {
+		if (format) {
+			switch(*s) {
+			case 'l': {
+				longarg = 1;
+				break;
+			}
+			case 'p': {
+				longarg = 1;
+				if (out && pos < n) {
+					out[pos] = '0';
+				}
+				pos++;
+				if (out && pos < n) {
+					out[pos] = 'x';
+				}
+				pos++;
+				__attribute__((fallthrough));
+			}
+			case 'x': {
+				long num = longarg ? va_arg(vl, long) : va_arg(vl, int);
+				int hexdigits = 2*(longarg ? sizeof(long) : sizeof(int))-1;
+				for(int i = hexdigits; i >= 0; i--) {
+					int d = (num >> (4*i)) & 0xF;
+					if (out && pos < n) {
+						out[pos] = (d < 10 ? '0'+d : 'a'+d-10);
+					}
+					pos++;
+				}
+				longarg = 0;
+				format = 0;
+				break;
+			}
+			case 'u':
+			case 'd': {
+				unsigned long num_to_print;
+
+				if (*s == 'd') {
+					long num = longarg ? va_arg(vl, long) : va_arg(vl, int);
+					if (num < 0) {
+						num_to_print = -num;
+						if (out && pos < n) {
+							out[pos] = '-';
+						}
+						pos++;
+					} else {
+						num_to_print = num;
+					}
+				} else {
+					num_to_print = longarg ? va_arg(vl, unsigned long) : va_arg(vl, unsigned int);
+				}
+
+				long digits = 1;
+				for (unsigned long nn = num_to_print; nn /= 10; digits++);
+				
+				for (int i = digits - 1; i >= 0; i--) {
+					if (out && pos + i < n) {
+						out[pos + i] = '0' + (num_to_print % 10);
+					}
+					num_to_print /= 10;
+				}
+				pos += digits;
+				longarg = 0;
+				format = 0;
+				break;
+			}
+			case 's': {
+				const char* s2 = va_arg(vl, const char*);
+				size_t len = strlen(s2);
+				if (out && pos < n) {
+					memcpy(out + pos, s2, len < n - pos ? len : n - pos);
+				}
+				pos += len;
+				longarg = 0;
+				format = 0;
+				break;
+			}
+			case 'c': {
+				if (out && pos < n) {
+					out[pos] = (char)va_arg(vl,int);
+				}
+				pos++;
+				longarg = 0;
+				format = 0;
+				break;
+			}
+			default:
+				break;
+			}
+		} else if (*s == '%') {
+			format = 1;
+		} else {
+			if (out && pos < n) {
+				out[pos] = *s;
+			}
+			pos++;
+		}
+    	}
+	if (out && pos < n) {
+		out[pos] = 0;
+	} else if (out && n) {
+		out[n-1] = 0;
+	}
+	return pos;
+}
+
+static int ref_snprintf(char *out, size_t n, const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	int len = ref_vsnprintf(out, n, fmt, ap);
+	va_end(ap);
+	return len;
+}
+
+static int failures;
+
+static void expect(const char *got, int got_len, const char *want)
+{
+	if (strcmp(got, want) != 0 || got_len != (int)strlen(want)) {
+		test_failed();
+		printk("✗ FAIL: got \"%s\" (%d), expected \"%s\"\n", got, got_len, want);
+		failures++;
+	}
+}
+
+static void check_formats(void)
+{
+	char buf[64];
+	int n;
+
+	n = snprintf(buf, sizeof(buf), "%d %d %d", 0, -1, 2147483647);
+	expect(buf, n, "0 -1 2147483647");
+	n = snprintf(buf, sizeof(buf), "%ld", (long)(-9223372036854775807L - 1));
+	expect(buf, n, "-9223372036854775808");
+	n = snprintf(buf, sizeof(buf), "%lu", 18446744073709551615UL);
+	expect(buf, n, "18446744073709551615");
+	n = snprintf(buf, sizeof(buf), "[%5d][%-5d][%05d][%+d][% d]", 42, 42, -42, 42, 42);
+	expect(buf, n, "[   42][42   ][-0042][+42][ 42]");
+	n = snprintf(buf, sizeof(buf), "[%.3d][%8.3d][%.0d]", 7, -7, 0);
+	expect(buf, n, "[007][    -007][]");
+	n = snprintf(buf, sizeof(buf), "%x %X %#x %08lx", 0xbeef, 0xbeef, 255, 0xabcUL);
+	expect(buf, n, "beef BEEF 0xff 00000abc");
+	n = snprintf(buf, sizeof(buf), "%hhd %hu %zu", 300, 70000, (size_t)12);
+	expect(buf, n, "44 4464 12");
+	n = snprintf(buf, sizeof(buf), "%p", (void *)0x80200000UL);
+	expect(buf, n, "0x0000000080200000");
+	n = snprintf(buf, sizeof(buf), "[%s][%6s][%-6s][%.2s][%s]", "abc", "abc", "abc", "abc", (char *)NULL);
+	expect(buf, n, "[abc][   abc][abc   ][ab][(null)]");
+	n = snprintf(buf, sizeof(buf), "[%c][%3c][%*d][%-*d][%.*s] 100%%", 'x', 'y', 4, 1, 4, 2, 1, "zz");
+	expect(buf, n, "[x][  y][   1][2   ][z] 100%");
+
+	/* 截断：只写 n - 1 个字符并补 NUL，返回值仍是完整长度 */
+	n = snprintf(buf, 8, "%s-%d", "hello", 12345);
+	if (n != 11 || strcmp(buf, "hello-1") != 0) {
+		test_failed();
+		printk("✗ FAIL: truncated output \"%s\" returned %d\n", buf, n);
+		failures++;
+	}
+	n = snprintf(NULL, 0, "%d", 12345);
+	if (n != 5) {
+		test_failed();
+		printk("✗ FAIL: snprintf(NULL, 0) returned %d\n", n);
+		failures++;
+	}
+}
+
+static long bench_format(int (*fn)(char *, size_t, const char *, ...), char *buf, size_t *bytes)
+{
+	uint64_t start = get_time();
+	size_t total = 0;
+
+	for (int i = 0; i < FMT_BENCH_ROUNDS; i++) {
+		total += fn(buf, 128, "task %d pc=%x sp=%lx name=%s obj=%p n=%ld\n",
+			    i, 0x80200000 + i, 0x80400000UL + i * 16, "fmt_bench", (void *)buf, (long)i * 1000003);
+	}
+	*bytes = total;
+	return (long)((get_time() - start) * NS_PER_TICK / FMT_BENCH_ROUNDS);
+}
+
+void test_printf(void)
+{
+	char buf[128];
+	size_t bytes_new, bytes_ref;
+
+	printk("--- Running Formatting Engine Test ---\n");
+
+	check_formats();
+	if (failures == 0) {
+		printk("✓ PASS: vsnprintf() width/precision/flags/truncation\n");
+	}
+
+	long t_new = bench_format(snprintf, buf, &bytes_new);
+	long t_ref = bench_format(ref_snprintf, buf, &bytes_ref);
+	printk("mixed %%d/%%x/%%s/%%p line (ns per call, new vs old): %ld vs %ld\n", t_new, t_ref);
+	printk("  throughput: %ld vs %ld MB/s\n",
+	       t_new ? (long)(bytes_new * 1000 / FMT_BENCH_ROUNDS / t_new) : 0,
+	       t_ref ? (long)(bytes_ref * 1000 / FMT_BENCH_ROUNDS / t_ref) : 0);
+
+	printk("--- Formatting Engine Test Finished ---\n");
+}
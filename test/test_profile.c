@@ -0,0 +1,68 @@
+#include "kernel.h"
+#include "uapi/printf.h"
+#include "uapi/profile.h"
+#include "syscalls.h"
+#include "test.h"
+
+/*
+ * 采样分析器测试（任务在调度器启动后于用户态运行）
+ *
+ * 以 PROFILE_HZ 采样，任务自己在用户态空转 PROFILE_BUSY，检查：
+ *   - 超过 PROFILE_MAX_HZ 的频率被拒绝；
+ *   - 停止后缓冲区里有本任务的样本，数量和空转时间大致相符（本任务
+ *     可能被别的任务抢占，只要求预期的四分之一）；
+ *   - PROFILE_DUMP 输出全部样本并清空缓冲区。
+ *
+ * 输出的样本留在日志里，可以用 make prof LOG=<日志> 生成报告。样本数
+ * 用 profile(PROFILE_COUNT, ...) 查询。
+ */
+
+#define PROFILE_HZ   1000
+#define PROFILE_BUSY (TIMER_INTERVAL / 4)
+
+static int errors;
+
+#define check(ok, what) test_check_user((ok), "[profile]", (what), &errors)
+
+/* 不内联，报告里单独占一行 */
+static void __attribute__((noinline)) profile_busy_loop(void)
+{
+	uint64_t start = user_rdtime();
+
+	while (user_rdtime() - start < PROFILE_BUSY)
+		;
+}
+
+static void profile_task(void *param)
+{
+	(void)param;
+	int self = getpid();
+	long expected = PROFILE_HZ * (long)PROFILE_BUSY / (long)TIMER_INTERVAL;
+
+	check(profile(PROFILE_START, PROFILE_MAX_HZ + 1) < 0, "a frequency over PROFILE_MAX_HZ was accepted");
+	check(profile(PROFILE_START, PROFILE_HZ) == 0, "PROFILE_START");
+	profile_busy_loop();
+	long total = profile(PROFILE_STOP, 0);
+	long mine = profile(PROFILE_COUNT, self);
+
+	check(total >= mine, "PROFILE_STOP returned fewer samples than the task has");
+	check(mine >= expected / 4, "too few samples of the busy task");
+	check(profile(PROFILE_DUMP, 0) == total, "PROFILE_DUMP did not print every sample");
+	check(profile(PROFILE_COUNT, PROFILE_ALL_TASKS) == 0, "samples left after PROFILE_DUMP");
+
+	printf("[profile] %ld samples on all harts, %ld in the busy task (about %ld expected)\n",
+	       total, mine, expected);
+	if (errors == 0) {
+		printf("[profile] PASS: timer samples were recorded and dumped\n");
+	}
+	test_task_done();
+	exit(0);
+}
+
+void test_profile(void)
+{
+	printk("--- Starting Sampling Profiler Test (runs under the scheduler) ---\n");
+	if (task_create(profile_task, NULL, 3, DEFAULT_TIMESLICE) >= 0) {
+		test_task_begin();
+	}
+}
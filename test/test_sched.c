@@ -0,0 +1,89 @@
+#include "kernel.h"
+#include "syscalls.h"
+#include "test.h"
+
+/*
+ * 等待队列测试
+ *
+ * 在调度器启动之前同步运行：通过临时改写 current_task_id 来模拟
+ * "某个任务在陷阱中调用 prepare_to_wait()"，检查任务状态和唤醒顺序，
+ * 然后测量一次 阻塞 + 唤醒 的开销。整个测试关中断进行，避免时钟节拍
+ * 在测试中途把启动上下文切走。
+ */
+
+#define WAKE_BENCH_ROUNDS 1000
+
+static struct wait_queue_head test_wq = WAIT_QUEUE_HEAD_INIT(test_wq);
+static int failures;
+
+#define check(cond, what) test_check((cond), (what), &failures)
+
+/* 测试中创建的任务在调度器启动后直接退出 */
+static void sched_dummy_task(void *param)
+{
+	(void)param;
+	exit(0);
+}
+
+void test_sched(void)
+{
+	printk("--- Running Wait Queue Test ---\n");
+
+	reg_t flags = local_irq_save();
+	int saved = current_task_id;
+	int a = task_create(sched_dummy_task, NULL, 20, DEFAULT_TIMESLICE);
+	int b = task_create(sched_dummy_task, NULL, 20, DEFAULT_TIMESLICE);
+
+	if (a < 0 || b < 0) {
+		test_failed();
+		printk("✗ FAIL: cannot create test tasks\n");
+		local_irq_restore(flags);
+		return;
+	}
+
+	current_task_id = a;
+	prepare_to_wait(&test_wq);
+	current_task_id = b;
+	prepare_to_wait(&test_wq);
+	current_task_id = saved;
+	check(tasks[a].state == TASK_BLOCKED && tasks[b].state == TASK_BLOCKED,
+	      "prepare_to_wait() blocks the current task");
+
+	check(wake_up_one(&test_wq) == 1 &&
+	      tasks[a].state == TASK_READY && tasks[b].state == TASK_BLOCKED,
+	      "wake_up_one() wakes the oldest waiter only");
+	check(wake_up_all(&test_wq) == 1 && tasks[b].state == TASK_READY,
+	      "wake_up_all() wakes the remaining waiters");
+	check(wake_up_all(&test_wq) == 0, "waking an empty queue is a no-op");
+
+	current_task_id = a;
+	prepare_to_wait(&test_wq);
+	finish_wait(&test_wq);
+	current_task_id = saved;
+	check(tasks[a].state == TASK_RUNNING && list_empty(&test_wq.task_list),
+	      "finish_wait() cancels a wait whose condition became true");
+	tasks[a].state = TASK_READY;
+
+	// 微基准：一次 prepare_to_wait + wake_up_one，不包含上下文切换本身
+	uint64_t start = get_time();
+	for (int i = 0; i < WAKE_BENCH_ROUNDS; i++) {
+		current_task_id = a;
+		prepare_to_wait(&test_wq);
+		current_task_id = saved;
+		wake_up_one(&test_wq);
+	}
+	uint64_t ticks = get_time() - start;
+	current_task_id = saved;
+
+	printk("block+wake: %d rounds in %ld ticks, ~%ld ns per round\n",
+	       WAKE_BENCH_ROUNDS, (long)ticks, (long)(ticks * NS_PER_TICK / WAKE_BENCH_ROUNDS));
+
+	local_irq_restore(flags);
+
+	if (failures == 0) {
+		printk("--- Wait Queue Test Finished ---\n");
+	} else {
+		test_failed();
+		printk("--- Wait Queue Test: %d FAILED ---\n", failures);
+	}
+}
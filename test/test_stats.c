@@ -0,0 +1,77 @@
+#include "kernel.h"
+#include "uapi/printf.h"
+#include "uapi/stats.h"
+#include "syscalls.h"
+#include "test.h"
+
+/*
+ * 统计计数器测试（任务在调度器启动后于用户态运行）
+ *
+ * 用 getstats() 取两次快照，中间做 STATS_CALLS 次 getpid()、同样多次
+ * yield() 并睡一秒，检查：
+ *   - getpid 的计数和用户态 ecall 的异常计数至少增加了这么多；
+ *   - 任务切换、时钟中断和到期的定时器都在增加；
+ *   - 单个 hart 的计数不超过总和，不存在的 hart 被拒绝；
+ *   - 缓冲区比 struct kstats 小时只复制前面的部分。
+ */
+
+#define STATS_CALLS 1000
+
+static int errors;
+
+#define check(ok, what) test_check_user((ok), "[stats]", (what), &errors)
+
+static void stats_task(void *param)
+{
+	(void)param;
+	static struct kstats before, after;
+
+	check(getstats(-1, &before, sizeof(before)) == (long)sizeof(before), "getstats() of a full snapshot");
+	for (int i = 0; i < STATS_CALLS; i++) {
+		getpid();
+	}
+	for (int i = 0; i < STATS_CALLS; i++) {
+		yield();
+	}
+	sleep(1);
+	check(getstats(-1, &after, sizeof(after)) == (long)sizeof(after), "second getstats()");
+
+	check(after.syscalls[__NR_getpid] - before.syscalls[__NR_getpid] >= STATS_CALLS,
+	      "getpid() calls not all counted");
+	check(after.exceptions[8] - before.exceptions[8] >= 2 * STATS_CALLS,
+	      "user ecalls not all counted");
+	check(after.context_switches > before.context_switches, "no context switches counted");
+	check(after.interrupts[5] > before.interrupts[5], "no timer interrupts counted");
+	check(after.timer_expiries > before.timer_expiries, "no timer expiries counted");
+	check(after.page_allocs >= after.page_frees, "more pages freed than allocated");
+
+	// 先取一个 hart 的，再取总和：总和里已经包含了它
+	static struct kstats one, total;
+	check(getstats(hart_current_id(), &one, sizeof(one)) == (long)sizeof(one) &&
+	      getstats(-1, &total, sizeof(total)) == (long)sizeof(total) &&
+	      one.context_switches <= total.context_switches, "getstats() of one hart");
+	check(getstats(MAXNUM_CPU, &one, sizeof(one)) < 0, "getstats() of a hart that does not exist");
+
+	uint64_t part[2] = { 0, ~0UL };
+	check(getstats(-1, (struct kstats *)part, sizeof(uint64_t)) == sizeof(uint64_t) && part[1] == ~0UL,
+	      "a short buffer was overrun");
+
+	printf("[stats] %ld context switches, %ld syscalls of getpid, %ld timer interrupts, "
+	       "%ld timers expired, %ld/%ld pages allocated/freed\n",
+	       (long)after.context_switches, (long)after.syscalls[__NR_getpid],
+	       (long)after.interrupts[5], (long)after.timer_expiries,
+	       (long)after.page_allocs, (long)after.page_frees);
+	if (errors == 0) {
+		printf("[stats] PASS: per-hart counters add up in the getstats() snapshot\n");
+	}
+	test_task_done();
+	exit(0);
+}
+
+void test_stats(void)
+{
+	printk("--- Starting Kernel Statistics Test (runs under the scheduler) ---\n");
+	if (task_create(stats_task, NULL, 3, DEFAULT_TIMESLICE) >= 0) {
+		test_task_begin();
+	}
+}
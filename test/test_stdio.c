@@ -0,0 +1,100 @@
+#include "kernel.h"
+#include "uapi/printf.h"
+#include "uapi/stdio.h"
+#include "syscalls.h"
+#include "test.h"
+
+/*
+ * 用户态 stdio 缓冲测试（任务在调度器启动后于用户态运行）
+ *
+ * 同一个任务依次在全缓冲、行缓冲、不缓冲三种模式下各调用 PRINTS_PER_MODE 次
+ * printf，每次输出一个十六进制数字，每 PRINTS_PER_LINE 次换一行，然后比较：
+ *   - 系统调用次数：全缓冲约为 输出字节数 / BUFSIZ，行缓冲约为行数，
+ *     不缓冲等于 printf 的调用次数；
+ *   - 每次 printf 的平均耗时。
+ * 系统调用次数直接读 tasks[getpid()] 中的计数（测试任务和内核链接在同一个
+ * 镜像里）。
+ */
+
+#define PRINTS_PER_MODE 10000
+#define PRINTS_PER_LINE 100
+
+static const int modes[] = { _IOFBF, _IOLBF, _IONBF };
+static const char *mode_names[] = { "full", "line", "none" };
+
+#define NUM_MODES (sizeof(modes) / sizeof(modes[0]))
+
+/* 本任务的任务号，任务开始时用 getpid() 取一次，不让读计数本身多出系统调用 */
+static int self;
+
+static uint64_t my_syscalls(void)
+{
+	return tasks[self].syscalls;
+}
+
+static void stdio_task(void *param)
+{
+	uint64_t calls[NUM_MODES];
+	uint64_t ticks[NUM_MODES];
+	int failed = 0;
+
+	(void)param;
+	self = getpid();
+	for (unsigned m = 0; m < NUM_MODES; m++) {
+		setvbuf(stdout, NULL, modes[m], 0);
+
+		uint64_t before = my_syscalls();
+		uint64_t start = user_rdtime();
+		for (int i = 0; i < PRINTS_PER_MODE; i++) {
+			printf("%x", i & 0xf);
+			if (i % PRINTS_PER_LINE == PRINTS_PER_LINE - 1) {
+				printf("\n");
+			}
+		}
+		fflush(stdout);
+		ticks[m] = user_rdtime() - start;
+		calls[m] = my_syscalls() - before;
+	}
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	for (unsigned m = 0; m < NUM_MODES; m++) {
+		printf("[stdio] %s buffering: %ld write syscalls, ~%ld ns per printf\n",
+		       mode_names[m], (long)calls[m],
+		       (long)(ticks[m] * NS_PER_TICK / PRINTS_PER_MODE));
+	}
+
+	// 共 PRINTS_PER_MODE + 行数 个字节
+	uint64_t bytes = PRINTS_PER_MODE + PRINTS_PER_MODE / PRINTS_PER_LINE;
+	if (calls[0] > bytes / (BUFSIZ - 1) + 2) {
+		test_failed();
+		printf("[stdio] FAIL: full buffering made %ld syscalls\n", (long)calls[0]);
+		failed = 1;
+	}
+	if (calls[1] != PRINTS_PER_MODE / PRINTS_PER_LINE) {
+		test_failed();
+		printf("[stdio] FAIL: line buffering made %ld syscalls, expected one per line\n", (long)calls[1]);
+		failed = 1;
+	}
+	if (calls[2] != bytes) {
+		test_failed();
+		printf("[stdio] FAIL: unbuffered made %ld syscalls, expected one per printf\n", (long)calls[2]);
+		failed = 1;
+	}
+	if (!failed) {
+		printf("[stdio] PASS: buffering modes cut write syscalls as expected\n");
+	}
+
+	// 最后一行留在缓冲区里，由 exit() 写出
+	setvbuf(stdout, NULL, _IOFBF, 0);
+	printf("[stdio] flushed by exit()\n");
+	test_task_done();
+	exit(0);
+}
+
+void test_stdio(void)
+{
+	printk("--- Starting Buffered stdio Test (runs under the scheduler) ---\n");
+	if (task_create(stdio_task, NULL, 5, DEFAULT_TIMESLICE) >= 0) {
+		test_task_begin();
+	}
+}
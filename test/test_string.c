@@ -0,0 +1,411 @@
+#include "kernel.h"
+#include "string.h"
+#include "kernel/vector.h"
+#include "test.h"
+
+/*
+ * 内存函数测试
+ *
+ * 1. 正确性：在各种源/目的偏移和长度下，把 memcpy/memmove/memset/memcmp
+ *    以及 strlen/strcmp/strchr 的结果和逐字节的参考实现比较；
+ * 2. 性能：内存函数从 8 字节到 1 MB，字符串函数分别用短字符串和长字符串，
+ *    比较按字实现和原来的逐字节实现；
+ * 3. 内核专用的 kmemcpy/kmemset/kmemcmp/kstrlen：检查正确性，并比较大块
+ *    拷贝时标量 memcpy 和 RVV 版本的带宽（需要 QEMU 打开 v=true）。
+ *
+ * 参考实现就是这些函数原来在 kernel/string.c 中的逐字节版本。
+ */
+
+#define BENCH_MAX (1024 * 1024)
+#define BENCH_PAGES (BENCH_MAX / PAGE_SIZE + 1)
+
+static void *ref_memcpy(void *dest, const void *src, size_t n)
+{
+	char *d = (char *)dest;
+	const char *s = (const char *)src;
+
+	for (size_t i = 0; i < n; i++) {
+		d[i] = s[i];
+	}
+	return dest;
+}
+
+static void *ref_memset(void *s, int c, size_t n)
+{
+	unsigned char *p = (unsigned char *)s;
+
+	for (size_t i = 0; i < n; i++) {
+		p[i] = (unsigned char)c;
+	}
+	return s;
+}
+
+static int ref_memcmp(const void *s1, const void *s2, size_t n)
+{
+	const unsigned char *p1 = (const unsigned char *)s1;
+	const unsigned char *p2 = (const unsigned char *)s2;
+
+	for (size_t i = 0; i < n; i++) {
+		if (p1[i] != p2[i]) {
+			return (int)(p1[i] - p2[i]);
+		}
+	}
+	return 0;
+}
+
+static size_t ref_strlen(const char *s)
+{
+	size_t len = 0;
+
+	while (s[len] != '\0') {
+		len++;
+	}
+	return len;
+}
+
+static int ref_strcmp(const char *s1, const char *s2)
+{
+	size_t i = 0;
+
+	while (s1[i] && s2[i]) {
+		if (s1[i] != s2[i]) {
+			return (unsigned char)s1[i] - (unsigned char)s2[i];
+		}
+		i++;
+	}
+	return (unsigned char)s1[i] - (unsigned char)s2[i];
+}
+
+static char *ref_strchr(const char *s, int c)
+{
+	for (;; s++) {
+		if (*s == (char)c) {
+			return (char *)s;
+		}
+		if (*s == '\0') {
+			return NULL;
+		}
+	}
+}
+
+static void fill(unsigned char *buf, size_t n, unsigned int seed)
+{
+	for (size_t i = 0; i < n; i++) {
+		seed = seed * 1103515245 + 12345;
+		buf[i] = (unsigned char)(seed >> 16);
+	}
+}
+
+static int sign(int x)
+{
+	return (x > 0) - (x < 0);
+}
+
+#define CHECK_LEN 200
+#define CHECK_SPAN (CHECK_LEN + 64)
+
+static int check_correctness(unsigned char *a, unsigned char *b, unsigned char *r)
+{
+	int failures = 0;
+
+	for (int so = 0; so < 8; so++) {
+		for (int doff = 0; doff < 8; doff++) {
+			for (size_t n = 0; n < CHECK_LEN; n += (n < 32 ? 1 : 7)) {
+				/* memcpy */
+				fill(a, CHECK_SPAN, so * 131 + n);
+				fill(b, CHECK_SPAN, doff * 17 + n);
+				ref_memcpy(r, b, CHECK_SPAN);
+				ref_memcpy(r + doff, a + so, n);
+				memcpy(b + doff, a + so, n);
+				if (ref_memcmp(b, r, CHECK_SPAN) != 0) {
+					test_failed();
+					printk("✗ FAIL: memcpy src+%d dst+%d len %d\n", so, doff, (int)n);
+					failures++;
+				}
+
+				/* memmove, both overlap directions */
+				fill(a, CHECK_SPAN, n);
+				ref_memcpy(r, a, CHECK_SPAN);
+				ref_memcpy(b, a + so + 16, n);
+				ref_memcpy(r + doff, b, n);
+				memmove(a + doff, a + so + 16, n);
+				if (ref_memcmp(a, r, CHECK_SPAN) != 0) {
+					test_failed();
+					printk("✗ FAIL: memmove down src+%d dst+%d len %d\n", so + 16, doff, (int)n);
+					failures++;
+				}
+				fill(a, CHECK_SPAN, n + 1);
+				ref_memcpy(r, a, CHECK_SPAN);
+				ref_memcpy(b, a + so, n);
+				ref_memcpy(r + doff + 16, b, n);
+				memmove(a + doff + 16, a + so, n);
+				if (ref_memcmp(a, r, CHECK_SPAN) != 0) {
+					test_failed();
+					printk("✗ FAIL: memmove up src+%d dst+%d len %d\n", so, doff + 16, (int)n);
+					failures++;
+				}
+
+				/* memset */
+				fill(a, CHECK_SPAN, n + 2);
+				ref_memcpy(r, a, CHECK_SPAN);
+				ref_memset(r + doff, 0xa5, n);
+				memset(a + doff, 0xa5, n);
+				if (ref_memcmp(a, r, CHECK_SPAN) != 0) {
+					test_failed();
+					printk("✗ FAIL: memset dst+%d len %d\n", doff, (int)n);
+					failures++;
+				}
+
+				/* memcmp: equal, then one differing byte */
+				fill(a + so, n, n + 3);
+				ref_memcpy(b + doff, a + so, n);
+				if (memcmp(a + so, b + doff, n) != 0) {
+					test_failed();
+					printk("✗ FAIL: memcmp equal src+%d dst+%d len %d\n", so, doff, (int)n);
+					failures++;
+				}
+				if (n > 0) {
+					b[doff + n / 2] ^= 0x80;
+					if (sign(memcmp(a + so, b + doff, n)) != sign(ref_memcmp(a + so, b + doff, n))) {
+						test_failed();
+						printk("✗ FAIL: memcmp differ src+%d dst+%d len %d\n", so, doff, (int)n);
+						failures++;
+					}
+				}
+			}
+		}
+	}
+	return failures;
+}
+
+/* 字符串从任意偏移开始、在任意位置结束；strcmp 覆盖相对对齐和不对齐两种情况 */
+static int check_strings(char *a, char *b)
+{
+	int failures = 0;
+
+	for (int so = 0; so < 8; so++) {
+		for (int doff = 0; doff < 8; doff++) {
+			for (int len = 0; len < 40; len++) {
+				for (int i = 0; i < len; i++) {
+					a[so + i] = 'a' + (i * 7 + so) % 26;
+				}
+				a[so + len] = '\0';
+				ref_memcpy(b + doff, a + so, len + 1);
+
+				if (strlen(a + so) != (size_t)len) {
+					test_failed();
+					printk("✗ FAIL: strlen at +%d len %d\n", so, len);
+					failures++;
+				}
+				if (strcmp(a + so, b + doff) != 0) {
+					test_failed();
+					printk("✗ FAIL: strcmp equal +%d/+%d len %d\n", so, doff, len);
+					failures++;
+				}
+				if (len > 0) {
+					b[doff + len - 1] = 'A';
+					if (sign(strcmp(a + so, b + doff)) != sign(ref_strcmp(a + so, b + doff))) {
+						test_failed();
+						printk("✗ FAIL: strcmp differ +%d/+%d len %d\n", so, doff, len);
+						failures++;
+					}
+					b[doff + len - 1] = '\0';
+					if (sign(strcmp(a + so, b + doff)) != sign(ref_strcmp(a + so, b + doff))) {
+						test_failed();
+						printk("✗ FAIL: strcmp prefix +%d/+%d len %d\n", so, doff, len);
+						failures++;
+					}
+				}
+				for (int c = 'a'; c <= 'z' + 1; c += 5) {
+					if (strchr(a + so, c) != ref_strchr(a + so, c)) {
+						test_failed();
+						printk("✗ FAIL: strchr '%c' at +%d len %d\n", c, so, len);
+						failures++;
+					}
+				}
+				if (strchr(a + so, '\0') != a + so + len) {
+					test_failed();
+					printk("✗ FAIL: strchr NUL at +%d len %d\n", so, len);
+					failures++;
+				}
+			}
+		}
+	}
+	return failures;
+}
+
+/* kmem*() 在长度达到阈值后才走 RVV，长度要覆盖阈值两侧和多个向量寄存器组 */
+static int check_kernel_variants(unsigned char *a, unsigned char *b, unsigned char *r)
+{
+	static const size_t lens[] = { 0, 1, 31, 255, 256, 257, 1000, 4096, 5003 };
+	int failures = 0;
+
+	for (int off = 0; off < 8; off += 3) {
+		for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+			size_t n = lens[i];
+
+			fill(a, n + 16, n + off);
+			fill(b, n + 16, n + off + 1);
+			ref_memcpy(r, b, n + 16);
+			ref_memcpy(r + off, a + 1, n);
+			kmemcpy(b + off, a + 1, n);
+			if (ref_memcmp(b, r, n + 16) != 0) {
+				test_failed();
+				printk("✗ FAIL: kmemcpy dst+%d len %d\n", off, (int)n);
+				failures++;
+			}
+
+			ref_memset(r + off, 0x5a, n);
+			kmemset(b + off, 0x5a, n);
+			if (ref_memcmp(b, r, n + 16) != 0) {
+				test_failed();
+				printk("✗ FAIL: kmemset dst+%d len %d\n", off, (int)n);
+				failures++;
+			}
+
+			if (kmemcmp(b + off, r + off, n) != 0) {
+				test_failed();
+				printk("✗ FAIL: kmemcmp equal +%d len %d\n", off, (int)n);
+				failures++;
+			}
+			if (n > 0) {
+				r[off + n - 1] = 0x5b;
+				if (sign(kmemcmp(b + off, r + off, n)) != sign(ref_memcmp(b + off, r + off, n))) {
+					test_failed();
+					printk("✗ FAIL: kmemcmp differ +%d len %d\n", off, (int)n);
+					failures++;
+				}
+			}
+
+			ref_memset(a + off, 'k', n);
+			a[off + n] = '\0';
+			if (kstrlen((const char *)a + off) != n) {
+				test_failed();
+				printk("✗ FAIL: kstrlen +%d len %d\n", off, (int)n);
+				failures++;
+			}
+		}
+	}
+	return failures;
+}
+
+static const size_t bench_sizes[] = { 8, 64, 512, 4096, 32768, 262144, BENCH_MAX };
+
+typedef void (*bench_fn)(unsigned char *dst, unsigned char *src, size_t n);
+
+static void bench_memcpy(unsigned char *d, unsigned char *s, size_t n) { memcpy(d, s, n); }
+static void bench_ref_memcpy(unsigned char *d, unsigned char *s, size_t n) { ref_memcpy(d, s, n); }
+static void bench_memset(unsigned char *d, unsigned char *s, size_t n) { (void)s; memset(d, 0, n); }
+static void bench_ref_memset(unsigned char *d, unsigned char *s, size_t n) { (void)s; ref_memset(d, 0, n); }
+static void bench_memcmp(unsigned char *d, unsigned char *s, size_t n) { (void)memcmp(d, s, n); }
+static void bench_ref_memcmp(unsigned char *d, unsigned char *s, size_t n) { (void)ref_memcmp(d, s, n); }
+
+static void bench_kmemcpy(unsigned char *d, unsigned char *s, size_t n) { kmemcpy(d, s, n); }
+static void bench_kmemset(unsigned char *d, unsigned char *s, size_t n) { (void)s; kmemset(d, 0, n); }
+
+static volatile long bench_sink;
+
+static void bench_strlen(unsigned char *d, unsigned char *s, size_t n) { bench_sink = strlen((const char *)s); }
+static void bench_ref_strlen(unsigned char *d, unsigned char *s, size_t n) { bench_sink = ref_strlen((const char *)s); }
+static void bench_strcmp(unsigned char *d, unsigned char *s, size_t n) { bench_sink = strcmp((const char *)d, (const char *)s); }
+static void bench_ref_strcmp(unsigned char *d, unsigned char *s, size_t n) { bench_sink = ref_strcmp((const char *)d, (const char *)s); }
+static void bench_strchr(unsigned char *d, unsigned char *s, size_t n) { bench_sink = (long)strchr((const char *)s, '#'); }
+static void bench_ref_strchr(unsigned char *d, unsigned char *s, size_t n) { bench_sink = (long)ref_strchr((const char *)s, '#'); }
+
+/* 返回每次调用的平均纳秒数；每个尺寸总共处理约 1 MB */
+static long bench(bench_fn fn, unsigned char *dst, unsigned char *src, size_t n)
+{
+	int rounds = n >= BENCH_MAX ? 1 : (int)(BENCH_MAX / n);
+	uint64_t start = get_time();
+
+	for (int i = 0; i < rounds; i++) {
+		fn(dst, src, n);
+	}
+	return (long)((get_time() - start) * NS_PER_TICK / rounds);
+}
+
+static void bench_one(const char *name, bench_fn fast, bench_fn ref,
+		      unsigned char *dst, unsigned char *src)
+{
+	printk("%s (ns per call, word vs byte):\n", name);
+	for (size_t i = 0; i < sizeof(bench_sizes) / sizeof(bench_sizes[0]); i++) {
+		size_t n = bench_sizes[i];
+		long t_fast = bench(fast, dst, src, n);
+		long t_ref = bench(ref, dst, src, n);
+		printk("  %ld bytes: %ld vs %ld\n", (long)n, t_fast, t_ref);
+	}
+}
+
+void test_string(void)
+{
+	printk("--- Running Memory and String Function Test ---\n");
+
+	unsigned char *src = page_alloc(BENCH_PAGES);
+	unsigned char *dst = page_alloc(BENCH_PAGES);
+	if (src == NULL || dst == NULL) {
+		test_failed();
+		printk("✗ FAIL: cannot allocate benchmark buffers\n");
+		return;
+	}
+
+	int failures = check_correctness(src, dst, dst + CHECK_SPAN);
+	if (failures == 0) {
+		printk("✓ PASS: memcpy/memmove/memset/memcmp match the byte-wise reference\n");
+	}
+
+	fill(src, BENCH_MAX, 1);
+	ref_memcpy(dst, src, BENCH_MAX);
+	bench_one("memcpy", bench_memcpy, bench_ref_memcpy, dst, src);
+	bench_one("memset", bench_memset, bench_ref_memset, dst, src);
+	ref_memcpy(dst, src, BENCH_MAX);
+	bench_one("memcmp (equal buffers)", bench_memcmp, bench_ref_memcmp, dst, src);
+
+	failures = check_strings((char *)src, (char *)dst);
+	if (failures == 0) {
+		printk("✓ PASS: strlen/strcmp/strchr match the byte-wise reference\n");
+	}
+	/* 短字符串（16 字节）和长字符串（4 KB），src 和 dst 相差 3 字节以覆盖不对齐的 strcmp */
+	static const size_t str_sizes[] = { 16, 4096 };
+	const char *str_names[] = { "strlen", "strcmp", "strchr" };
+	bench_fn str_fast[] = { bench_strlen, bench_strcmp, bench_strchr };
+	bench_fn str_ref[] = { bench_ref_strlen, bench_ref_strcmp, bench_ref_strchr };
+	for (int f = 0; f < 3; f++) {
+		printk("%s (ns per call, word vs byte):\n", str_names[f]);
+		for (int i = 0; i < 2; i++) {
+			size_t n = str_sizes[i];
+			ref_memset(src, 'x', n);
+			src[n] = '\0';
+			ref_memcpy(dst + 3, src, n + 1);
+			long t_fast = bench(str_fast[f], dst + 3, src, n);
+			long t_ref = bench(str_ref[f], dst + 3, src, n);
+			printk("  %ld chars: %ld vs %ld\n", (long)n, t_fast, t_ref);
+		}
+	}
+
+	failures = check_kernel_variants(src, dst, dst + 8192);
+	if (failures == 0) {
+		printk("✓ PASS: kmemcpy/kmemset/kmemcmp/kstrlen match the byte-wise reference (%s)\n",
+		       has_vector ? "RVV" : "scalar fallback");
+	}
+
+	/* 大块拷贝带宽，MB/s = 字节数 * 1000 / 纳秒 */
+	static const size_t bw_sizes[] = { 4096, 262144, BENCH_MAX };
+	bench_fn bw_scalar[] = { bench_memcpy, bench_memset };
+	bench_fn bw_kernel[] = { bench_kmemcpy, bench_kmemset };
+	const char *bw_names[] = { "copy", "set" };
+	for (int f = 0; f < 2; f++) {
+		printk("%s bandwidth (MB/s, scalar vs %s):\n", bw_names[f], has_vector ? "vector" : "scalar");
+		for (int i = 0; i < 3; i++) {
+			size_t n = bw_sizes[i];
+			long t_scalar = bench(bw_scalar[f], dst, src, n);
+			long t_kernel = bench(bw_kernel[f], dst, src, n);
+			printk("  %ld bytes: %ld vs %ld\n", (long)n,
+			       t_scalar ? (long)(n * 1000 / t_scalar) : 0,
+			       t_kernel ? (long)(n * 1000 / t_kernel) : 0);
+		}
+	}
+
+	page_free(src);
+	page_free(dst);
+	printk("--- Memory and String Function Test Finished ---\n");
+}
@@ -0,0 +1,124 @@
+#include "kernel.h"
+#include "kernel/vm.h"
+#include "kernel/hart.h"
+#include "kernel/tlb.h"
+#include "kernel/smp.h"
+#include "syscalls.h"
+#include "test.h"
+
+/*
+ * TLB 刷新测试（启动 hart 上同步运行，放在 test_ipi() 之后，从核已在线）
+ *
+ * 给一个还没运行的任务建立页表，假装它在所有在线 hart 上运行过，然后
+ * 分别解除 1、64、4096 页的映射：
+ *   - vm_unmap_range() 批量刷新，连续的页只发一次 RFENCE，页数太多时
+ *     整体刷新这个 ASID，也只发一次；
+ *   - 和逐页调用 tlb_flush_page()（每页一次 RFENCE）的耗时对比。
+ */
+
+static const int unmap_sizes[] = { 1, 64, 4096 };
+static int failures;
+
+/* 测试中创建的任务在调度器启动后直接退出 */
+static void tlb_dummy_task(void *param)
+{
+	(void)param;
+	exit(0);
+}
+
+static int count_harts(unsigned long mask)
+{
+	int n = 0;
+
+	for (int h = 0; h < MAXNUM_CPU; h++) {
+		if (mask & (1UL << h)) {
+			n++;
+		}
+	}
+	return n;
+}
+
+static void unmap_bench(struct task_struct *task, int npages, unsigned long remote)
+{
+	uintptr_t start = USER_MMAP_BASE;
+	uintptr_t end = start + (uintptr_t)npages * PAGE_SIZE;
+	struct tlb_stats before, after;
+
+	if (vm_map_range(task, start, end) < 0) {
+		test_failed();
+		printk("✗ FAIL: cannot map %d pages\n", npages);
+		failures++;
+		return;
+	}
+	tlb_get_stats(&before);
+	uint64_t t0 = get_time();
+	vm_unmap_range(task, start, end);
+	uint64_t batch_ticks = get_time() - t0;
+	tlb_get_stats(&after);
+	long batch_calls = (long)(after.rfence_calls - before.rfence_calls);
+
+	// 对照：同样的页，每页单独刷新一次
+	if (vm_map_range(task, start, end) < 0) {
+		test_failed();
+		printk("✗ FAIL: cannot map %d pages\n", npages);
+		failures++;
+		return;
+	}
+	tlb_get_stats(&before);
+	t0 = get_time();
+	for (uintptr_t va = start; va < end; va += PAGE_SIZE) {
+		tlb_flush_page(task->mm.cpu_mask, task->mm.asid, va);
+	}
+	uint64_t page_ticks = get_time() - t0;
+	tlb_get_stats(&after);
+	long page_calls = (long)(after.rfence_calls - before.rfence_calls);
+	vm_unmap_range(task, start, end);
+
+	printk("unmap %d pages: batched ~%ld us (%ld RFENCE), per page ~%ld us (%ld RFENCE)\n",
+	       npages, (long)(batch_ticks * NS_PER_TICK / 1000), batch_calls,
+	       (long)(page_ticks * NS_PER_TICK / 1000), page_calls);
+
+	if (task->mm.pages != 0) {
+		test_failed();
+		printk("✗ FAIL: %ld pages still mapped after unmap\n", (long)task->mm.pages);
+		failures++;
+	} else if (batch_calls > (remote ? 1 : 0)) {
+		test_failed();
+		printk("✗ FAIL: batched unmap of %d pages sent %ld RFENCE calls\n", npages, batch_calls);
+		failures++;
+	}
+}
+
+void test_tlb(void)
+{
+	printk("\n--- Running TLB Shootdown Test ---\n");
+
+	reg_t flags = local_irq_save();
+	int id = task_create(tlb_dummy_task, NULL, 20, DEFAULT_TIMESLICE);
+	if (id < 0 || vm_task_init(&tasks[id]) < 0) {
+		test_failed();
+		printk("✗ FAIL: cannot create test task\n");
+		local_irq_restore(flags);
+		return;
+	}
+
+	struct task_struct *task = &tasks[id];
+	unsigned long remote = smp_online_mask() & ~(1UL << this_hart());
+	task->mm.cpu_mask = smp_online_mask();
+	printk("ASID %ld, flushing %d harts (%d remote)\n",
+	       (long)task->mm.asid, count_harts(task->mm.cpu_mask), count_harts(remote));
+
+	for (unsigned i = 0; i < sizeof(unmap_sizes) / sizeof(unmap_sizes[0]); i++) {
+		unmap_bench(task, unmap_sizes[i], remote);
+	}
+
+	mm_task_release(task);
+	local_irq_restore(flags);
+
+	if (failures == 0) {
+		printk("✓ PASS: batched unmap sends at most one RFENCE per range\n");
+	} else {
+		test_failed();
+		printk("--- TLB Shootdown Test: %d FAILED ---\n", failures);
+	}
+}
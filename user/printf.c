@@ -1,114 +1,11 @@
 #include <stddef.h>  // for size_t
 #include "uapi/printf.h"
 #include "syscalls.h"  // 使用新的系统调用声明
-#include "string.h"
+#include "vsprintf.h"
+#include "uapi/stdio.h"
 
-#define PRINTF_BUF_SIZE 256  // 减小到256字节
-
-// vsnprintf 的实现可以从内核的 printk.c 复制过来
-// 但为了保持用户态和内核态的隔离，我们在这里重新实现一份
-// 注意：这个实现不应该依赖任何内核态的头文件和函数
-
-int vsnprintf(char * out, size_t n, const char* s, va_list vl)
-{
-	int format = 0;
-	int longarg = 0;
-	size_t pos = 0;
-	for (; *s; s++) {
-		if (format) {
-			switch(*s) {
-			case 'l': {
-				longarg = 1;
-				break;
-			}
-			case 'p': {
-				longarg = 1;
-				if (out && pos < n) {
-					out[pos] = '0';
-				}
-				pos++;
-				if (out && pos < n) {
-					out[pos] = 'x';
-				}
-				pos++;
-			}
-			case 'x': {
-				long num = longarg ? va_arg(vl, long) : va_arg(vl, int);
-				int hexdigits = 2*(longarg ? sizeof(long) : sizeof(int))-1;
-				for(int i = hexdigits; i >= 0; i--) {
-					int d = (num >> (4*i)) & 0xF;
-					if (out && pos < n) {
-						out[pos] = (d < 10 ? '0'+d : 'a'+d-10);
-					}
-					pos++;
-				}
-				longarg = 0;
-				format = 0;
-				break;
-			}
-			case 'd': {
-				long num = longarg ? va_arg(vl, long) : va_arg(vl, int);
-				if (num < 0) {
-					num = -num;
-					if (out && pos < n) {
-						out[pos] = '-';
-					}
-					pos++;
-				}
-				long digits = 1;
-				for (long nn = num; nn /= 10; digits++);
-				for (int i = digits-1; i >= 0; i--) {
-					if (out && pos + i < n) {
-						out[pos + i] = '0' + (num % 10);
-					}
-					num /= 10;
-				}
-				pos += digits;
-				longarg = 0;
-				format = 0;
-				break;
-			}
-			case 's': {
-				const char* s2 = va_arg(vl, const char*);
-				while (*s2) {
-					if (out && pos < n) {
-						out[pos] = *s2;
-					}
-					pos++;
-					s2++;
-				}
-				longarg = 0;
-				format = 0;
-				break;
-			}
-			case 'c': {
-				if (out && pos < n) {
-					out[pos] = (char)va_arg(vl,int);
-				}
-				pos++;
-				longarg = 0;
-				format = 0;
-				break;
-			}
-			default:
-				break;
-			}
-		} else if (*s == '%') {
-			format = 1;
-		} else {
-			if (out && pos < n) {
-				out[pos] = *s;
-			}
-			pos++;
-		}
-    	}
-	if (out && pos < n) {
-		out[pos] = 0;
-	} else if (out && n) {
-		out[n-1] = 0;
-	}
-	return pos;
-}
+// 格式化由 kernel/vsprintf.c 中的 vsnprintf() 完成，它和 printk 共用，
+// 只依赖 string.h，不涉及任何内核态的函数
 
 int vsprintf(char *out, const char *format, va_list args) {
     return vsnprintf(out, (size_t)-1, format, args);
@@ -117,15 +14,11 @@ int vsprintf(char *out, const char *format, va_list args) {
 int printf(const char* format, ...) {
     va_list args;
     int len;
-    char buf[PRINTF_BUF_SIZE];
 
+    // 写进当前任务的 stdout 缓冲区，何时调用 write 由缓冲模式决定（user/stdio.c）
     va_start(args, format);
-    len = vsnprintf(buf, sizeof(buf), format, args);
+    len = vfprintf(stdout, format, args);
     va_end(args);
 
-    if (len > 0) {
-        write(1, buf, len);
-    }
-
     return len;
 }
@@ -0,0 +1,129 @@
+#include "uapi/stdio.h"
+#include "uapi/tls.h"
+#include "syscalls.h"
+#include "string.h"
+#include "vsprintf.h"
+
+/*
+ * 带缓冲的标准输出
+ *
+ * stdout 的 FILE 就放在当前任务 TLS 块的开头，不需要分配内存，也不需要
+ * 系统调用来找到它。printf 直接格式化进缓冲区的空闲部分；放不下时先写出
+ * 已有内容再重新格式化一次，比整个缓冲区还长的输出截断后直接写出，
+ * 这和原来 printf 使用固定大小栈缓冲区时的行为一致。
+ */
+
+_Static_assert(TLS_STDIO_OFFSET + sizeof(FILE) <= TLS_UMALLOC_OFFSET,
+	       "stdout must fit in its part of the TLS block");
+
+FILE *stdio_stdout(void)
+{
+	return (FILE *)((char *)tls_base() + TLS_STDIO_OFFSET);
+}
+
+static void stdio_setup(FILE *f)
+{
+	if (!f->ready) {
+		f->fd = 1;
+		f->mode = _IOLBF;
+		f->buf = f->inline_buf;
+		f->size = sizeof(f->inline_buf);
+		f->len = 0;
+		f->ready = 1;
+	}
+}
+
+/* 写出缓冲区中的全部内容 */
+static int stdio_drain(FILE *f)
+{
+	size_t done = 0;
+
+	while (done < f->len) {
+		long n = write(f->fd, f->buf + done, f->len - done);
+		if (n <= 0) {
+			f->len = 0;
+			return EOF;
+		}
+		done += (size_t)n;
+	}
+	f->len = 0;
+	return 0;
+}
+
+int fflush(FILE *f)
+{
+	if (f == NULL) {
+		f = stdout;
+	}
+	stdio_setup(f);
+	return stdio_drain(f);
+}
+
+/*
+ * buf 为 NULL 时继续使用 FILE 内置的 BUFSIZ 字节缓冲区。
+ * 和标准 C 不同，这里允许在任何时候调用：已缓冲的内容会先写出。
+ */
+int setvbuf(FILE *f, char *buf, int mode, size_t size)
+{
+	if (mode != _IOFBF && mode != _IOLBF && mode != _IONBF) {
+		return -1;
+	}
+
+	stdio_setup(f);
+	stdio_drain(f);
+	f->mode = mode;
+	if (buf != NULL && size >= 2) {
+		f->buf = buf;
+		f->size = size;
+	} else {
+		f->buf = f->inline_buf;
+		f->size = sizeof(f->inline_buf);
+	}
+	return 0;
+}
+
+int vfprintf(FILE *f, const char *format, va_list args)
+{
+	va_list again;
+	size_t start;
+	int len;
+
+	stdio_setup(f);
+	va_copy(again, args);
+
+	// vsnprintf 还要写一个结尾的 '\0'，所以最多只能用到 size - 1 字节
+	start = f->len;
+	len = vsnprintf(f->buf + start, f->size - start, format, args);
+	if ((size_t)len >= f->size - start) {
+		if (start > 0) {
+			f->len = start;
+			stdio_drain(f);
+			start = 0;
+			len = vsnprintf(f->buf, f->size, format, again);
+		}
+		if ((size_t)len >= f->size) {
+			f->len = f->size - 1;
+			stdio_drain(f);
+			va_end(again);
+			return len;
+		}
+	}
+	va_end(again);
+
+	f->len = start + (size_t)len;
+	if (f->mode == _IONBF || (f->mode == _IOLBF && strchr(f->buf + start, '\n'))) {
+		stdio_drain(f);
+	}
+	return len;
+}
+
+int fprintf(FILE *f, const char *format, ...)
+{
+	va_list args;
+	int len;
+
+	va_start(args, format);
+	len = vfprintf(f, format, args);
+	va_end(args);
+	return len;
+}
@@ -0,0 +1,123 @@
+#include "uapi/sync.h"
+#include "syscalls.h"
+
+/*
+ * 互斥锁
+ * ref: Ulrich Drepper, "Futexes Are Tricky", mutex3
+ *
+ * 加锁：CAS 0 -> 1 成功就返回（快速路径）。否则把 state 置为 2 表示有人在
+ * 等待，然后在 state == 2 上睡眠，直到抢到锁。
+ * 解锁：state 从 1 减到 0 说明没有等待者，不进入内核；否则清零并唤醒一个。
+ */
+void mutex_init(mutex_t *m)
+{
+	m->state = 0;
+}
+
+int mutex_trylock(mutex_t *m)
+{
+	int expected = 0;
+	return __atomic_compare_exchange_n(&m->state, &expected, 1, 0,
+					   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+void mutex_lock(mutex_t *m)
+{
+	int c = 0;
+
+	if (__atomic_compare_exchange_n(&m->state, &c, 1, 0,
+					__ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+		return;
+	}
+
+	if (c != 2) {
+		c = __atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE);
+	}
+	while (c != 0) {
+		futex_wait(&m->state, 2);
+		c = __atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE);
+	}
+}
+
+void mutex_unlock(mutex_t *m)
+{
+	if (__atomic_fetch_sub(&m->state, 1, __ATOMIC_RELEASE) != 1) {
+		__atomic_store_n(&m->state, 0, __ATOMIC_RELEASE);
+		futex_wake(&m->state, 1);
+	}
+}
+
+/*
+ * 条件变量
+ *
+ * 等待者先记下 seq 再释放互斥锁，然后在 seq 上睡眠；signal 在睡眠之前
+ * 递增了 seq 的话 futex_wait 会立即返回，所以不会丢失唤醒。
+ * 和 pthread 一样，调用者需要在循环中重新检查条件（允许虚假唤醒）。
+ */
+void cond_init(cond_t *c)
+{
+	c->seq = 0;
+}
+
+void cond_wait(cond_t *c, mutex_t *m)
+{
+	int seq = __atomic_load_n(&c->seq, __ATOMIC_RELAXED);
+
+	mutex_unlock(m);
+	futex_wait(&c->seq, seq);
+	mutex_lock(m);
+}
+
+void cond_signal(cond_t *c)
+{
+	__atomic_fetch_add(&c->seq, 1, __ATOMIC_RELEASE);
+	futex_wake(&c->seq, 1);
+}
+
+void cond_broadcast(cond_t *c)
+{
+	__atomic_fetch_add(&c->seq, 1, __ATOMIC_RELEASE);
+	futex_wake(&c->seq, 0x7fffffff);
+}
+
+/*
+ * 信号量
+ *
+ * count > 0 时用 CAS 减一即可；为 0 时登记为等待者并在 count == 0 上睡眠。
+ * post 只有在有登记的等待者时才进入内核。
+ */
+void sem_init(sem_t *s, int value)
+{
+	s->count = value;
+	s->waiters = 0;
+}
+
+int sem_trywait(sem_t *s)
+{
+	int v = __atomic_load_n(&s->count, __ATOMIC_RELAXED);
+
+	while (v > 0) {
+		if (__atomic_compare_exchange_n(&s->count, &v, v - 1, 0,
+						__ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+void sem_wait(sem_t *s)
+{
+	while (!sem_trywait(s)) {
+		__atomic_fetch_add(&s->waiters, 1, __ATOMIC_SEQ_CST);
+		futex_wait(&s->count, 0);
+		__atomic_fetch_sub(&s->waiters, 1, __ATOMIC_RELAXED);
+	}
+}
+
+void sem_post(sem_t *s)
+{
+	__atomic_fetch_add(&s->count, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&s->waiters, __ATOMIC_SEQ_CST) > 0) {
+		futex_wake(&s->count, 1);
+	}
+}
@@ -1,4 +1,5 @@
 #include "syscalls.h"
+#include "uapi/stdio.h"
 
 // 统一的系统调用原始接口
 static inline long syscall_raw(long num, long a0, long a1, long a2, long a3, long a4, long a5)
@@ -18,6 +19,7 @@ static inline long syscall_raw(long num, long a0, long a1, long a2, long a3, lon
 /* ==================== 用户态系统调用实现 ==================== */
 
 void exit(int status) {
+    fflush(stdout);  // 缓冲中还没写出的输出
     syscall_raw(__NR_exit, status, 0, 0, 0, 0, 0);
     while(1); // 不应该到达这里
 }
@@ -55,3 +57,69 @@ int hart_count(void) {
 long hart_current_id(void) {
     return syscall_raw(__NR_hart_current_id, 0, 0, 0, 0, 0, 0);
 }
+
+int hart_online(int hartid) {
+    return (int)syscall_raw(__NR_hart_online, hartid, 0, 0, 0, 0, 0);
+}
+
+int hart_offline(int hartid) {
+    return (int)syscall_raw(__NR_hart_offline, hartid, 0, 0, 0, 0, 0);
+}
+
+/* ==================== Futex ==================== */
+
+long futex_wait(volatile int *uaddr, int val) {
+    return syscall_raw(__NR_futex_wait, (long)uaddr, val, 0, 0, 0, 0);
+}
+
+long futex_wake(volatile int *uaddr, int nr) {
+    return syscall_raw(__NR_futex_wake, (long)uaddr, nr, 0, 0, 0, 0);
+}
+
+/* ==================== 内存 ==================== */
+
+void *sbrk(long increment) {
+    return (void *)syscall_raw(__NR_sbrk, increment, 0, 0, 0, 0, 0);
+}
+
+void *mmap(void *addr, size_t length, int prot, int flags, int fd, long offset) {
+    return (void *)syscall_raw(__NR_mmap, (long)addr, length, prot, flags, fd, offset);
+}
+
+int munmap(void *addr, size_t length) {
+    return (int)syscall_raw(__NR_munmap, (long)addr, length, 0, 0, 0, 0);
+}
+
+/* ==================== 任务 ==================== */
+
+int clone(void (*fn)(void *), void *arg) {
+    return (int)syscall_raw(__NR_clone, (long)fn, (long)arg, 0, 0, 0, 0);
+}
+
+int sched_setaffinity(int pid, size_t size, const unsigned long *mask) {
+    return (int)syscall_raw(__NR_sched_setaffinity, pid, size, (long)mask, 0, 0, 0);
+}
+
+int sched_getaffinity(int pid, size_t size, unsigned long *mask) {
+    return (int)syscall_raw(__NR_sched_getaffinity, pid, size, (long)mask, 0, 0, 0);
+}
+
+int sched_getcpu(int pid) {
+    return (int)syscall_raw(__NR_sched_getcpu, pid, 0, 0, 0, 0, 0);
+}
+
+/* ==================== 统计 ==================== */
+
+long getstats(int hart, struct kstats *buf, size_t size) {
+    return syscall_raw(__NR_getstats, hart, (long)buf, size, 0, 0, 0);
+}
+
+int console_stats(struct uart_rx_stats *stats) {
+    return (int)syscall_raw(__NR_console_stats, (long)stats, 0, 0, 0, 0, 0);
+}
+
+/* ==================== 性能分析 ==================== */
+
+long profile(int cmd, unsigned long arg) {
+    return syscall_raw(__NR_profile, cmd, arg, 0, 0, 0, 0);
+}
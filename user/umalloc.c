@@ -0,0 +1,183 @@
+#include "uapi/umalloc.h"
+#include "uapi/mman.h"
+#include "uapi/tls.h"
+#include "syscalls.h"
+#include "string.h"
+
+/*
+ * 按 size class 的用户态分配器
+ *
+ * 每个块前面有 16 字节头部，记录 size class（或大块的映射长度），所以块
+ * 本身和返回给用户的地址都是 16 字节对齐的。空闲的小块用用户区的前 8 字节
+ * 串成单链表，挂在当前任务的缓存上；缓存在 TLS 里，TLS 清零即为空缓存。
+ *
+ * 链表为空时从 [cur, end) 顺序切一个新块；这段空间用完后再 sbrk
+ * UM_REFILL 字节。如果新的 break 刚好接在 end 后面（中间没有别人调用过
+ * sbrk），就直接延长，否则丢弃剩下的零头。
+ */
+
+#define UM_MIN_SHIFT 5              // 最小的块 32 字节：头部加上空闲时的链表指针
+#define UM_CLASSES 7                // 32, 64, ..., 2048
+#define UM_MAX_BLOCK (1UL << (UM_MIN_SHIFT + UM_CLASSES - 1))
+#define UM_REFILL (16 * 1024)
+#define UM_PAGE 4096
+
+#define UM_LARGE 0xffffffffu
+#define UM_MAGIC 0x75616c63u        // "ualc"
+#define UM_FREED 0x66726565u        // "free"，用来发现重复释放
+
+struct um_header {
+	uint32_t cls;                   // size class，大块为 UM_LARGE
+	uint32_t magic;
+	size_t map_len;                 // 只有大块使用
+};
+
+struct um_free {
+	struct um_free *next;
+};
+
+struct um_cache {
+	struct um_free *free[UM_CLASSES];
+	char *cur;
+	char *end;
+	struct umalloc_stats stats;
+};
+
+_Static_assert(sizeof(struct um_header) == 16, "header must keep 16-byte alignment");
+_Static_assert(sizeof(struct um_header) + sizeof(struct um_free) <= (1UL << UM_MIN_SHIFT),
+	       "the smallest block must hold the free-list link");
+_Static_assert(TLS_UMALLOC_OFFSET + sizeof(struct um_cache) <= TLS_SIZE,
+	       "umalloc cache must fit in the TLS block");
+
+static inline struct um_cache *um_cache(void)
+{
+	return (struct um_cache *)((char *)tls_base() + TLS_UMALLOC_OFFSET);
+}
+
+/*
+ * 能放下 total 字节（含头部）的最小 class。umalloc(0) 也落在 class 0，
+ * 块里仍有放 struct um_free 的地方，ufree 不会写到下一个块。
+ */
+static inline unsigned um_class(size_t total)
+{
+	if (total <= (1UL << UM_MIN_SHIFT)) {
+		return 0;
+	}
+	return (unsigned)(64 - __builtin_clzl(total - 1)) - UM_MIN_SHIFT;
+}
+
+static void *um_alloc_large(struct um_cache *c, size_t total)
+{
+	size_t len = (total + UM_PAGE - 1) & ~(size_t)(UM_PAGE - 1);
+	struct um_header *h = mmap(NULL, len, PROT_READ | PROT_WRITE,
+				   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	c->stats.mmap_calls++;
+	if (h == MAP_FAILED) {
+		return NULL;
+	}
+	h->cls = UM_LARGE;
+	h->magic = UM_MAGIC;
+	h->map_len = len;
+	return h + 1;
+}
+
+/* 从 [cur, end) 切一个 bsize 字节的新块，不够时先 sbrk */
+static struct um_header *um_carve(struct um_cache *c, size_t bsize)
+{
+	if ((size_t)(c->end - c->cur) < bsize) {
+		size_t grab = bsize > UM_REFILL ? bsize : UM_REFILL;
+		char *p = sbrk((long)grab);
+
+		c->stats.sbrk_calls++;
+		if (p == (char *)-1) {
+			return NULL;
+		}
+		if (p != c->end) {
+			c->cur = p;
+		}
+		c->end = p + grab;
+	}
+
+	struct um_header *h = (struct um_header *)c->cur;
+	c->cur += bsize;
+	return h;
+}
+
+void *umalloc(size_t size)
+{
+	struct um_cache *c = um_cache();
+	size_t total = size + sizeof(struct um_header);
+
+	if (total < size) {
+		return NULL;
+	}
+	c->stats.allocs++;
+	if (total > UM_MAX_BLOCK) {
+		return um_alloc_large(c, total);
+	}
+
+	unsigned cls = um_class(total);
+	struct um_header *h;
+	struct um_free *f = c->free[cls];
+
+	if (f != NULL) {
+		c->free[cls] = f->next;
+		c->stats.cache_hits++;
+		h = (struct um_header *)f - 1;
+	} else {
+		h = um_carve(c, 1UL << (cls + UM_MIN_SHIFT));
+		if (h == NULL) {
+			return NULL;
+		}
+		h->cls = cls;
+	}
+	h->magic = UM_MAGIC;
+	return h + 1;
+}
+
+void *ucalloc(size_t nmemb, size_t size)
+{
+	if (size != 0 && nmemb > (size_t)-1 / size) {
+		return NULL;
+	}
+
+	size_t n = nmemb * size;
+	void *p = umalloc(n);
+	if (p != NULL) {
+		memset(p, 0, n);
+	}
+	return p;
+}
+
+void ufree(void *ptr)
+{
+	if (ptr == NULL) {
+		return;
+	}
+
+	struct um_cache *c = um_cache();
+	struct um_header *h = (struct um_header *)ptr - 1;
+
+	if (h->magic != UM_MAGIC) {
+		// 重复释放或者不是 umalloc 返回的指针：不碰任何链表
+		return;
+	}
+	c->stats.frees++;
+	if (h->cls == UM_LARGE) {
+		h->magic = UM_FREED;
+		munmap(h, h->map_len);
+		c->stats.munmap_calls++;
+		return;
+	}
+
+	struct um_free *f = ptr;
+	h->magic = UM_FREED;
+	f->next = c->free[h->cls];
+	c->free[h->cls] = f;
+}
+
+void umalloc_get_stats(struct umalloc_stats *out)
+{
+	*out = um_cache()->stats;
+}
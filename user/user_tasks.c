@@ -1,6 +1,7 @@
 #include "uapi/printf.h"
 #include "syscalls.h" // 使用新的系统调用声明
 #include "uapi/user_tasks.h"
+#include "string.h"
 
 void user_task0(void *param)
 {